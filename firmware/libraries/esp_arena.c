@@ -0,0 +1,108 @@
+/**
+ * \brief		Bump Arena Allocator
+ * \file		esp_arena.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_ARENA_C__
+#define __ESP_ARENA_C__
+
+#include "osapi.h"
+#include "mem.h"
+
+#include "esp_arena.h"
+
+
+/**
+ * Initializes the arena over the given buffer
+ */
+void ICACHE_FLASH_ATTR esp_arena_initialize( esp_arena_type* arena, uint8_t* buffer, uint16_t size )
+{
+    arena->base = buffer;
+    arena->size = size;
+    arena->used = 0;
+    arena->overflow = NULL;
+    arena->overflow_used = 0;
+    arena->high_water = 0;
+}
+
+/**
+ * Allocate pointer aligned memory
+ */
+void* ICACHE_FLASH_ATTR esp_arena_alloc( esp_arena_type* arena, uint16_t size )
+{
+    esp_arena_block_type* block = arena->overflow;
+    uint16_t block_size;
+    void* p;
+
+    size = ( size + ESP_ARENA_ALIGNMENT - 1 ) & ~( ESP_ARENA_ALIGNMENT - 1 );
+    if( ( uint32_t ) arena->used + size <= arena->size ) {
+        p = arena->base + arena->used;
+        arena->used += size;
+    } else {
+        // buffer exhausted, continue in a heap block
+        if( block == NULL || ( uint32_t ) block->used + size > block->size ) {
+            block_size = ( size > ESP_ARENA_OVERFLOW_BLOCK_SIZE ) ? size : ESP_ARENA_OVERFLOW_BLOCK_SIZE;
+            block = ( esp_arena_block_type* ) os_malloc( sizeof( esp_arena_block_type ) + block_size );
+            if( block == NULL ) return NULL;
+            block->size = block_size;
+            block->used = 0;
+            block->chain = arena->overflow;
+            arena->overflow = block;
+        }
+        p = ( ( uint8_t* ) ( block + 1 ) ) + block->used;
+        block->used += size;
+        arena->overflow_used += size;
+    }
+
+    if( esp_arena_used( arena ) > arena->high_water )
+        arena->high_water = esp_arena_used( arena );
+    return p;
+}
+
+/**
+ * Release every allocation, constant time unless overflow blocks were needed
+ */
+void ICACHE_FLASH_ATTR esp_arena_reset( esp_arena_type* arena )
+{
+    esp_arena_block_type* block;
+
+    while( ( block = arena->overflow ) != NULL ) {
+        arena->overflow = block->chain;
+        os_free( block );
+    }
+    arena->used = 0;
+    arena->overflow_used = 0;
+}
+
+/**
+ * Bytes currently allocated
+ */
+uint32_t ICACHE_FLASH_ATTR esp_arena_used( esp_arena_type* arena )
+{
+    return arena->used + arena->overflow_used;
+}
+
+/**
+ * Largest allocation total seen since initialization
+ */
+uint32_t ICACHE_FLASH_ATTR esp_arena_high_water( esp_arena_type* arena )
+{
+    return arena->high_water;
+}
+
+void* ICACHE_FLASH_ATTR esp_arena_malloc( esp_arena_type* arena, uint16_t size )
+{
+    if( arena != NULL ) return esp_arena_alloc( arena, size );
+    return os_malloc( size );
+}
+
+void ICACHE_FLASH_ATTR esp_arena_free( esp_arena_type* arena, void* p )
+{
+    if( arena == NULL && p != NULL ) os_free( p );
+}
+
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * \brief		Bump Arena Allocator
+ * \file		esp_arena.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Allocations are taken from a caller provided buffer by moving a pointer forward and are all released at once
+ * with esp_arena_reset. If the buffer runs out, overflow blocks are taken from the heap and freed on reset, so a
+ * request never fails because the arena was sized too small. The high-water mark is kept across resets to help
+ * sizing the buffer.
+ */
+#ifndef __ESP_ARENA_H__
+#define __ESP_ARENA_H__
+
+#include "osapi.h"
+
+#define ESP_ARENA_OVERFLOW_BLOCK_SIZE 256
+#define ESP_ARENA_ALIGNMENT sizeof( void* )
+
+/**
+ * Heap block used when the arena buffer is full
+ */
+typedef struct esp_arena_block esp_arena_block_type;
+
+struct esp_arena_block {
+    esp_arena_block_type* chain;
+    uint16_t size;
+    uint16_t used;
+};
+
+/**
+ * Arena object
+ */
+typedef struct esp_arena {
+    uint8_t* base;
+    uint16_t size;
+    uint16_t used;
+
+    esp_arena_block_type* overflow;
+    uint32_t overflow_used;
+    uint32_t high_water;
+} esp_arena_type;
+
+void ICACHE_FLASH_ATTR esp_arena_initialize( esp_arena_type* arena, uint8_t* buffer, uint16_t size );
+void* ICACHE_FLASH_ATTR esp_arena_alloc( esp_arena_type* arena, uint16_t size );
+void ICACHE_FLASH_ATTR esp_arena_reset( esp_arena_type* arena );
+uint32_t ICACHE_FLASH_ATTR esp_arena_used( esp_arena_type* arena );
+uint32_t ICACHE_FLASH_ATTR esp_arena_high_water( esp_arena_type* arena );
+
+/**
+ * Allocate from the arena if one is given, from the heap otherwise
+ */
+void* ICACHE_FLASH_ATTR esp_arena_malloc( esp_arena_type* arena, uint16_t size );
+void ICACHE_FLASH_ATTR esp_arena_free( esp_arena_type* arena, void* p );
+
+#endif
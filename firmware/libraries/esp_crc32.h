@@ -0,0 +1,21 @@
+/**
+ * \brief		CRC32 Checksum
+ * \file		esp_crc32.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Table driven CRC32 ( IEEE 802.3, reflected ). The running value can be passed back in to checksum data which
+ * arrives in chunks, start with ESP_CRC32_INITIAL.
+ */
+#ifndef __ESP_CRC32_H__
+#define __ESP_CRC32_H__
+
+#include "osapi.h"
+
+#define ESP_CRC32_INITIAL 0x00000000
+
+uint32_t ICACHE_FLASH_ATTR esp_crc32_update( uint32_t crc, const uint8_t* data, uint32_t length );
+
+#endif
@@ -0,0 +1,255 @@
+/**
+ * \brief		Hostname Resolution Cache
+ * \file		esp_dns_cache.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_DNS_CACHE_C__
+#define __ESP_DNS_CACHE_C__
+
+#include "osapi.h"
+#include "user_interface.h"
+#include "espconn.h"
+
+#include "esp_dns_cache.h"
+
+#if ESP_DNS_CACHE_MAX_TTL + ESP_DNS_CACHE_TICK >= 4294
+#error "answers must expire before the microsecond clock wraps"
+#endif
+
+/**
+ * SDK answer callback, the query connection carries its entry
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_dns_espconn_found( const char* name, ip_addr_t* address, void* arg )
+{
+    esp_dns_entry_type* entry = ( esp_dns_entry_type* ) ( ( struct espconn* ) arg )->reverse;
+
+    esp_dns_cache_found( entry, ( address != NULL ) ? address->addr : 0, 0 );
+}
+
+/**
+ * Default backend, the SDK doesn't report the time to live so the default one is used
+ */
+LOCAL esp_dns_result_type ICACHE_FLASH_ATTR esp_dns_espconn_backend( esp_dns_cache_type* cache, esp_dns_entry_type* entry )
+{
+    int8_t result;
+
+    entry->query.reverse = entry;
+    result = espconn_gethostbyname( &( entry->query ), ( const char* ) entry->hostname, &( entry->address ), esp_dns_espconn_found );
+    if( result == ESPCONN_OK ) {
+        entry->ip = entry->address.addr;
+        return ESP_DNS_RESOLVED;
+    }
+    return ( result == ESPCONN_INPROGRESS ) ? ESP_DNS_PENDING : ESP_DNS_FAILED;
+}
+
+/**
+ * Checks if an answer is still within its time to live
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_dns_entry_fresh( esp_dns_entry_type* entry )
+{
+    return system_get_time() - entry->resolved_at < entry->ttl * 1000000UL;
+}
+
+/**
+ * Expiry tick, an answer left in place past the wrap of the clock would look fresh again
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_dns_cache_tick( esp_dns_cache_type* cache )
+{
+    esp_dns_entry_type* entry;
+    uint8_t i;
+
+    for( i = 0; i < ESP_DNS_CACHE_ENTRIES ; i++ ) {
+        entry = &( cache->entries[ i ] );
+        if( ( entry->state == ESP_DNS_ENTRY_VALID || entry->state == ESP_DNS_ENTRY_FAILED ) && ! esp_dns_entry_fresh( entry ) )
+            entry->state = ESP_DNS_ENTRY_EMPTY;
+    }
+}
+
+/**
+ * Initializes an empty cache, a NULL backend resolves through espconn_gethostbyname
+ */
+void ICACHE_FLASH_ATTR esp_dns_cache_initialize( esp_dns_cache_type* cache, esp_dns_backend_type backend )
+{
+    uint8_t i;
+
+    os_memset( cache, 0, sizeof( esp_dns_cache_type ) );
+    for( i = 0; i < ESP_DNS_CACHE_ENTRIES ; i++ )
+        cache->entries[ i ].cache = cache;
+    cache->backend = ( backend != NULL ) ? backend : esp_dns_espconn_backend;
+    os_timer_setfn( &( cache->expiry_timer ), ( os_timer_func_t* ) esp_dns_cache_tick, cache );
+    os_timer_arm( &( cache->expiry_timer ), ESP_DNS_CACHE_TICK * 1000, 1 );
+}
+
+/**
+ * Stops the expiry tick, the cache can be released afterwards
+ */
+void ICACHE_FLASH_ATTR esp_dns_cache_deinitialize( esp_dns_cache_type* cache )
+{
+    os_timer_disarm( &( cache->expiry_timer ) );
+}
+
+/**
+ * Forget every answer, lookups in progress are kept
+ */
+void ICACHE_FLASH_ATTR esp_dns_cache_flush( esp_dns_cache_type* cache )
+{
+    uint8_t i;
+
+    for( i = 0; i < ESP_DNS_CACHE_ENTRIES ; i++ )
+        if( cache->entries[ i ].state != ESP_DNS_ENTRY_PENDING )
+            cache->entries[ i ].state = ESP_DNS_ENTRY_EMPTY;
+}
+
+/**
+ * Case insensitive hostname comparison
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_dns_hostname_equals( uint8_t* a, uint8_t* b )
+{
+    for( ; ( *a ) != '\0' ; a++, b++ )
+        if( tolower( *a ) != tolower( *b ) ) return 0x00;
+    return ( *b ) == '\0';
+}
+
+/**
+ * Find the entry of a hostname, or the one to replace: an empty one, else the oldest answer
+ */
+LOCAL esp_dns_entry_type* ICACHE_FLASH_ATTR esp_dns_cache_lookup( esp_dns_cache_type* cache, uint8_t* hostname, uint8_t* found )
+{
+    esp_dns_entry_type* entry, *victim = NULL;
+    uint32_t now = system_get_time();
+    uint8_t i;
+
+    for( i = 0; i < ESP_DNS_CACHE_ENTRIES ; i++ ) {
+        entry = &( cache->entries[ i ] );
+        if( entry->state == ESP_DNS_ENTRY_EMPTY ) {
+            if( victim == NULL || victim->state != ESP_DNS_ENTRY_EMPTY ) victim = entry;
+            continue;
+        }
+        if( esp_dns_hostname_equals( entry->hostname, hostname ) ) {
+            ( *found ) = 0x01;
+            return entry;
+        }
+        if( entry->state == ESP_DNS_ENTRY_PENDING ) continue;
+        if( victim == NULL || ( victim->state != ESP_DNS_ENTRY_EMPTY && now - entry->resolved_at > now - victim->resolved_at ) )
+            victim = entry;
+    }
+    ( *found ) = 0x00;
+    return victim;
+}
+
+/**
+ * Store an answer
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_dns_entry_answer( esp_dns_entry_type* entry, uint32_t ip, uint32_t ttl )
+{
+    if( ttl == 0 ) ttl = ESP_DNS_CACHE_DEFAULT_TTL;
+    if( ttl > ESP_DNS_CACHE_MAX_TTL ) ttl = ESP_DNS_CACHE_MAX_TTL;
+
+    entry->ip = ip;
+    entry->state = ( ip != 0 ) ? ESP_DNS_ENTRY_VALID : ESP_DNS_ENTRY_FAILED;
+    entry->ttl = ( ip != 0 ) ? ttl : ESP_DNS_CACHE_FAILURE_TTL;
+    entry->resolved_at = system_get_time();
+}
+
+/**
+ * Resolve the hostname of the URL into its host_ip. Returns ESP_DNS_RESOLVED if the address was filled in
+ * right away, ESP_DNS_PENDING if the waiter will be called back or ESP_DNS_FAILED.
+ */
+esp_dns_result_type ICACHE_FLASH_ATTR esp_dns_resolve( esp_dns_cache_type* cache, url_object_type* url, esp_dns_waiter_type* waiter, esp_dns_callback_type fn, void* arg )
+{
+    esp_dns_entry_type* entry;
+    esp_dns_result_type result;
+    uint8_t found;
+
+    if( url->host_ip != 0x00000000 ) return ESP_DNS_RESOLVED;
+    if( url->hostname == NULL || url->hostname[ 0 ] == '\0' ) return ESP_DNS_FAILED;
+    if( strlen( ( char* ) url->hostname ) >= ESP_DNS_CACHE_HOSTNAME ) return ESP_DNS_FAILED;
+
+    entry = esp_dns_cache_lookup( cache, url->hostname, &found );
+    if( found ) {
+        if( entry->state == ESP_DNS_ENTRY_PENDING ) {
+            // join the query in progress
+            waiter->next = entry->waiters;
+            waiter->url = url;
+            waiter->callback = fn;
+            waiter->arg = arg;
+            entry->waiters = waiter;
+            cache->coalesced++;
+            return ESP_DNS_PENDING;
+        }
+        if( esp_dns_entry_fresh( entry ) ) {
+            cache->hits++;
+            if( entry->state == ESP_DNS_ENTRY_FAILED ) return ESP_DNS_FAILED;
+            url->host_ip = entry->ip;
+            return ESP_DNS_RESOLVED;
+        }
+    }
+    // every entry is waiting on a query
+    if( entry == NULL ) return ESP_DNS_FAILED;
+
+    cache->misses++;
+    strcpy( ( char* ) entry->hostname, ( char* ) url->hostname );
+    entry->state = ESP_DNS_ENTRY_PENDING;
+    entry->waiters = NULL;
+    result = cache->backend( cache, entry );
+
+    if( result == ESP_DNS_PENDING ) {
+        waiter->next = NULL;
+        waiter->url = url;
+        waiter->callback = fn;
+        waiter->arg = arg;
+        entry->waiters = waiter;
+        return ESP_DNS_PENDING;
+    }
+    esp_dns_entry_answer( entry, ( result == ESP_DNS_RESOLVED ) ? entry->ip : 0, 0 );
+    if( result != ESP_DNS_RESOLVED ) return ESP_DNS_FAILED;
+    url->host_ip = entry->ip;
+    return ESP_DNS_RESOLVED;
+}
+
+/**
+ * Stop waiting for an answer, call before the connection holding the waiter is released
+ */
+void ICACHE_FLASH_ATTR esp_dns_cancel( esp_dns_cache_type* cache, esp_dns_waiter_type* waiter )
+{
+    esp_dns_waiter_type** link;
+    uint8_t i;
+
+    for( i = 0; i < ESP_DNS_CACHE_ENTRIES ; i++ ) {
+        if( cache->entries[ i ].state != ESP_DNS_ENTRY_PENDING ) continue;
+        for( link = &( cache->entries[ i ].waiters ); ( *link ) != NULL ; link = &( ( *link )->next ) ) {
+            if( ( *link ) == waiter ) {
+                ( *link ) = waiter->next;
+                waiter->next = NULL;
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Backend answer for a pending entry, ip is 0 if the lookup failed and a ttl of 0 uses the default
+ */
+void ICACHE_FLASH_ATTR esp_dns_cache_found( esp_dns_entry_type* entry, uint32_t ip, uint32_t ttl )
+{
+    esp_dns_waiter_type* waiter, *next;
+
+    if( entry->state != ESP_DNS_ENTRY_PENDING ) return;
+    esp_dns_entry_answer( entry, ip, ttl );
+
+    // callbacks may start new lookups, take the list out first
+    waiter = entry->waiters;
+    entry->waiters = NULL;
+    for( ; waiter != NULL ; waiter = next ) {
+        next = waiter->next;
+        waiter->next = NULL;
+        if( ip != 0 && waiter->url != NULL ) waiter->url->host_ip = ip;
+        if( waiter->callback != NULL ) waiter->callback( waiter, ip, waiter->arg );
+    }
+}
+
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * \brief		Hostname Resolution Cache
+ * \file		esp_dns_cache.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Keeps the addresses of the last few hostnames for the time to live of their answer, so a connection to a host
+ * which was resolved recently gets its address filled into host_ip right away instead of waiting on the access
+ * point for every send. Failed lookups are remembered for a short while too, so an unreachable host isn't queried
+ * in a loop.
+ *
+ * A lookup for a hostname which is already being resolved doesn't start another query, the waiter is queued on the
+ * pending entry and every waiter is called back with the one answer. Waiters are list nodes kept in the caller's
+ * connection object and must be cancelled if the connection goes away before the answer comes.
+ *
+ * Queries go through a backend function, espconn_gethostbyname by default. A backend either answers right away or
+ * starts the query and reports the answer later through esp_dns_cache_found, so host tests can plug in a stub.
+ */
+#ifndef __ESP_DNS_CACHE_H__
+#define __ESP_DNS_CACHE_H__
+
+#include "osapi.h"
+#include "user_interface.h"
+#include "espconn.h"
+
+#include "esp_url.h"
+
+/**
+ * Cache geometry, longer hostnames are not resolved
+ */
+#define ESP_DNS_CACHE_ENTRIES 4
+#define ESP_DNS_CACHE_HOSTNAME 48
+
+/**
+ * Time to live of answers without one, failures and the longest accepted, in seconds
+ */
+#define ESP_DNS_CACHE_DEFAULT_TTL 300
+#define ESP_DNS_CACHE_FAILURE_TTL 10
+#define ESP_DNS_CACHE_MAX_TTL 3600
+
+/**
+ * Period of the expiry tick in seconds, answers are dropped within a tick past their time to live so their age
+ * never gets near the wrap of the microsecond clock, about 71 minutes
+ */
+#define ESP_DNS_CACHE_TICK 60
+
+/**
+ * Lookup results
+ */
+typedef enum {
+    ESP_DNS_RESOLVED = 0,
+    ESP_DNS_PENDING,
+    ESP_DNS_FAILED
+} esp_dns_result_type;
+
+/**
+ * Entry states
+ */
+typedef enum {
+    ESP_DNS_ENTRY_EMPTY = 0,
+    ESP_DNS_ENTRY_PENDING,
+    ESP_DNS_ENTRY_VALID,
+    ESP_DNS_ENTRY_FAILED
+} esp_dns_entry_state_type;
+
+typedef struct esp_dns_cache esp_dns_cache_type;
+typedef struct esp_dns_entry esp_dns_entry_type;
+typedef struct esp_dns_waiter esp_dns_waiter_type;
+
+/**
+ * Answer callback, ip is 0 if the lookup failed
+ */
+typedef void ( *esp_dns_callback_type )( esp_dns_waiter_type* waiter, uint32_t ip, void* arg );
+
+/**
+ * Backend, returns ESP_DNS_RESOLVED with entry->ip set, ESP_DNS_PENDING if esp_dns_cache_found will be called
+ * later or ESP_DNS_FAILED
+ */
+typedef esp_dns_result_type ( *esp_dns_backend_type )( esp_dns_cache_type* cache, esp_dns_entry_type* entry );
+
+/**
+ * Waiting lookup, embedded in the connection object, the resolved address goes into url->host_ip
+ */
+struct esp_dns_waiter {
+    esp_dns_waiter_type* next;
+    url_object_type* url;
+    esp_dns_callback_type callback;
+    void* arg;
+};
+
+/**
+ * Cached hostname
+ */
+struct esp_dns_entry {
+    uint8_t hostname[ ESP_DNS_CACHE_HOSTNAME ];
+    esp_dns_entry_state_type state;
+    uint32_t ip;
+    uint32_t resolved_at;
+    uint32_t ttl;
+    esp_dns_waiter_type* waiters;
+
+    esp_dns_cache_type* cache;
+    struct espconn query;
+    ip_addr_t address;
+};
+
+/**
+ * Cache
+ */
+struct esp_dns_cache {
+    esp_dns_entry_type entries[ ESP_DNS_CACHE_ENTRIES ];
+    esp_dns_backend_type backend;
+    os_timer_t expiry_timer;
+
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t coalesced;
+};
+
+void ICACHE_FLASH_ATTR esp_dns_cache_initialize( esp_dns_cache_type* cache, esp_dns_backend_type backend );
+void ICACHE_FLASH_ATTR esp_dns_cache_deinitialize( esp_dns_cache_type* cache );
+void ICACHE_FLASH_ATTR esp_dns_cache_flush( esp_dns_cache_type* cache );
+
+esp_dns_result_type ICACHE_FLASH_ATTR esp_dns_resolve( esp_dns_cache_type* cache, url_object_type* url, esp_dns_waiter_type* waiter, esp_dns_callback_type fn, void* arg );
+void ICACHE_FLASH_ATTR esp_dns_cancel( esp_dns_cache_type* cache, esp_dns_waiter_type* waiter );
+void ICACHE_FLASH_ATTR esp_dns_cache_found( esp_dns_entry_type* entry, uint32_t ip, uint32_t ttl );
+
+#endif
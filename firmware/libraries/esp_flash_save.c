@@ -15,6 +15,8 @@
 #include "user_interface.h"
 #include "mem.h"
 
+#include "esp_crc32.h"
+
 LOCAL uint32_t esp_flash_current_sector_address = 0x0003c000;
 LOCAL uint32_t esp_flash_backup_sector_address = 0x0003d000;
 
@@ -31,50 +33,179 @@ typedef enum esp_flash_queue_actions {
 } esp_flash_queue_actions_type;
 
 /**
- * Queued update items
+ * Queued update items, one per parameter id
  */
 typedef struct esp_flash_update_item_queue {
 	uint8_t item_action;
 	uint8_t item_id;
 	uint8_t *item_data;
 	uint8_t item_size;
+	uint8_t item_capacity;
 } esp_flash_update_item_queue_type;
 
 /**
- * Update queue
+ * Update queue, committed when it fills up, after the idle timeout or once the queued values reach the threshold
  */
 LOCAL uint8_t esp_flash_instant_update = 0x01;
 LOCAL esp_flash_update_item_queue_type esp_flash_update_queue[ ESP_FLASH_UPDATE_QUEUE_SIZE ];
 LOCAL uint8_t esp_flash_update_queue_fill = 0;
+LOCAL uint16_t esp_flash_update_queue_bytes = 0;
+
+LOCAL os_timer_t esp_flash_commit_timer;
+LOCAL uint8_t esp_flash_commit_timer_set = 0x00;
+LOCAL uint32_t esp_flash_commit_idle_timeout = ESP_FLASH_COMMIT_IDLE_TIMEOUT;
+LOCAL uint16_t esp_flash_commit_threshold = ESP_FLASH_COMMIT_THRESHOLD;
 
+/**
+ * Open transaction, the queue is only committed by esp_flash_transaction_commit
+ */
+LOCAL uint8_t esp_flash_transaction_active = 0x00;
+LOCAL uint8_t esp_flash_transaction_failed = 0x00;
+LOCAL uint8_t esp_flash_transaction_instant = 0x01;
 
 
+/**
+ * Parameter index entry, offset of the parameter record inside the current sector
+ */
+typedef struct esp_flash_index_entry {
+	uint8_t id;
+	uint8_t length;
+	uint16_t offset;
+} esp_flash_index_entry_type;
 
 /**
- * Calculate the checksum for the given data
+ * Index of the current sector, sorted by id like the sector itself
+ */
+LOCAL esp_flash_index_entry_type esp_flash_index[ ESP_FLASH_INDEX_SIZE ];
+LOCAL uint8_t esp_flash_index_fill = 0;
+LOCAL uint8_t esp_flash_index_valid = 0x00;
+
+/**
+ * Mapped reads, set once the current sector reads the same through the cache. Writes leave the cache stale
+ * until the next mapped read invalidates it.
+ */
+LOCAL uint8_t esp_flash_mmap_enabled = 0x00;
+LOCAL uint8_t esp_flash_mmap_stale = 0x01;
+
+extern void Cache_Read_Disable_2( void );
+extern void Cache_Read_Enable_2( void );
+
+
+
+
+/**
+ * Drop the cached flash lines, runs from IRAM since the cache is off meanwhile
+ */
+LOCAL void esp_flash_mmap_invalidate( void )
+{
+    Cache_Read_Disable_2();
+    Cache_Read_Enable_2();
+    esp_flash_mmap_stale = 0x00;
+}
+
+/**
+ * Read from the mapped flash, size and address are 4 byte aligned like for spi_flash_read
+ */
+LOCAL SpiFlashOpResult ICACHE_FLASH_ATTR esp_flash_mmap_read( uint32_t address, uint32_t* dst, uint32_t size )
+{
+    const volatile uint32_t* src;
+    uint32_t i;
+
+    if( esp_flash_mmap_enabled == 0x00 )
+        return spi_flash_read( address, ( uint32* ) dst, size );
+    if( esp_flash_mmap_stale )
+        esp_flash_mmap_invalidate();
+    src = ( const volatile uint32_t* ) ( ESP_FLASH_MMAP_BASE + address );
+    for( i = 0; i < ( size >> 2 ) ; i ++ )
+        dst[ i ] = src[ i ];
+    return SPI_FLASH_RESULT_OK;
+}
+
+/**
+ * Enable mapped reads if the ring is inside the mapped window and the current sector header reads the same
+ * through it, with OTA layouts the cache may map another megabyte
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_mmap_setup( void )
+{
+    uint32_t header[ 2 ], mapped[ 2 ];
+
+    esp_flash_mmap_enabled = 0x00;
+    if( ESP_FLASH_RING_START_ADDRESS + ESP_FLASH_RING_SECTORS * ESP_FLASH_RING_SECTOR_SIZE > ESP_FLASH_MMAP_SIZE )
+        return;
+    if( SPI_FLASH_RESULT_OK != spi_flash_read( esp_flash_current_sector_address, ( uint32* ) header, sizeof( header ) ) )
+        return;
+    esp_flash_mmap_enabled = 0x01;
+    esp_flash_mmap_stale = 0x01;
+    esp_flash_mmap_read( esp_flash_current_sector_address, mapped, sizeof( mapped ) );
+    if( mapped[ 0 ] != header[ 0 ] || mapped[ 1 ] != header[ 1 ] )
+        esp_flash_mmap_enabled = 0x00;
+}
+
+
+
+/**
+ * Calculate the checksum for the given data, a CRC32 over every word but the last one
  */
 LOCAL uint32_t ICACHE_FLASH_ATTR esp_flash_compute_checksum( uint32_t* sector_data )
 {
-    uint32_t i, checksum = 0x00000000;
-    for( i = 0; i < ESP_FLASH_SECTOR_LENGTH - 1 ; i++ )
-        checksum ^= sector_data[ i ];
+    return esp_crc32_update( ESP_CRC32_INITIAL, ( uint8_t* ) sector_data, ( ESP_FLASH_SECTOR_LENGTH - 1 ) * sizeof( uint32_t ) );
+}
+
+
+
+/**
+ * Continue the checksum of older versions, a XOR of the words
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR esp_flash_compute_legacy_checksum( uint32_t checksum, uint32_t* data, uint16_t length )
+{
+    uint16_t i;
+    for( i = 0; i < length ; i++ )
+        checksum ^= data[ i ];
     return checksum;
 }
 
 
 
 /**
- * Verify the data checksum
+ * Verify the data checksum, sectors saved by older versions carry the XOR checksum until they are rewritten
  */
 uint8_t ICACHE_FLASH_ATTR esp_flash_verify_checksum( uint32_t* sector_data )
 {
-    if( sector_data[ ESP_FLASH_SECTOR_LENGTH - 1 ] == esp_flash_compute_checksum( sector_data ) )
+    uint32_t checksum = sector_data[ ESP_FLASH_SECTOR_LENGTH - 1 ];
+    if( checksum == esp_flash_compute_checksum( sector_data ) )
+        return 0x01;
+    if( checksum == esp_flash_compute_legacy_checksum( 0x00000000, sector_data, ESP_FLASH_SECTOR_LENGTH - 1 ) )
         return 0x01;
     return 0x00;
 }
 
 
 
+/**
+ * Verify the checksum of a sector in flash, reading it in small chunks
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_verify_sector( uint32_t sector_address )
+{
+    uint32_t chunk[ ESP_FLASH_VERIFY_CHUNK ];
+    uint32_t crc = ESP_CRC32_INITIAL, legacy = 0x00000000, checksum = 0x00000000;
+    uint16_t offset, length;
+
+    for( offset = 0; offset < ESP_FLASH_SECTOR_LENGTH ; offset += ESP_FLASH_VERIFY_CHUNK ){
+        length = ESP_FLASH_SECTOR_LENGTH - offset;
+        if( length > ESP_FLASH_VERIFY_CHUNK ) length = ESP_FLASH_VERIFY_CHUNK;
+        if( SPI_FLASH_RESULT_OK != spi_flash_read( sector_address + offset * sizeof( uint32_t ), ( uint32* ) chunk, length * sizeof( uint32_t ) ) )
+            return 0x00;
+        // the checksum itself is the last word of the sector
+        if( offset + length == ESP_FLASH_SECTOR_LENGTH )
+            checksum = chunk[ -- length ];
+        crc = esp_crc32_update( crc, ( uint8_t* ) chunk, length * sizeof( uint32_t ) );
+        legacy = esp_flash_compute_legacy_checksum( legacy, chunk, length );
+    }
+    return ( checksum == crc || checksum == legacy ) ? 0x01 : 0x00;
+}
+
+
+
 /**
  * Iterate and find parameter
  */
@@ -101,24 +232,148 @@ LOCAL uint32_t* ICACHE_FLASH_ATTR esp_flash_search_parameter( uint8_t parameter_
     return NULL;
 }
 
+/**
+ * Rebuild the parameter index from the sector data
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_index_build( uint32_t* sector_data )
+{
+    uint8_t* parameter_start = ( uint8_t* ) ( sector_data + ESP_FLASH_SECTOR_HEADER_SIZE );
+    uint8_t* data_end = ( uint8_t* ) ( sector_data + ESP_FLASH_SECTOR_LENGTH - 1 );
+
+    esp_flash_index_fill = 0;
+    esp_flash_index_valid = 0x01;
+    while( parameter_start < data_end && parameter_start[ 0 ] != 0x00 ){
+        // too many parameters, reads fall back to scanning the sector
+        if( esp_flash_index_fill == ESP_FLASH_INDEX_SIZE ){
+            esp_flash_index_valid = 0x00;
+            break;
+        }
+        // the binary search needs strictly increasing ids, otherwise reads scan the sector
+        if( esp_flash_index_fill > 0 && esp_flash_index[ esp_flash_index_fill - 1 ].id >= parameter_start[ 0 ] ){
+            esp_flash_index_valid = 0x00;
+            break;
+        }
+        esp_flash_index[ esp_flash_index_fill ].id = parameter_start[ 0 ];
+        esp_flash_index[ esp_flash_index_fill ].length = parameter_start[ 1 ];
+        esp_flash_index[ esp_flash_index_fill ].offset = ( uint16_t ) ( parameter_start - ( uint8_t* ) sector_data );
+        esp_flash_index_fill ++;
+        parameter_start += (( 2 + parameter_start[ 1 ] + 0x3 ) & ( ~0x03 ));
+    }
+}
+
+/**
+ * Find the index entry of a parameter
+ */
+LOCAL esp_flash_index_entry_type* ICACHE_FLASH_ATTR esp_flash_index_search( uint8_t parameter_id )
+{
+    uint8_t low = 0, high = esp_flash_index_fill, middle;
+    // binary search, ids are sorted
+    while( low < high ){
+        middle = ( low + high ) >> 1;
+        if( esp_flash_index[ middle ].id == parameter_id )
+            return &( esp_flash_index[ middle ] );
+        if( esp_flash_index[ middle ].id < parameter_id ) low = middle + 1;
+        else high = middle;
+    }
+    return NULL;
+}
+
+/**
+ * Sector following the given one in the ring
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR esp_flash_ring_next( uint32_t sector_address )
+{
+    sector_address += ESP_FLASH_RING_SECTOR_SIZE;
+    if( sector_address >= ESP_FLASH_RING_START_ADDRESS + ESP_FLASH_RING_SECTORS * ESP_FLASH_RING_SECTOR_SIZE )
+        sector_address = ESP_FLASH_RING_START_ADDRESS;
+    return sector_address;
+}
+
+/**
+ * Read the sequence number from a sector header, returns 0 if the sector doesn't hold the given layout.
+ * The sorted layout keeps it in the first word, where older versions kept a 16 bit wear level.
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_sector_sequence( uint32_t sector_address, uint8_t log, uint32_t* sequence )
+{
+    uint32_t header[ 2 ];
+
+    if( SPI_FLASH_RESULT_OK != spi_flash_read( sector_address, ( uint32* ) header, sizeof( header ) ) )
+        return 0x00;
+    if( log ){
+        if( header[ 0 ] != ESP_FLASH_LOG_MAGIC ) return 0x00;
+        ( *sequence ) = header[ 1 ];
+    } else {
+        if( header[ 0 ] == 0x00000000 || header[ 0 ] == 0xFFFFFFFF || header[ 0 ] == ESP_FLASH_LOG_MAGIC ) return 0x00;
+        ( *sequence ) = header[ 0 ];
+    }
+    return 0x01;
+}
+
+/**
+ * Find the newest sector by reading every header, sorted sectors must also pass the checksum
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_ring_scan( uint8_t log, uint32_t* sector_address, uint32_t* sequence )
+{
+    uint32_t address = ESP_FLASH_RING_START_ADDRESS, current;
+    uint8_t i, found = 0x00;
+
+    for( i = 0; i < ESP_FLASH_RING_SECTORS ; i ++, address += ESP_FLASH_RING_SECTOR_SIZE ){
+        if( ! esp_flash_sector_sequence( address, log, &current ) )
+            continue;
+        if( found && ( int32_t ) ( current - ( *sequence ) ) <= 0 )
+            continue;
+        if( ! log && ! esp_flash_verify_sector( address ) )
+            continue;
+        ( *sector_address ) = address;
+        ( *sequence ) = current;
+        found = 0x01;
+    }
+    return found;
+}
+
+/**
+ * Find the newest sector from the headers. Sectors are written in ring order, so from the first sector on
+ * the sequence grows up to the newest one and everything after it is older, erased or torn.
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_ring_find( uint8_t log, uint32_t* sector_address, uint32_t* sequence )
+{
+    uint32_t first, current;
+    uint8_t low = 0, high = ESP_FLASH_RING_SECTORS - 1, middle;
+    // the first sector is being rewritten, the headers don't tell the order
+    if( ! esp_flash_sector_sequence( ESP_FLASH_RING_START_ADDRESS, log, &first ) )
+        return esp_flash_ring_scan( log, sector_address, sequence );
+    // last sector which is newer than the first one
+    while( low < high ){
+        middle = ( low + high + 1 ) >> 1;
+        if( esp_flash_sector_sequence( ESP_FLASH_RING_START_ADDRESS + middle * ESP_FLASH_RING_SECTOR_SIZE, log, &current ) && ( int32_t ) ( current - first ) >= 0 )
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    ( *sector_address ) = ESP_FLASH_RING_START_ADDRESS + low * ESP_FLASH_RING_SECTOR_SIZE;
+    return esp_flash_sector_sequence( *sector_address, log, sequence );
+}
+
 /**
  * Update flash data
  */
 LOCAL void ICACHE_FLASH_ATTR esp_flash_data_save( uint32_t* data )
 {
-    uint16_t* wear_level = ( uint16_t* ) data;
-    uint16_t current_wear_level = *( wear_level );
-    // swap sectors
-    uint32_t flash_swap = esp_flash_backup_sector_address;
-    esp_flash_backup_sector_address = esp_flash_current_sector_address;
-    esp_flash_current_sector_address = flash_swap;
-    // increase wear level
-    *( wear_level ) = current_wear_level + 1;
+    // move to the next sector of the ring
+    esp_flash_current_sector_address = esp_flash_backup_sector_address;
+    esp_flash_backup_sector_address = esp_flash_ring_next( esp_flash_current_sector_address );
+    // increase the sequence, skipping the values which mark an erased, blank or log sector
+    do {
+        data[ 0 ] ++;
+    } while( data[ 0 ] == 0x00000000 || data[ 0 ] == 0xFFFFFFFF || data[ 0 ] == ESP_FLASH_LOG_MAGIC );
     // update checksum
     data[ ESP_FLASH_SECTOR_LENGTH - 1 ] = esp_flash_compute_checksum( data );
     // erase and save to flash
     spi_flash_erase_sector( esp_flash_current_sector_address >> 12 );
     spi_flash_write( esp_flash_current_sector_address, ( uint32* ) data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) );
+    esp_flash_mmap_stale = 0x01;
+    // the new sector is still in memory, index it
+    esp_flash_index_build( data );
 }
 
 
@@ -151,7 +406,7 @@ LOCAL uint32_t* ICACHE_FLASH_ATTR esp_flash_get_insert_address( uint32_t* segmen
     uint8_t* segment_start = ( uint8_t* ) segment_address;
     uint8_t* parameter_start = segment_start;
     // search for a greater id value
-    while( parameter_start[ 0 ] != 0x00 && parameter_start[ 1 ] != 0x00 ){
+    while( parameter_start[ 0 ] != 0x00 ){
         if( parameter_start[ 0 ] > parameter_id )
             break;
         parameter_start += (( 2 + parameter_start[ 1 ] + 0x3 ) & ( ~0x03 ));
@@ -273,84 +528,632 @@ LOCAL void ICACHE_FLASH_ATTR esp_flash_remove_parameter_update( uint32_t* sector
 
 
 /**
- * Runs the queued actions and updates the flash 
+ * Check that the sector still fits once the actions are applied, returns 0 if it would overflow
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_sector_fits( uint32_t* sector_data, esp_flash_update_item_queue_type* items, uint8_t count )
+{
+	uint32_t* data_start = sector_data + ESP_FLASH_SECTOR_HEADER_SIZE;
+	uint32_t* data_end = sector_data + ESP_FLASH_SECTOR_LENGTH - 1;
+	uint32_t* data_found;
+	uint32_t size;
+	uint8_t i;
+	// the header and the records up to the end marker
+	size = ( uint8_t* ) esp_flash_get_segment_end( data_start ) - ( uint8_t* ) sector_data;
+	for( i = 0; i < count ; i ++ ){
+		if( items[ i ].item_action == ESP_FLASH_QUEUE_NONE )
+			continue;
+		// a saved or removed parameter gives up its record
+		data_found = esp_flash_search_parameter( items[ i ].item_id, data_start, data_end );
+		if( data_found != NULL )
+			size -= ( 2 + ( ( uint8_t* ) data_found )[ 1 ] + 0x3 ) & ( ~0x03 );
+		if( items[ i ].item_action == ESP_FLASH_QUEUE_SAVE )
+			size += ( 2 + items[ i ].item_size + 0x3 ) & ( ~0x03 );
+	}
+	return ( size <= ESP_FLASH_SECTOR_CAPACITY ) ? 0x01 : 0x00;
+}
+
+
+#ifdef ESP_FLASH_LOG_STRUCTURED
+
+/**
+ * Log state, sequence of the current sector and where the next record goes
+ */
+LOCAL uint32_t esp_flash_log_sequence = 0;
+LOCAL uint16_t esp_flash_log_tail = ESP_FLASH_LOG_HEADER_SIZE;
+
+
+/**
+ * Set the index entry of a parameter, keeping the ids sorted
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_index_set( uint8_t parameter_id, uint8_t length, uint16_t offset )
+{
+    esp_flash_index_entry_type* entry = esp_flash_index_search( parameter_id );
+    uint8_t i;
+    // new parameter, shift the greater ids
+    if( entry == NULL ){
+        if( esp_flash_index_fill == ESP_FLASH_INDEX_SIZE )
+            return 0x00;
+        for( i = esp_flash_index_fill; i > 0 && esp_flash_index[ i - 1 ].id > parameter_id ; i -- )
+            esp_flash_index[ i ] = esp_flash_index[ i - 1 ];
+        entry = &( esp_flash_index[ i ] );
+        entry->id = parameter_id;
+        esp_flash_index_fill ++;
+    }
+    entry->length = length;
+    entry->offset = offset;
+    return 0x01;
+}
+
+/**
+ * Drop the index entry of a parameter
  */
-LOCAL void ICACHE_FLASH_ATTR esp_flash_queue_run( void )
+LOCAL void ICACHE_FLASH_ATTR esp_flash_index_remove( uint8_t parameter_id )
 {
+    esp_flash_index_entry_type* entry = esp_flash_index_search( parameter_id );
+    uint8_t i;
+
+    if( entry == NULL )
+        return;
+    esp_flash_index_fill --;
+    for( i = entry - esp_flash_index; i < esp_flash_index_fill ; i ++ )
+        esp_flash_index[ i ] = esp_flash_index[ i + 1 ];
+}
+
+/**
+ * Record checksum, covers the id, flags, length and value
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR esp_flash_log_record_crc( uint8_t* record, uint16_t length )
+{
+    uint32_t crc = esp_crc32_update( ESP_CRC32_INITIAL, record, 4 );
+    return esp_crc32_update( crc, record + ESP_FLASH_LOG_RECORD_HEADER_SIZE, length );
+}
+
+/**
+ * Read a whole record, returns its value length or -1 if it isn't valid
+ */
+LOCAL int16_t ICACHE_FLASH_ATTR esp_flash_log_read_record( uint32_t sector_address, uint16_t offset, uint32_t* record )
+{
+    uint8_t* read_addr = ( uint8_t* ) record;
+    uint16_t length;
+
+    if( SPI_FLASH_RESULT_OK != esp_flash_mmap_read( sector_address + offset, record, ESP_FLASH_LOG_RECORD_HEADER_SIZE ) )
+        return -1;
+    length = read_addr[ 2 ] | ( read_addr[ 3 ] << 8 );
+    if( length > 0xFF || offset + ESP_FLASH_LOG_RECORD_HEADER_SIZE + length > ESP_FLASH_LOG_SECTOR_SIZE )
+        return -1;
+    if( length > 0 && SPI_FLASH_RESULT_OK != esp_flash_mmap_read( sector_address + offset + ESP_FLASH_LOG_RECORD_HEADER_SIZE, record + 2, ( length + 0x3 ) & ( ~0x03 ) ) )
+        return -1;
+    if( record[ 1 ] != esp_flash_log_record_crc( read_addr, length ) )
+        return -1;
+    return length;
+}
+
+#if ESP_FLASH_UPDATE_QUEUE_SIZE > 32
+#error "the batch records are tracked in a 32 bit mask"
+#endif
+
+/**
+ * Replay the current sector into the index and find the end of the log
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_log_scan( void )
+{
+    uint32_t record[ ESP_FLASH_LOG_MAX_RECORD / sizeof( uint32_t ) ];
+    uint8_t* read_addr = ( uint8_t* ) record;
+    uint16_t offset = ESP_FLASH_LOG_HEADER_SIZE, length;
+    int16_t result;
+    esp_flash_index_entry_type batch[ ESP_FLASH_UPDATE_QUEUE_SIZE ];
+    uint32_t batch_removes = 0x00000000;
+    uint16_t batch_fill = 0, count;
+    uint8_t slot;
+
+    esp_flash_index_fill = 0;
+    esp_flash_index_valid = 0x01;
+    while( offset + ESP_FLASH_LOG_RECORD_HEADER_SIZE <= ESP_FLASH_LOG_SECTOR_SIZE ){
+        result = esp_flash_log_read_record( esp_flash_current_sector_address, offset, record );
+        // erased space, end of the log
+        if( record[ 0 ] == 0xFFFFFFFF && record[ 1 ] == 0xFFFFFFFF )
+            break;
+        length = read_addr[ 2 ] | ( read_addr[ 3 ] << 8 );
+        // torn header, nothing after it can be trusted, the next save compacts
+        if( length > 0xFF || offset + ESP_FLASH_LOG_RECORD_HEADER_SIZE + length > ESP_FLASH_LOG_SECTOR_SIZE ){
+            offset = ESP_FLASH_LOG_SECTOR_SIZE;
+            break;
+        }
+        // torn value, skip the record
+        if( result >= 0 ){
+            if( read_addr[ 1 ] == ESP_FLASH_LOG_FLAG_BATCH_VALUE || read_addr[ 1 ] == ESP_FLASH_LOG_FLAG_BATCH_TOMBSTONE ){
+                // hold the last records of the batch until its commit record, older ones are overwritten
+                slot = batch_fill % ESP_FLASH_UPDATE_QUEUE_SIZE;
+                batch[ slot ].id = read_addr[ 0 ];
+                batch[ slot ].length = ( uint8_t ) length;
+                batch[ slot ].offset = offset;
+                if( read_addr[ 1 ] == ESP_FLASH_LOG_FLAG_BATCH_TOMBSTONE )
+                    batch_removes |= 1UL << slot;
+                else
+                    batch_removes &= ~( 1UL << slot );
+                batch_fill ++;
+            } else if( read_addr[ 1 ] == ESP_FLASH_LOG_FLAG_COMMIT ){
+                // the last records are the batch, anything before them is left from a batch which was cut short
+                count = read_addr[ ESP_FLASH_LOG_RECORD_HEADER_SIZE ];
+                if( length == 1 && count <= batch_fill && count <= ESP_FLASH_UPDATE_QUEUE_SIZE ){
+                    for( ; count > 0 ; count -- ){
+                        slot = ( batch_fill - count ) % ESP_FLASH_UPDATE_QUEUE_SIZE;
+                        if( batch_removes & ( 1UL << slot ) ) esp_flash_index_remove( batch[ slot ].id );
+                        else esp_flash_index_set( batch[ slot ].id, batch[ slot ].length, batch[ slot ].offset );
+                    }
+                }
+                batch_fill = 0;
+            } else {
+                batch_fill = 0;
+                if( read_addr[ 1 ] == ESP_FLASH_LOG_FLAG_TOMBSTONE ) esp_flash_index_remove( read_addr[ 0 ] );
+                else esp_flash_index_set( read_addr[ 0 ], ( uint8_t ) length, offset );
+            }
+        }
+        offset += ( ESP_FLASH_LOG_RECORD_HEADER_SIZE + length + 0x3 ) & ( ~0x03 );
+    }
+    esp_flash_log_tail = offset;
+}
+
+/**
+ * Seal a log sector with its header, the sector only counts as a log from then on
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_log_write_header( uint32_t sector_address, uint32_t sequence )
+{
+    uint32_t header[ 2 ];
+
+    header[ 0 ] = ESP_FLASH_LOG_MAGIC;
+    header[ 1 ] = sequence;
+    spi_flash_write( sector_address, ( uint32* ) header, ESP_FLASH_LOG_HEADER_SIZE );
+    esp_flash_mmap_stale = 0x01;
+}
+
+/**
+ * Copy the newest record of every parameter into the spare sector and switch to it. The sector header is
+ * written last, if power fails before that the old sector stays current.
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_log_compact( void )
+{
+    uint32_t record[ ESP_FLASH_LOG_MAX_RECORD / sizeof( uint32_t ) ];
+    uint8_t* read_addr = ( uint8_t* ) record;
+    uint16_t offset = ESP_FLASH_LOG_HEADER_SIZE, size;
+    uint8_t i;
+
+    spi_flash_erase_sector( esp_flash_backup_sector_address >> 12 );
+    for( i = 0; i < esp_flash_index_fill ; i ++ ){
+        if( esp_flash_log_read_record( esp_flash_current_sector_address, esp_flash_index[ i ].offset, record ) < 0 )
+            continue;
+        // committed batch records are copied as plain ones
+        if( read_addr[ 1 ] != ESP_FLASH_LOG_FLAG_VALUE ){
+            read_addr[ 1 ] = ESP_FLASH_LOG_FLAG_VALUE;
+            record[ 1 ] = esp_flash_log_record_crc( read_addr, esp_flash_index[ i ].length );
+        }
+        size = ( ESP_FLASH_LOG_RECORD_HEADER_SIZE + esp_flash_index[ i ].length + 0x3 ) & ( ~0x03 );
+        spi_flash_write( esp_flash_backup_sector_address + offset, ( uint32* ) record, size );
+        esp_flash_mmap_stale = 0x01;
+        esp_flash_index[ i ].offset = offset;
+        offset += size;
+    }
+    esp_flash_log_write_header( esp_flash_backup_sector_address, ++ esp_flash_log_sequence );
+    // move to the next sector of the ring
+    esp_flash_current_sector_address = esp_flash_backup_sector_address;
+    esp_flash_backup_sector_address = esp_flash_ring_next( esp_flash_current_sector_address );
+    esp_flash_log_tail = offset;
+}
+
+/**
+ * Space a record takes in the log
+ */
+#define ESP_FLASH_LOG_RECORD_SIZE( data_size ) ( ( ESP_FLASH_LOG_RECORD_HEADER_SIZE + ( data_size ) + 0x3 ) & ( ~0x03 ) )
+
+/**
+ * Write a record at the end of the log, the caller makes sure it fits
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_log_write_record( uint8_t parameter_id, uint8_t flags, uint8_t* data_src, uint8_t data_size )
+{
+    uint32_t record[ ESP_FLASH_LOG_MAX_RECORD / sizeof( uint32_t ) ];
+    uint8_t* write_addr = ( uint8_t* ) record;
+    uint16_t size = ESP_FLASH_LOG_RECORD_SIZE( data_size );
+    // build the record, padding stays erased
+    os_memset( write_addr, 0xFF, size );
+    write_addr[ 0 ] = parameter_id;
+    write_addr[ 1 ] = flags;
+    write_addr[ 2 ] = data_size;
+    write_addr[ 3 ] = 0x00;
+    if( data_size > 0 )
+        os_memcpy( write_addr + ESP_FLASH_LOG_RECORD_HEADER_SIZE, data_src, data_size );
+    record[ 1 ] = esp_flash_log_record_crc( write_addr, data_size );
+    esp_flash_mmap_stale = 0x01;
+    if( SPI_FLASH_RESULT_OK != spi_flash_write( esp_flash_current_sector_address + esp_flash_log_tail, ( uint32* ) record, size ) )
+        return 0x00;
+    esp_flash_log_tail += size;
+    return 0x01;
+}
+
+/**
+ * Append a record, compacting first if the sector is full
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_log_append( uint8_t parameter_id, uint8_t flags, uint8_t* data_src, uint8_t data_size )
+{
+    uint16_t offset;
+    // a new parameter needs an index entry
+    if( flags != ESP_FLASH_LOG_FLAG_TOMBSTONE && esp_flash_index_search( parameter_id ) == NULL && esp_flash_index_fill == ESP_FLASH_INDEX_SIZE )
+        return 0x00;
+    if( esp_flash_log_tail + ESP_FLASH_LOG_RECORD_SIZE( data_size ) > ESP_FLASH_LOG_SECTOR_SIZE ){
+        esp_flash_log_compact();
+        if( esp_flash_log_tail + ESP_FLASH_LOG_RECORD_SIZE( data_size ) > ESP_FLASH_LOG_SECTOR_SIZE )
+            return 0x00;
+    }
+    offset = esp_flash_log_tail;
+    if( ! esp_flash_log_write_record( parameter_id, flags, data_src, data_size ) )
+        return 0x00;
+
+    if( flags == ESP_FLASH_LOG_FLAG_TOMBSTONE ) esp_flash_index_remove( parameter_id );
+    else esp_flash_index_set( parameter_id, data_size, offset );
+    return 0x01;
+}
+
+/**
+ * Append the queued actions as one batch closed by a commit record, a batch which was cut short doesn't apply.
+ * Returns 0 and leaves the index alone if it doesn't fit.
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_log_append_batch( esp_flash_update_item_queue_type* items, uint8_t count )
+{
+    uint16_t offsets[ ESP_FLASH_UPDATE_QUEUE_SIZE ];
+    uint16_t size = ESP_FLASH_LOG_RECORD_SIZE( 1 );
+    uint8_t i, records = 0, added = 0;
+    // room for the whole batch in this sector
+    for( i = 0; i < count ; i ++ ){
+        if( items[ i ].item_action == ESP_FLASH_QUEUE_SAVE ){
+            size += ESP_FLASH_LOG_RECORD_SIZE( items[ i ].item_size );
+            if( esp_flash_index_search( items[ i ].item_id ) == NULL ) added ++;
+        } else if( items[ i ].item_action == ESP_FLASH_QUEUE_REMOVE && esp_flash_index_search( items[ i ].item_id ) != NULL ){
+            size += ESP_FLASH_LOG_RECORD_SIZE( 0 );
+        }
+    }
+    if( esp_flash_index_fill + added > ESP_FLASH_INDEX_SIZE )
+        return 0x00;
+    if( esp_flash_log_tail + size > ESP_FLASH_LOG_SECTOR_SIZE ){
+        esp_flash_log_compact();
+        if( esp_flash_log_tail + size > ESP_FLASH_LOG_SECTOR_SIZE )
+            return 0x00;
+    }
+    // the records, then the commit
+    for( i = 0; i < count ; i ++ ){
+        offsets[ i ] = esp_flash_log_tail;
+        if( items[ i ].item_action == ESP_FLASH_QUEUE_SAVE ){
+            if( ! esp_flash_log_write_record( items[ i ].item_id, ESP_FLASH_LOG_FLAG_BATCH_VALUE, items[ i ].item_data, items[ i ].item_size ) )
+                return 0x00;
+            records ++;
+        } else if( items[ i ].item_action == ESP_FLASH_QUEUE_REMOVE && esp_flash_index_search( items[ i ].item_id ) != NULL ){
+            if( ! esp_flash_log_write_record( items[ i ].item_id, ESP_FLASH_LOG_FLAG_BATCH_TOMBSTONE, NULL, 0 ) )
+                return 0x00;
+            records ++;
+        } else {
+            offsets[ i ] = 0;
+        }
+    }
+    if( records == 0 )
+        return 0x01;
+    if( ! esp_flash_log_write_record( 0x00, ESP_FLASH_LOG_FLAG_COMMIT, &records, 1 ) )
+        return 0x00;
+    // committed, apply to the index
+    for( i = 0; i < count ; i ++ ){
+        if( offsets[ i ] == 0 ) continue;
+        if( items[ i ].item_action == ESP_FLASH_QUEUE_REMOVE ) esp_flash_index_remove( items[ i ].item_id );
+        else esp_flash_index_set( items[ i ].item_id, items[ i ].item_size, offsets[ i ] );
+    }
+    return 0x01;
+}
+
+/**
+ * Save a parameter as a new record
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_log_save( uint8_t parameter_id, uint8_t* data_src, uint8_t data_size )
+{
+    esp_flash_log_append( parameter_id, ESP_FLASH_LOG_FLAG_VALUE, data_src, data_size );
+}
+
+/**
+ * Remove a parameter by appending a tombstone
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_log_remove( uint8_t parameter_id )
+{
+    if( esp_flash_index_search( parameter_id ) != NULL )
+        esp_flash_log_append( parameter_id, ESP_FLASH_LOG_FLAG_TOMBSTONE, NULL, 0 );
+}
+
+/**
+ * Read the newest value of a parameter
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_log_read( uint8_t parameter_id, uint8_t* dst )
+{
+    uint32_t record[ ESP_FLASH_LOG_MAX_RECORD / sizeof( uint32_t ) ];
+    esp_flash_index_entry_type* entry = esp_flash_index_search( parameter_id );
+
+    if( entry == NULL )
+        return 0x00;
+    if( esp_flash_log_read_record( esp_flash_current_sector_address, entry->offset, record ) != entry->length )
+        return 0x00;
+    os_memcpy( dst, ( uint8_t* ) record + ESP_FLASH_LOG_RECORD_HEADER_SIZE, entry->length );
+    return entry->length;
+}
+
+#endif
+
+
+/**
+ * Drop the queued actions
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_queue_discard( void )
+{
+	uint8_t i;
+	if( esp_flash_commit_timer_set )
+		os_timer_disarm( &esp_flash_commit_timer );
+	for( i = 0 ; i < esp_flash_update_queue_fill ; i ++ ){
+		if( esp_flash_update_queue[ i ].item_data != NULL )
+			os_free( esp_flash_update_queue[ i ].item_data );
+	}
+	esp_flash_update_queue_fill = 0;
+	esp_flash_update_queue_bytes = 0;
+}
+
+/**
+ * Runs the queued actions and updates the flash, all of them or none. Returns 0 if they couldn't be written,
+ * an open transaction is only written by its commit.
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_queue_run( void )
+{
+#ifndef ESP_FLASH_LOG_STRUCTURED
 	uint32_t data[ ESP_FLASH_SECTOR_LENGTH ];	
 	uint8_t i;
-	// check for items in the queue	
-	if( esp_flash_update_queue_fill != 0 ){
-		// read current sector data
-		if( SPI_FLASH_RESULT_OK == spi_flash_read( esp_flash_current_sector_address, ( uint32* ) data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) ){	
-			// runs the actions
-			for( i  = 0 ; i < esp_flash_update_queue_fill ; i ++ ){
-				// remove the parameter		
-				if( esp_flash_update_queue[ i ].item_action == ESP_FLASH_QUEUE_REMOVE ){
-					esp_flash_remove_parameter_update( data, esp_flash_update_queue[ i ].item_id );
-				} else if( esp_flash_update_queue[ i ].item_action == ESP_FLASH_QUEUE_SAVE ){
-					// save parameter			
-					esp_flash_save_parameter_update( data, esp_flash_update_queue[ i ].item_id,  esp_flash_update_queue[ i ].item_data, esp_flash_update_queue[ i ].item_size );
-					// free memory
-					os_free( esp_flash_update_queue[ i ].item_data );
-				}
-			}
-			// apply the updates to flash
-			esp_flash_data_save( data );
-			// reset fill counter
-			esp_flash_update_queue_fill = 0;
+#endif
+	uint8_t result = 0x01;
+	if( esp_flash_transaction_active )
+		return 0x00;
+	// the commit is happening now
+	if( esp_flash_commit_timer_set )
+		os_timer_disarm( &esp_flash_commit_timer );
+	if( esp_flash_update_queue_fill == 0 )
+		return 0x01;
+#ifdef ESP_FLASH_LOG_STRUCTURED
+	// append the actions as one batch
+	result = esp_flash_log_append_batch( esp_flash_update_queue, esp_flash_update_queue_fill );
+#else
+	// read current sector data
+	if( SPI_FLASH_RESULT_OK != esp_flash_mmap_read( esp_flash_current_sector_address, data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) ){
+		result = 0x00;
+	} else if( ! esp_flash_sector_fits( data, esp_flash_update_queue, esp_flash_update_queue_fill ) ){
+		// too much to store, write nothing
+		result = 0x00;
+	} else {
+		// drop the old records first, so the sector never holds more than the final size
+		for( i  = 0 ; i < esp_flash_update_queue_fill ; i ++ ){
+			if( esp_flash_update_queue[ i ].item_action != ESP_FLASH_QUEUE_NONE )
+				esp_flash_remove_parameter_update( data, esp_flash_update_queue[ i ].item_id );
 		}
+		// insert the saved parameters
+		for( i  = 0 ; i < esp_flash_update_queue_fill ; i ++ ){
+			if( esp_flash_update_queue[ i ].item_action == ESP_FLASH_QUEUE_SAVE )
+				esp_flash_insert_parameter( data, esp_flash_update_queue[ i ].item_id,  esp_flash_update_queue[ i ].item_data, esp_flash_update_queue[ i ].item_size );
+		}
+		// apply the updates to flash, the new sector replaces the old one at once
+		esp_flash_data_save( data );
 	}
+#endif
+	// free memory and reset fill counter
+	esp_flash_queue_discard();
+	return result;
+}
+
+/**
+ * Commit timer callback
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_commit_timeout( void* arg )
+{
+	( void ) arg;
+	esp_flash_queue_run();
 }
 
 /**
- * Enables instant update
+ * Schedule the commit after a queued action, right away once the threshold is reached
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_queue_schedule( void )
+{
+	// a transaction is committed by its owner
+	if( esp_flash_transaction_active )
+		return;
+	if( esp_flash_commit_timer_set == 0x00 ){
+		os_timer_setfn( &esp_flash_commit_timer, ( os_timer_func_t* ) esp_flash_commit_timeout, NULL );
+		esp_flash_commit_timer_set = 0x01;
+	}
+	os_timer_disarm( &esp_flash_commit_timer );
+	if( esp_flash_commit_threshold != 0 && esp_flash_update_queue_bytes >= esp_flash_commit_threshold ){
+		os_timer_arm( &esp_flash_commit_timer, 0, 0 );
+	} else if( esp_flash_commit_idle_timeout != 0 ){
+		os_timer_arm( &esp_flash_commit_timer, esp_flash_commit_idle_timeout, 0 );
+	}
+}
+
+/**
+ * Enables instant update, inside a transaction it applies once the transaction ends
  */
 LOCAL void ICACHE_FLASH_ATTR esp_flash_enable_instant_update( void )
 {
+	if( esp_flash_transaction_active ){
+		esp_flash_transaction_instant = 0x01;
+		return;
+	}
 	esp_flash_instant_update = 0x01;
 	esp_flash_queue_run();
 }
 
 /**
- * Disables instant update
+ * Disables instant update, inside a transaction it applies once the transaction ends
  */
 LOCAL void ICACHE_FLASH_ATTR esp_flash_disable_instant_update( void )
 {
+	if( esp_flash_transaction_active ){
+		esp_flash_transaction_instant = 0x00;
+		return;
+	}
 	esp_flash_instant_update = 0x00;
 }
 
 /**
- * Adds a remove action in the queue
+ * Start a transaction, the saves and removes until the commit are written together or not at all.
+ * Updates queued before are committed first. Returns 0 if a transaction is already open, they don't nest.
  */
-LOCAL void ICACHE_FLASH_ATTR esp_flash_queue_remove_parameter( uint8_t parameter_id )
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_transaction_begin( void )
+{
+	if( esp_flash_transaction_active )
+		return 0x00;
+	esp_flash_queue_run();
+	esp_flash_transaction_instant = esp_flash_instant_update;
+	esp_flash_instant_update = 0x00;
+	esp_flash_transaction_active = 0x01;
+	esp_flash_transaction_failed = 0x00;
+	return 0x01;
+}
+
+/**
+ * Write the transaction, returns 0 if nothing was written because it changed more parameters than the queue
+ * holds, ran out of memory or didn't fit in flash
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_transaction_commit( void )
+{
+	uint8_t result = 0x00;
+	if( esp_flash_transaction_active == 0x00 )
+		return 0x00;
+	esp_flash_transaction_active = 0x00;
+	if( esp_flash_transaction_failed )
+		esp_flash_queue_discard();
+	else
+		result = esp_flash_queue_run();
+	esp_flash_instant_update = esp_flash_transaction_instant;
+	return result;
+}
+
+/**
+ * Drop the transaction
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_transaction_abort( void )
+{
+	if( esp_flash_transaction_active == 0x00 )
+		return;
+	esp_flash_transaction_active = 0x00;
+	esp_flash_queue_discard();
+	esp_flash_instant_update = esp_flash_transaction_instant;
+}
+
+/**
+ * Set when queued updates are committed, in milliseconds since the last update and in queued value bytes,
+ * 0 disables either one
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_set_commit_policy( uint32_t idle_timeout, uint16_t threshold )
+{
+	esp_flash_commit_idle_timeout = idle_timeout;
+	esp_flash_commit_threshold = threshold;
+}
+
+/**
+ * Find the queued action for a parameter
+ */
+LOCAL esp_flash_update_item_queue_type* ICACHE_FLASH_ATTR esp_flash_queue_find( uint8_t parameter_id )
 {
-	// check if the queue is full	
-	if( esp_flash_update_queue_fill == ESP_FLASH_UPDATE_QUEUE_SIZE )
+	uint8_t i;
+	for( i = 0 ; i < esp_flash_update_queue_fill ; i ++ ){
+		if( esp_flash_update_queue[ i ].item_id == parameter_id )
+			return &( esp_flash_update_queue[ i ] );
+	}
+	return NULL;
+}
+
+/**
+ * Get the queue entry of a parameter, a new one is taken if there's none
+ */
+LOCAL esp_flash_update_item_queue_type* ICACHE_FLASH_ATTR esp_flash_queue_entry( uint8_t parameter_id )
+{
+	esp_flash_update_item_queue_type* item = esp_flash_queue_find( parameter_id );
+	if( item != NULL )
+		return item;
+	// check if the queue is full, a transaction can't be split
+	if( esp_flash_update_queue_fill == ESP_FLASH_UPDATE_QUEUE_SIZE ){
+		if( esp_flash_transaction_active ){
+			esp_flash_transaction_failed = 0x01;
+			return NULL;
+		}
 		esp_flash_queue_run();
-	// save into queue
-	esp_flash_update_queue[ esp_flash_update_queue_fill ].item_action = ESP_FLASH_QUEUE_REMOVE;
-	esp_flash_update_queue[ esp_flash_update_queue_fill ].item_id = parameter_id;
-	esp_flash_update_queue_fill ++;
+	}
+	item = &( esp_flash_update_queue[ esp_flash_update_queue_fill ++ ] );
+	item->item_id = parameter_id;
+	item->item_action = ESP_FLASH_QUEUE_NONE;
+	item->item_data = NULL;
+	item->item_size = 0;
+	item->item_capacity = 0;
+	return item;
+}
+
+/**
+ * Adds a remove action in the queue, cancels a queued save of the parameter
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_queue_remove_parameter( uint8_t parameter_id )
+{
+	esp_flash_update_item_queue_type* item = esp_flash_queue_entry( parameter_id );
+	if( item == NULL )
+		return;
+	// drop the queued value
+	if( item->item_action == ESP_FLASH_QUEUE_SAVE )
+		esp_flash_update_queue_bytes -= item->item_size;
+	if( item->item_data != NULL )
+		os_free( item->item_data );
+	item->item_data = NULL;
+	item->item_size = 0;
+	item->item_capacity = 0;
+	item->item_action = ESP_FLASH_QUEUE_REMOVE;
+	esp_flash_queue_schedule();
 }
 
 
 /**
- * Add a save action in the queue
+ * Add a save action in the queue, replaces a queued action of the parameter
  */
 LOCAL void ICACHE_FLASH_ATTR esp_flash_queue_save_parameter( uint8_t parameter_id, uint8_t* data_src, uint8_t data_size )
 {
-	// check if the queue is full	
-	if( esp_flash_update_queue_fill == ESP_FLASH_UPDATE_QUEUE_SIZE )
-		esp_flash_queue_run();
-	// save into queue
-	esp_flash_update_queue[ esp_flash_update_queue_fill ].item_action = ESP_FLASH_QUEUE_SAVE;
-	esp_flash_update_queue[ esp_flash_update_queue_fill ].item_id = parameter_id;
-	esp_flash_update_queue[ esp_flash_update_queue_fill ].item_size = data_size;
-	esp_flash_update_queue[ esp_flash_update_queue_fill ].item_data = ( uint8_t* ) os_malloc( data_size );
+	esp_flash_update_item_queue_type* item = esp_flash_queue_entry( parameter_id );
+	uint8_t* data;
+	if( item == NULL )
+		return;
+	// the last value wins, keep its buffer if the new one fits
+	if( item->item_action == ESP_FLASH_QUEUE_SAVE )
+		esp_flash_update_queue_bytes -= item->item_size;
+	if( data_size > item->item_capacity ){
+		data = ( uint8_t* ) os_malloc( data_size );
+		if( data == NULL ){
+			// out of memory, a transaction can't be written in parts
+			if( esp_flash_transaction_active ){
+				esp_flash_transaction_failed = 0x01;
+				return;
+			}
+			// commit the queue and write the value now
+			item->item_action = ESP_FLASH_QUEUE_NONE;
+			esp_flash_queue_run();
+			esp_flash_instant_update = 0x01;
+			esp_flash_save_parameter( parameter_id, data_src, data_size );
+			esp_flash_instant_update = 0x00;
+			return;
+		}
+		if( item->item_data != NULL )
+			os_free( item->item_data );
+		item->item_data = data;
+		item->item_capacity = data_size;
+	}
 	// copy data 
-	os_memcpy( esp_flash_update_queue[ esp_flash_update_queue_fill ].item_data, data_src, data_size );	
-	esp_flash_update_queue_fill ++;
+	if( data_size > 0 )
+		os_memcpy( item->item_data, data_src, data_size );	
+	item->item_size = data_size;
+	item->item_action = ESP_FLASH_QUEUE_SAVE;
+	esp_flash_update_queue_bytes += data_size;
+	esp_flash_queue_schedule();
 }
 
 
@@ -359,16 +1162,10 @@ LOCAL void ICACHE_FLASH_ATTR esp_flash_queue_save_parameter( uint8_t parameter_i
  */
 LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_queue_search( uint8_t parameter_id )
 {
-	uint8_t i = esp_flash_update_queue_fill;
-	// nothing found in the queue	
-	if( esp_flash_update_queue_fill == 0 )
+	esp_flash_update_item_queue_type* item = esp_flash_queue_find( parameter_id );
+	if( item == NULL )
 		return ESP_FLASH_QUEUE_NONE;
-	// search the queue
-	for( i = esp_flash_update_queue_fill - 1 ; i >= 0 ; i -- ){
-		if( esp_flash_update_queue[ i ].item_id == parameter_id )
-			return esp_flash_update_queue[ i ].item_action;
-	}
-	return ESP_FLASH_QUEUE_NONE;
+	return item->item_action;
 }
 
 /**
@@ -376,18 +1173,12 @@ LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_queue_search( uint8_t parameter_id )
  */
 LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_queue_read_value( uint8_t parameter_id, uint8_t* data_src )
 {
-	uint8_t i;
-	// nothing found in the queue	
-	if( esp_flash_update_queue_fill == 0 ) 
-		return 0;
-	// search the queue
-	for( i = esp_flash_update_queue_fill - 1 ; i >= 0 ; i -- ){
-		if( esp_flash_update_queue[ i ].item_id == parameter_id ){
-			os_memcpy( data_src, esp_flash_update_queue[ i ].item_data, esp_flash_update_queue[ i ].item_size );
-			return esp_flash_update_queue[ i ].item_size;
-		}
-	}
-	return 0x00;	
+	esp_flash_update_item_queue_type* item = esp_flash_queue_find( parameter_id );
+	if( item == NULL || item->item_action != ESP_FLASH_QUEUE_SAVE )
+		return 0x00;
+	if( item->item_size > 0 )
+		os_memcpy( data_src, item->item_data, item->item_size );
+	return item->item_size;
 }
 
 
@@ -403,95 +1194,149 @@ LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_queue_read_value( uint8_t parameter_id
 LOCAL void ICACHE_FLASH_ATTR esp_flash_initialize_sector( uint32_t sector_address )
 {
     uint32_t sector_data[ ESP_FLASH_SECTOR_LENGTH ];
-    uint32_t config_flags = ESP_FLASH_DEFAULT_CONFIG_FLAGS;
-    uint16_t wear_level = 0x0001;
     // zero all data
     os_memset( ( uint8_t* ) sector_data, 0x00, ( uint16_t )( ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) );   
-    // copy header data
-    os_memcpy( ( uint16_t* ) sector_data, ( uint16_t* ) &wear_level, sizeof( wear_level ) / sizeof( uint16_t ) );
-    os_memcpy( ( uint8_t* )( sector_data + 1 ), &config_flags, sizeof( config_flags ) );
+    // header data, first sequence and config flags
+    sector_data[ 0 ] = 0x00000001;
+    sector_data[ 1 ] = ESP_FLASH_DEFAULT_CONFIG_FLAGS;
     // seal with checksum
     sector_data[ ESP_FLASH_SECTOR_LENGTH - 1 ] = esp_flash_compute_checksum( sector_data );
     // erase and flash
     spi_flash_erase_sector( sector_address >> 12 );
     spi_flash_write( sector_address, ( uint32* ) sector_data, ( uint16_t )( ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) );
+    esp_flash_mmap_stale = 0x01;
 }
 
 
 
 /**
- * Checks flash data integrity
+ * Checks flash data integrity, returns 0 if the newest sector was damaged or nothing was stored
  */
 LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_verify_data( void )
 {
-    uint8_t flash_fail = 0x01;
-    uint16_t primary_order = 0x0000, secondary_order = 0x0000;
-    uint32_t sector_data[ ESP_FLASH_SECTOR_LENGTH ];
-    uint16_t* data_pnt = ( uint16_t* ) sector_data;
-    // check primary sector
-    if( SPI_FLASH_RESULT_OK == spi_flash_read( ESP_FLASH_PRIMARY_SECTOR_ADDRESS, ( uint32* ) sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) ){
-        if( ! esp_flash_verify_checksum( sector_data ) ) {
-            flash_fail = 0x00;
-        } else {
-            primary_order = *( data_pnt );
+    uint32_t sector_address, sequence;
+    // newest sector from the headers
+    if( esp_flash_ring_find( 0x00, &sector_address, &sequence ) ){
+        if( esp_flash_verify_sector( sector_address ) ){
+            esp_flash_current_sector_address = sector_address;
+            esp_flash_backup_sector_address = esp_flash_ring_next( sector_address );
+            return 0x01;
         }
-    } else {
-        flash_fail = 0x00;
     }
-    // check secondary sector
-    if( SPI_FLASH_RESULT_OK == spi_flash_read( ESP_FLASH_SECONDARY_SECTOR_ADDRESS, ( uint32* ) sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) ){
-        if( ! esp_flash_verify_checksum( sector_data ) ) {
-            flash_fail = 0x00;
-        } else {
-            secondary_order = *( data_pnt );
-        }
-    } else {
-        flash_fail = 0x00;
-    }
-    // save primary and secondary sectors
-    if( primary_order != 0x0000 && primary_order != 0xFFFF ){
-        if( secondary_order != 0x0000 && secondary_order != 0xFFFF ){
-            if( primary_order > secondary_order ) {
-                esp_flash_current_sector_address = ESP_FLASH_PRIMARY_SECTOR_ADDRESS;
-                esp_flash_backup_sector_address = ESP_FLASH_SECONDARY_SECTOR_ADDRESS;
-            } else {
-                esp_flash_current_sector_address = ESP_FLASH_SECONDARY_SECTOR_ADDRESS;
-                esp_flash_backup_sector_address = ESP_FLASH_PRIMARY_SECTOR_ADDRESS;
-            }                
-        } else {
-            esp_flash_current_sector_address = ESP_FLASH_PRIMARY_SECTOR_ADDRESS;
-            // corrupted, will repair at next parameter update
-            esp_flash_backup_sector_address = ESP_FLASH_SECONDARY_SECTOR_ADDRESS;
-        }
-    } else if( secondary_order != 0x0000 && secondary_order != 0xFFFF ){
-        esp_flash_current_sector_address = ESP_FLASH_SECONDARY_SECTOR_ADDRESS;
-        // corrupted
-        esp_flash_backup_sector_address = ESP_FLASH_PRIMARY_SECTOR_ADDRESS;
+    // torn or corrupted, fall back to the newest sector which passes the checksum
+    if( esp_flash_ring_scan( 0x00, &sector_address, &sequence ) ){
+        esp_flash_current_sector_address = sector_address;
+        esp_flash_backup_sector_address = esp_flash_ring_next( sector_address );
+        return 0x00;
+    }
+    // uninitialized or corrupted, initialize the first sector
+    esp_flash_current_sector_address = ESP_FLASH_RING_START_ADDRESS;
+    esp_flash_backup_sector_address = esp_flash_ring_next( esp_flash_current_sector_address );
+    esp_flash_initialize_sector( esp_flash_current_sector_address );
+    return 0x00;
+}
+
+
+
+#ifdef ESP_FLASH_LOG_STRUCTURED
+
+/**
+ * Move the parameters of a sorted sector into a new log in the given sector. The header is written after the
+ * records, if power fails before that there is still no log and the next boot migrates again.
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_log_migrate( uint32_t sector_address, uint32_t* sector_data )
+{
+    uint8_t* parameter_start = ( uint8_t* ) ( sector_data + ESP_FLASH_SECTOR_HEADER_SIZE );
+    uint8_t* data_end = ( uint8_t* ) ( sector_data + ESP_FLASH_SECTOR_LENGTH - 1 );
+    uint16_t offset;
+
+    spi_flash_erase_sector( sector_address >> 12 );
+    esp_flash_mmap_stale = 0x01;
+    esp_flash_current_sector_address = sector_address;
+    esp_flash_backup_sector_address = esp_flash_ring_next( sector_address );
+    esp_flash_index_fill = 0;
+    esp_flash_index_valid = 0x01;
+    esp_flash_log_tail = ESP_FLASH_LOG_HEADER_SIZE;
+    while( parameter_start < data_end && parameter_start[ 0 ] != 0x00 ){
+        // records are larger than sorted entries, the ones past the sector or the index are dropped
+        offset = esp_flash_log_tail;
+        if( esp_flash_index_fill < ESP_FLASH_INDEX_SIZE && offset + ESP_FLASH_LOG_RECORD_SIZE( parameter_start[ 1 ] ) <= ESP_FLASH_LOG_SECTOR_SIZE &&
+            esp_flash_log_write_record( parameter_start[ 0 ], ESP_FLASH_LOG_FLAG_VALUE, parameter_start + 2, parameter_start[ 1 ] ) )
+            esp_flash_index_set( parameter_start[ 0 ], parameter_start[ 1 ], offset );
+        parameter_start += (( 2 + parameter_start[ 1 ] + 0x3 ) & ( ~0x03 ));
+    }
+    esp_flash_log_sequence = 1;
+    esp_flash_log_write_header( sector_address, esp_flash_log_sequence );
+}
+
+/**
+ * Find the current log sector, starts one from the sorted layout when there is none
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_log_setup( void )
+{
+    uint32_t sector_data[ ESP_FLASH_SECTOR_LENGTH ];
+    uint32_t sector_address, sequence;
+
+    if( esp_flash_ring_find( 0x01, &sector_address, &esp_flash_log_sequence ) ){
+        esp_flash_current_sector_address = sector_address;
+        esp_flash_backup_sector_address = esp_flash_ring_next( sector_address );
+        esp_flash_log_scan();
+        return 0x01;
+    }
+    // no log yet, keep the parameters of the newest sorted sector and leave it untouched until the log is sealed
+    os_memset( sector_data, 0x00, ESP_FLASH_LOG_SECTOR_SIZE );
+    if( esp_flash_ring_scan( 0x00, &sector_address, &sequence ) ){
+        if( SPI_FLASH_RESULT_OK != spi_flash_read( sector_address, ( uint32* ) sector_data, ESP_FLASH_LOG_SECTOR_SIZE ) || ! esp_flash_verify_checksum( sector_data ) )
+            os_memset( sector_data, 0x00, ESP_FLASH_LOG_SECTOR_SIZE );
+        sector_address = esp_flash_ring_next( sector_address );
     } else {
-        // both uninitialized or corrupted, initialize primary
-        esp_flash_current_sector_address = ESP_FLASH_PRIMARY_SECTOR_ADDRESS;
-        esp_flash_backup_sector_address = ESP_FLASH_SECONDARY_SECTOR_ADDRESS;
-        esp_flash_initialize_sector( esp_flash_current_sector_address );
+        // blank flash, there is no sorted sector to keep
+        sector_address = ESP_FLASH_RING_START_ADDRESS;
     }
-    return flash_fail;
+    esp_flash_log_migrate( sector_address, sector_data );
+    return 0x00;
 }
 
+#endif
+
 
 
 /**
- * Find parameter and it's value, returns parameter length
+ * Find parameter by scanning the whole sector, returns parameter length
  */
-LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_read_parameter( uint8_t parameter_id, uint8_t* dst )
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_read_parameter_sector( uint8_t parameter_id, uint8_t* dst )
 {
 	uint8_t* read_addr;
-	uint8_t data_size = 0x00, parameter_size;
+	uint8_t data_size = 0x00;
 	uint32_t sector_data[ ESP_FLASH_SECTOR_LENGTH ];
 	uint32_t* data_start;
 	uint32_t* data_end = sector_data + ESP_FLASH_SECTOR_LENGTH - 1;
 	uint32_t* data_found = NULL;
 	// read current sector data
-	if( SPI_FLASH_RESULT_OK != spi_flash_read( esp_flash_current_sector_address, ( uint32* ) sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) )
+	if( SPI_FLASH_RESULT_OK != esp_flash_mmap_read( esp_flash_current_sector_address, sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) )
 		return data_size;
+	// iterate and find parameter
+	data_start = sector_data + ESP_FLASH_SECTOR_HEADER_SIZE;
+	data_found = esp_flash_search_parameter( parameter_id, data_start, data_end );
+	// check if parameter exists 
+	if( data_found != NULL ) {
+		read_addr = ( uint8_t* ) data_found;
+		data_size = read_addr[ 1 ];
+		// copy data into the given memory space
+		os_memcpy( dst, read_addr + 2, data_size );
+	}
+	return data_size;
+}
+
+/**
+ * Find parameter and it's value, returns parameter length
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_read_parameter( uint8_t parameter_id, uint8_t* dst )
+{
+	uint32_t record[ ESP_FLASH_PARAMETER_MAX_RECORD / sizeof( uint32_t ) ];
+	esp_flash_index_entry_type* entry;
+	uint8_t* read_addr = ( uint8_t* ) record;
+	uint8_t data_size;
 	// check queue for parameters	
 	if( esp_flash_instant_update == 0x00 ){
 		data_size = esp_flash_queue_search( parameter_id );
@@ -504,17 +1349,22 @@ LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_read_parameter( uint8_t parameter_id,
 			return data_size;
 		} 
 	}
-	// iterate and find parameter
-	data_start = sector_data + ESP_FLASH_SECTOR_HEADER_SIZE;
-	data_found = esp_flash_search_parameter( parameter_id, data_start, data_end );
-	// check if parameter exists 
-	if( data_found != NULL ) {
-		read_addr = ( uint8_t* ) data_found;
-		data_size = read_addr[ 1 ];
-		// copy data into the given memory space
-		os_memcpy( dst, read_addr + 2, data_size );
-	}
-	return data_size;
+#ifdef ESP_FLASH_LOG_STRUCTURED
+	return esp_flash_log_read( parameter_id, dst );
+#endif
+	if( esp_flash_index_valid == 0x00 )
+		return esp_flash_read_parameter_sector( parameter_id, dst );
+	// look up the index and read only the parameter record
+	entry = esp_flash_index_search( parameter_id );
+	if( entry == NULL )
+		return 0x00;
+	if( SPI_FLASH_RESULT_OK != esp_flash_mmap_read( esp_flash_current_sector_address + entry->offset, record, ( 2 + entry->length + 0x3 ) & ( ~0x03 ) ) )
+		return 0x00;
+	// the sector changed behind the index
+	if( read_addr[ 0 ] != parameter_id || read_addr[ 1 ] != entry->length )
+		return esp_flash_read_parameter_sector( parameter_id, dst );
+	os_memcpy( dst, read_addr + 2, entry->length );
+	return entry->length;
 }
 
 
@@ -527,13 +1377,22 @@ LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_read_parameter( uint8_t parameter_id,
 LOCAL void ICACHE_FLASH_ATTR esp_flash_save_parameter( uint8_t parameter_id, uint8_t* data_src, uint8_t data_size )
 {
 	uint32_t sector_data[ ESP_FLASH_SECTOR_LENGTH ];
+	esp_flash_update_item_queue_type item;
 	// check if instant update is enabled
 	if( esp_flash_instant_update == 0x00 ){
 		// add parameter into queue
 		esp_flash_queue_save_parameter( parameter_id, data_src, data_size );
 	} else {
+#ifdef ESP_FLASH_LOG_STRUCTURED
+		esp_flash_log_save( parameter_id, data_src, data_size );
+		return;
+#endif
 		// read current sector data
-		if( SPI_FLASH_RESULT_OK == spi_flash_read( esp_flash_current_sector_address, ( uint32* ) sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) ){
+		item.item_id = parameter_id;
+		item.item_action = ESP_FLASH_QUEUE_SAVE;
+		item.item_size = data_size;
+		if( SPI_FLASH_RESULT_OK == esp_flash_mmap_read( esp_flash_current_sector_address, sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) &&
+		    esp_flash_sector_fits( sector_data, &item, 1 ) ){
 			// update the parameter
 			esp_flash_save_parameter_update( sector_data, parameter_id, data_src, data_size );
 			// write to flash
@@ -555,8 +1414,12 @@ LOCAL void ICACHE_FLASH_ATTR esp_flash_remove_parameter( uint8_t parameter_id )
 		// save the action into queue
 		esp_flash_queue_remove_parameter( parameter_id );
 	} else {
+#ifdef ESP_FLASH_LOG_STRUCTURED
+		esp_flash_log_remove( parameter_id );
+		return;
+#endif
 		// read current sector data
-		if( SPI_FLASH_RESULT_OK == spi_flash_read( esp_flash_current_sector_address, ( uint32* ) sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) ){
+		if( SPI_FLASH_RESULT_OK == esp_flash_mmap_read( esp_flash_current_sector_address, sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) ){
 			// remove parameter
 			esp_flash_remove_parameter_update( sector_data, parameter_id );
 			// write to flash
@@ -572,9 +1435,380 @@ LOCAL void ICACHE_FLASH_ATTR esp_flash_remove_parameter( uint8_t parameter_id )
  */
 LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_setup( void )
 {
-    esp_flash_verify_data();
+    uint32_t sector_data[ ESP_FLASH_SECTOR_LENGTH ];
+    uint8_t result;
+#ifdef ESP_FLASH_LOG_STRUCTURED
+    result = esp_flash_log_setup();
+    esp_flash_mmap_setup();
+    return result;
+#endif
+    result = esp_flash_verify_data();
+    // index the current sector once, saves keep it up to date
+    esp_flash_index_valid = 0x00;
+    if( SPI_FLASH_RESULT_OK == spi_flash_read( esp_flash_current_sector_address, ( uint32* ) sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) )
+        esp_flash_index_build( sector_data );
+    esp_flash_mmap_setup();
+    return result;
+}
+
+
+
+/**
+ * Copy a value into its schema field, returns 0 if it doesn't fit the field
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_schema_set( const esp_flash_schema_entry_type* entry, uint8_t* values, const uint8_t* value, uint8_t size )
+{
+    uint8_t* field = values + entry->offset;
+    // strings keep room for the terminator
+    if( entry->type == ESP_FLASH_SCHEMA_STRING ? size >= entry->size : size != entry->size )
+        return 0x00;
+    os_memset( field, 0x00, entry->size );
+    if( size > 0 )
+        os_memcpy( field, value, size );
+    return 0x01;
 }
 
+/**
+ * Load every parameter of the schema into values, call after esp_flash_setup. Parameters which are missing or
+ * don't fit their field get the default, and the defaults are saved together. Inside an open transaction the
+ * stored values are loaded and the defaults are only kept in RAM. Returns the number of defaults used.
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_schema_load( const esp_flash_schema_entry_type* schema, uint8_t count, uint8_t* values )
+{
+#ifdef ESP_FLASH_LOG_STRUCTURED
+    uint8_t value[ 0xFF ];
+    esp_flash_index_entry_type* entry;
+    uint8_t size;
+#else
+    uint32_t sector_data[ ESP_FLASH_SECTOR_LENGTH ];
+    esp_flash_update_item_queue_type item;
+    uint8_t* found;
+    uint8_t save = 0x00;
+#endif
+    uint8_t i, defaults = 0, store;
+    // queued updates are part of the stored values, an open transaction is left to its owner
+#ifdef ESP_FLASH_LOG_STRUCTURED
+    // the transaction commits them first, then appends the defaults as one batch
+    store = esp_flash_transaction_begin();
+#else
+    store = ! esp_flash_transaction_active;
+    esp_flash_queue_run();
+    // one read of the sector, the defaults go into the same copy
+    if( SPI_FLASH_RESULT_OK != esp_flash_mmap_read( esp_flash_current_sector_address, sector_data, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) ) )
+        os_memset( sector_data, 0x00, ESP_FLASH_SECTOR_LENGTH * sizeof( uint32_t ) );
+#endif
+    for( i = 0; i < count ; i ++ ){
+#ifdef ESP_FLASH_LOG_STRUCTURED
+        // a stored empty value is present too, only the index tells it from a missing one
+        entry = esp_flash_index_search( schema[ i ].id );
+        size = esp_flash_log_read( schema[ i ].id, value );
+        if( entry != NULL && size == entry->length && esp_flash_schema_set( &( schema[ i ] ), values, value, size ) )
+            continue;
+#else
+        found = ( uint8_t* ) esp_flash_search_parameter( schema[ i ].id, sector_data + ESP_FLASH_SECTOR_HEADER_SIZE, sector_data + ESP_FLASH_SECTOR_LENGTH - 1 );
+        if( found != NULL && esp_flash_schema_set( &( schema[ i ] ), values, found + 2, found[ 1 ] ) )
+            continue;
+#endif
+        esp_flash_schema_set( &( schema[ i ] ), values, ( const uint8_t* ) schema[ i ].default_value, schema[ i ].default_size );
+        defaults ++;
+        // an empty value reads back the same as a missing one
+        if( schema[ i ].default_size == 0 || ! store )
+            continue;
+#ifdef ESP_FLASH_LOG_STRUCTURED
+        esp_flash_queue_save_parameter( schema[ i ].id, ( uint8_t* ) schema[ i ].default_value, schema[ i ].default_size );
+#else
+        // a default which doesn't fit the sector is only kept in RAM
+        item.item_id = schema[ i ].id;
+        item.item_action = ESP_FLASH_QUEUE_SAVE;
+        item.item_size = schema[ i ].default_size;
+        if( ! esp_flash_sector_fits( sector_data, &item, 1 ) )
+            continue;
+        esp_flash_save_parameter_update( sector_data, schema[ i ].id, ( uint8_t* ) schema[ i ].default_value, schema[ i ].default_size );
+        save = 0x01;
+#endif
+    }
+#ifdef ESP_FLASH_LOG_STRUCTURED
+    if( store )
+        esp_flash_transaction_commit();
+#else
+    // one sector write for all the defaults
+    if( save )
+        esp_flash_data_save( sector_data );
+#endif
+    return defaults;
+}
 
+#if ESP_FLASH_BLOB_SECTORS > 32
+#error "the blob area is tracked in a 32 bit mask"
 #endif
 
+/**
+ * Sequence of the next blob, and the sector after the newest one where the next free space is looked up so
+ * rewrites move around the area
+ */
+LOCAL uint32_t esp_flash_blob_sequence = 0;
+LOCAL uint8_t esp_flash_blob_cursor = 0;
+
+/**
+ * Number of sectors a blob takes, length must fit the area
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_sectors( uint32_t length )
+{
+    return ( sizeof( esp_flash_blob_header_type ) + length + ESP_FLASH_BLOB_SECTOR_SIZE - 1 ) / ESP_FLASH_BLOB_SECTOR_SIZE;
+}
+
+/**
+ * Read the header of a blob starting at the given sector, returns 0 if no blob starts there
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_header_read( uint8_t sector, esp_flash_blob_header_type* header )
+{
+    if( SPI_FLASH_RESULT_OK != spi_flash_read( ESP_FLASH_BLOB_START_ADDRESS + sector * ESP_FLASH_BLOB_SECTOR_SIZE, ( uint32* ) header, sizeof( esp_flash_blob_header_type ) ) )
+        return 0x00;
+    if( header->magic != ESP_FLASH_BLOB_MAGIC || header->length > ESP_FLASH_BLOB_SECTORS * ESP_FLASH_BLOB_SECTOR_SIZE - sizeof( esp_flash_blob_header_type ) )
+        return 0x00;
+    return ( sector + esp_flash_blob_sectors( header->length ) <= ESP_FLASH_BLOB_SECTORS ) ? 0x01 : 0x00;
+}
+
+/**
+ * Walk the blob area, returns the mask of sectors taken by live blobs and finds the newest blob with the given id
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR esp_flash_blob_scan( uint32_t blob_id, uint32_t* blob_address, esp_flash_blob_header_type* blob_header )
+{
+    esp_flash_blob_header_type header;
+    uint32_t used = 0x00000000, newest = 0x00000000;
+    uint8_t sector = 0, sectors, found = 0x00;
+
+    ( *blob_address ) = 0x00000000;
+    while( sector < ESP_FLASH_BLOB_SECTORS ){
+        if( ! esp_flash_blob_header_read( sector, &header ) ){
+            sector ++;
+            continue;
+        }
+        sectors = esp_flash_blob_sectors( header.length );
+        // continue after the newest blob
+        if( ! found || ( int32_t ) ( header.sequence - newest ) > 0 ){
+            newest = header.sequence;
+            found = 0x01;
+            esp_flash_blob_sequence = newest + 1;
+            esp_flash_blob_cursor = ( sector + sectors ) % ESP_FLASH_BLOB_SECTORS;
+        }
+        if( header.state == 0xFFFFFFFF ){
+            used |= ( ( sectors == 32 ) ? 0xFFFFFFFF : ( ( 1UL << sectors ) - 1 ) ) << sector;
+            if( header.id == blob_id && ( ( *blob_address ) == 0x00000000 || ( int32_t ) ( header.sequence - blob_header->sequence ) > 0 ) ){
+                ( *blob_address ) = ESP_FLASH_BLOB_START_ADDRESS + sector * ESP_FLASH_BLOB_SECTOR_SIZE;
+                os_memcpy( blob_header, &header, sizeof( esp_flash_blob_header_type ) );
+            }
+        }
+        sector += sectors;
+    }
+    return used;
+}
+
+/**
+ * Mark every live copy of a blob as removed, except the one at keep_address
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_blob_retire( uint16_t blob_id, uint32_t keep_address )
+{
+    esp_flash_blob_header_type header;
+    uint32_t address, removed = 0x00000000;
+    uint8_t sector = 0;
+
+    while( sector < ESP_FLASH_BLOB_SECTORS ){
+        if( ! esp_flash_blob_header_read( sector, &header ) ){
+            sector ++;
+            continue;
+        }
+        address = ESP_FLASH_BLOB_START_ADDRESS + sector * ESP_FLASH_BLOB_SECTOR_SIZE;
+        if( header.state == 0xFFFFFFFF && header.id == blob_id && address != keep_address )
+            spi_flash_write( address + 5 * sizeof( uint32_t ), &removed, sizeof( uint32_t ) );
+        sector += esp_flash_blob_sectors( header.length );
+    }
+}
+
+/**
+ * Start writing a blob, finds free sectors for it. Returns 0 if the area has no room.
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_write_begin( esp_flash_blob_writer_type* writer, uint16_t blob_id, uint32_t length )
+{
+    esp_flash_blob_header_type header;
+    uint32_t used, address, mask;
+    uint8_t i, sector;
+
+    if( length > ESP_FLASH_BLOB_SECTORS * ESP_FLASH_BLOB_SECTOR_SIZE - sizeof( esp_flash_blob_header_type ) )
+        return 0x00;
+    writer->sectors = esp_flash_blob_sectors( length );
+    used = esp_flash_blob_scan( 0xFFFFFFFF, &address, &header );
+    // first free run from the cursor on
+    mask = ( writer->sectors == 32 ) ? 0xFFFFFFFF : ( ( 1UL << writer->sectors ) - 1 );
+    for( i = 0; i < ESP_FLASH_BLOB_SECTORS ; i ++ ){
+        sector = ( esp_flash_blob_cursor + i ) % ESP_FLASH_BLOB_SECTORS;
+        if( sector + writer->sectors <= ESP_FLASH_BLOB_SECTORS && ( used & ( mask << sector ) ) == 0 )
+            break;
+    }
+    if( i == ESP_FLASH_BLOB_SECTORS )
+        return 0x00;
+
+    writer->address = ESP_FLASH_BLOB_START_ADDRESS + sector * ESP_FLASH_BLOB_SECTOR_SIZE;
+    writer->length = length;
+    writer->written = 0;
+    writer->crc = ESP_CRC32_INITIAL;
+    writer->pending = 0xFFFFFFFF;
+    writer->id = blob_id;
+    writer->erased = 0;
+    return 0x01;
+}
+
+/**
+ * Write whole words of blob data at the given data offset, sectors are erased as the data reaches them
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_program( esp_flash_blob_writer_type* writer, uint32_t offset, uint32_t* data, uint16_t size )
+{
+    uint32_t address = writer->address + sizeof( esp_flash_blob_header_type ) + offset;
+    uint8_t last = ( address + size - 1 - writer->address ) / ESP_FLASH_BLOB_SECTOR_SIZE;
+
+    for( ; writer->erased <= last ; writer->erased ++ )
+        spi_flash_erase_sector( ( writer->address >> 12 ) + writer->erased );
+    return ( SPI_FLASH_RESULT_OK == spi_flash_write( address, data, size ) ) ? 0x01 : 0x00;
+}
+
+/**
+ * Append blob data, any size from any buffer. Returns 0 if it runs past the length given at the start.
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_write( esp_flash_blob_writer_type* writer, uint8_t* data_src, uint16_t data_size )
+{
+    uint32_t chunk[ ESP_FLASH_BLOB_CHUNK ];
+    uint8_t* chunk_data = ( uint8_t* ) chunk;
+    uint32_t base;
+    uint16_t fill, step, whole;
+
+    if( data_size > writer->length - writer->written )
+        return 0x00;
+    writer->crc = esp_crc32_update( writer->crc, data_src, data_size );
+    while( data_size > 0 ){
+        // the chunk starts with the bytes of a word which wasn't complete yet
+        base = writer->written & ( ~0x03 );
+        fill = writer->written & 0x03;
+        os_memcpy( chunk_data, &( writer->pending ), fill );
+        step = sizeof( chunk ) - fill;
+        if( step > data_size ) step = data_size;
+        os_memcpy( chunk_data + fill, data_src, step );
+        data_src += step;
+        data_size -= step;
+        writer->written += step;
+        fill += step;
+        whole = fill & ( ~0x03 );
+        if( whole != fill ){
+            if( writer->written == writer->length ){
+                // pad the last word
+                os_memset( chunk_data + fill, 0xFF, whole + 4 - fill );
+                whole += 4;
+            } else {
+                writer->pending = 0xFFFFFFFF;
+                os_memcpy( &( writer->pending ), chunk_data + whole, fill - whole );
+            }
+        }
+        if( whole > 0 && ! esp_flash_blob_program( writer, base, chunk, whole ) )
+            return 0x00;
+    }
+    return 0x01;
+}
+
+/**
+ * Seal the blob once all of its data was written, older copies are removed afterwards
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_write_end( esp_flash_blob_writer_type* writer )
+{
+    esp_flash_blob_header_type header;
+
+    if( writer->written != writer->length )
+        return 0x00;
+    // an empty blob has no data which erased the sector
+    if( writer->erased == 0 ){
+        spi_flash_erase_sector( writer->address >> 12 );
+        writer->erased = 1;
+    }
+    header.magic = ESP_FLASH_BLOB_MAGIC;
+    header.id = writer->id;
+    header.length = writer->length;
+    header.crc = writer->crc;
+    header.sequence = esp_flash_blob_sequence ++;
+    // the fields first, the magic makes the blob valid
+    if( SPI_FLASH_RESULT_OK != spi_flash_write( writer->address + sizeof( uint32_t ), &( header.id ), 4 * sizeof( uint32_t ) ) )
+        return 0x00;
+    if( SPI_FLASH_RESULT_OK != spi_flash_write( writer->address, &( header.magic ), sizeof( uint32_t ) ) )
+        return 0x00;
+    esp_flash_blob_cursor = ( ( writer->address - ESP_FLASH_BLOB_START_ADDRESS ) / ESP_FLASH_BLOB_SECTOR_SIZE + writer->sectors ) % ESP_FLASH_BLOB_SECTORS;
+    esp_flash_blob_retire( writer->id, writer->address );
+    return 0x01;
+}
+
+/**
+ * Open the newest copy of a blob for reading, returns 0 if there's none
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_open( esp_flash_blob_reader_type* reader, uint16_t blob_id )
+{
+    esp_flash_blob_header_type header;
+    uint32_t address;
+
+    esp_flash_blob_scan( blob_id, &address, &header );
+    if( address == 0x00000000 )
+        return 0x00;
+    reader->address = address + sizeof( esp_flash_blob_header_type );
+    reader->length = header.length;
+    reader->position = 0;
+    reader->crc = header.crc;
+    return 0x01;
+}
+
+/**
+ * Read the next bytes of the blob, returns how many were read
+ */
+LOCAL uint16_t ICACHE_FLASH_ATTR esp_flash_blob_read( esp_flash_blob_reader_type* reader, uint8_t* dst, uint16_t size )
+{
+    uint32_t chunk[ ESP_FLASH_BLOB_CHUNK ];
+    uint16_t done = 0, step, skip;
+
+    if( size > reader->length - reader->position )
+        size = reader->length - reader->position;
+    while( done < size ){
+        // flash reads are word aligned
+        skip = reader->position & 0x03;
+        step = sizeof( chunk ) - skip;
+        if( step > size - done ) step = size - done;
+        if( SPI_FLASH_RESULT_OK != spi_flash_read( reader->address + ( reader->position & ( ~0x03 ) ), ( uint32* ) chunk, ( skip + step + 0x03 ) & ( ~0x03 ) ) )
+            break;
+        os_memcpy( dst + done, ( uint8_t* ) chunk + skip, step );
+        done += step;
+        reader->position += step;
+    }
+    return done;
+}
+
+/**
+ * Check the blob data against its checksum, doesn't move the read position
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_verify( esp_flash_blob_reader_type* reader )
+{
+    uint32_t chunk[ ESP_FLASH_BLOB_CHUNK ];
+    uint32_t crc = ESP_CRC32_INITIAL, offset, step;
+
+    for( offset = 0; offset < reader->length ; offset += step ){
+        step = reader->length - offset;
+        if( step > sizeof( chunk ) ) step = sizeof( chunk );
+        if( SPI_FLASH_RESULT_OK != spi_flash_read( reader->address + offset, ( uint32* ) chunk, ( step + 0x03 ) & ( ~0x03 ) ) )
+            return 0x00;
+        crc = esp_crc32_update( crc, ( uint8_t* ) chunk, step );
+    }
+    return ( crc == reader->crc ) ? 0x01 : 0x00;
+}
+
+/**
+ * Remove a blob, its sectors are reused by later writes
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_flash_blob_remove( uint16_t blob_id )
+{
+    esp_flash_blob_retire( blob_id, 0x00000000 );
+}
+
+
+#endif
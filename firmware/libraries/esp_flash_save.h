@@ -9,6 +9,8 @@
 #ifndef __ESP_FLASH_PARAMETER_SAVE__
 #define __ESP_FLASH_PARAMETER_SAVE__
 
+#include <stddef.h>
+
 #include "user_interface.h"
 
 #include "osapi.h"
@@ -22,7 +24,149 @@
 
 #define ESP_FLASH_DEFAULT_CONFIG_FLAGS 0x00000000
 
+/**
+ * Bytes of the sorted sector for the header and the parameters, a zero word marks their end before the checksum
+ */
+#define ESP_FLASH_SECTOR_CAPACITY ( ( ESP_FLASH_SECTOR_LENGTH - 2 ) * 4 )
+
+/**
+ * Words read at a time when verifying the checksum of a sector in flash
+ */
+#define ESP_FLASH_VERIFY_CHUNK 64
+
+/**
+ * Sector ring, every rewrite moves to the next sector so the wear spreads over all of them.
+ * The default keeps the primary and secondary sectors, more sectors need free flash after them.
+ */
+#define ESP_FLASH_RING_START_ADDRESS ESP_FLASH_PRIMARY_SECTOR_ADDRESS
+#ifndef ESP_FLASH_RING_SECTORS
+#define ESP_FLASH_RING_SECTORS 2
+#endif
+#define ESP_FLASH_RING_SECTOR_SIZE 0x1000
+
+/**
+ * Parameters queued at once, also the most parameters a transaction can change
+ */
+#ifndef ESP_FLASH_UPDATE_QUEUE_SIZE
 #define ESP_FLASH_UPDATE_QUEUE_SIZE 16
+#endif
+
+/**
+ * Queued updates are committed once nothing was queued for the idle timeout, in milliseconds, or once the
+ * queued values add up to the threshold, in bytes
+ */
+#ifndef ESP_FLASH_COMMIT_IDLE_TIMEOUT
+#define ESP_FLASH_COMMIT_IDLE_TIMEOUT 2000
+#endif
+#ifndef ESP_FLASH_COMMIT_THRESHOLD
+#define ESP_FLASH_COMMIT_THRESHOLD 512
+#endif
+
+#define ESP_FLASH_INDEX_SIZE 32
+#define ESP_FLASH_PARAMETER_MAX_RECORD ( ( 2 + 0xFF + 0x3 ) & ( ~0x03 ) )
+
+/**
+ * The instruction cache maps the first megabyte of flash at ESP_FLASH_MMAP_BASE, parameters are read from there
+ * with aligned 32 bit loads instead of a SPI transfer. Reads fall back to spi_flash_read when the ring is outside
+ * the window or another megabyte is mapped. A size of 0 keeps every read on spi_flash_read.
+ */
+#ifndef ESP_FLASH_MMAP_BASE
+#define ESP_FLASH_MMAP_BASE 0x40200000
+#endif
+#ifndef ESP_FLASH_MMAP_SIZE
+#define ESP_FLASH_MMAP_SIZE 0x00100000
+#endif
+
+/**
+ * Log-structured layout, define ESP_FLASH_LOG_STRUCTURED to store parameters as appended records
+ * instead of rewriting the sorted sector on every update. Holds up to ESP_FLASH_INDEX_SIZE parameters.
+ */
+#define ESP_FLASH_LOG_MAGIC 0x474F4C45
+#define ESP_FLASH_LOG_HEADER_SIZE 8
+#define ESP_FLASH_LOG_RECORD_HEADER_SIZE 8
+#define ESP_FLASH_LOG_MAX_RECORD ( ( ESP_FLASH_LOG_RECORD_HEADER_SIZE + 0xFF + 0x3 ) & ( ~0x03 ) )
+#define ESP_FLASH_LOG_SECTOR_SIZE ( ESP_FLASH_SECTOR_LENGTH * 4 )
+
+#define ESP_FLASH_LOG_FLAG_VALUE 0xFF
+#define ESP_FLASH_LOG_FLAG_TOMBSTONE 0x00
+
+/**
+ * Records written together, they only apply once the commit record which counts them follows
+ */
+#define ESP_FLASH_LOG_FLAG_BATCH_VALUE 0x7F
+#define ESP_FLASH_LOG_FLAG_BATCH_TOMBSTONE 0x7E
+#define ESP_FLASH_LOG_FLAG_COMMIT 0x3C
+
+/**
+ * Blob area for values which don't fit a parameter, like certificates or scripts. Every blob takes whole sectors,
+ * a header in the first one followed by the data. The default area is past the 1 MB of the OTA layout, on 4 MB
+ * modules; it must not overlap anything else in the flash map of the target.
+ */
+#ifndef ESP_FLASH_BLOB_START_ADDRESS
+#define ESP_FLASH_BLOB_START_ADDRESS 0x00300000
+#endif
+#ifndef ESP_FLASH_BLOB_SECTORS
+#define ESP_FLASH_BLOB_SECTORS 16
+#endif
+#define ESP_FLASH_BLOB_SECTOR_SIZE 0x1000
+#define ESP_FLASH_BLOB_MAGIC 0x424F4C42
+#define ESP_FLASH_BLOB_CHUNK 64
+
+/**
+ * Blob header, the magic is written last so a blob only exists once all of its data is in flash.
+ * Removing it clears the state word without an erase.
+ */
+typedef struct esp_flash_blob_header {
+    uint32_t magic;
+    uint32_t id;
+    uint32_t length;
+    uint32_t crc;
+    uint32_t sequence;
+    uint32_t state;
+} esp_flash_blob_header_type;
+
+/**
+ * Streaming blob write, the previous blob with the same id stays readable until the write ends
+ */
+typedef struct esp_flash_blob_writer {
+    uint32_t address;
+    uint32_t length;
+    uint32_t written;
+    uint32_t crc;
+    uint32_t pending;
+    uint16_t id;
+    uint8_t sectors;
+    uint8_t erased;
+} esp_flash_blob_writer_type;
+
+/**
+ * Streaming blob read
+ */
+typedef struct esp_flash_blob_reader {
+    uint32_t address;
+    uint32_t length;
+    uint32_t position;
+    uint32_t crc;
+} esp_flash_blob_reader_type;
+
+/**
+ * Parameter schema, a table of the parameters kept in a RAM struct with the offset of their field and a default
+ * for when they aren't stored. Bytes fields must hold exactly their size, strings are kept zero terminated.
+ */
+#define ESP_FLASH_SCHEMA_BYTES 0x00
+#define ESP_FLASH_SCHEMA_STRING 0x01
+
+#define ESP_FLASH_SCHEMA_OFFSET( type, field ) ( ( uint16_t ) offsetof( type, field ) )
+#define ESP_FLASH_SCHEMA_SIZE( type, field ) sizeof( ( ( type* ) 0 )->field )
+
+typedef struct esp_flash_schema_entry {
+    uint8_t id;
+    uint8_t type;
+    uint8_t size;
+    uint16_t offset;
+    const void* default_value;
+    uint8_t default_size;
+} esp_flash_schema_entry_type;
 
 LOCAL uint32_t esp_flash_current_sector_address;
 LOCAL uint32_t esp_flash_backup_sector_address;
@@ -39,6 +183,19 @@ LOCAL void ICACHE_FLASH_ATTR esp_flash_save_parameter( uint8_t parameter_id, uin
 
 LOCAL void ICACHE_FLASH_ATTR esp_flash_enable_instant_update( void );
 LOCAL void ICACHE_FLASH_ATTR esp_flash_disable_instant_update( void );
+LOCAL void ICACHE_FLASH_ATTR esp_flash_set_commit_policy( uint32_t idle_timeout, uint16_t threshold );
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_transaction_begin( void );
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_transaction_commit( void );
+LOCAL void ICACHE_FLASH_ATTR esp_flash_transaction_abort( void );
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_schema_load( const esp_flash_schema_entry_type* schema, uint8_t count, uint8_t* values );
+
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_write_begin( esp_flash_blob_writer_type* writer, uint16_t blob_id, uint32_t length );
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_write( esp_flash_blob_writer_type* writer, uint8_t* data_src, uint16_t data_size );
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_write_end( esp_flash_blob_writer_type* writer );
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_open( esp_flash_blob_reader_type* reader, uint16_t blob_id );
+LOCAL uint16_t ICACHE_FLASH_ATTR esp_flash_blob_read( esp_flash_blob_reader_type* reader, uint8_t* dst, uint16_t size );
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_flash_blob_verify( esp_flash_blob_reader_type* reader );
+LOCAL void ICACHE_FLASH_ATTR esp_flash_blob_remove( uint16_t blob_id );
 
 
 #endif
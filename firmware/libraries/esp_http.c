@@ -20,48 +20,51 @@
  * Server routing scheme
  */
 http_route_header_scheme_type* http_request_scheme_route = NULL;
+http_metrics_type http_request_unrouted_metrics;
 
 /**
- * Initialize a header fields or reinitialize
+ * Initialize a header field or reinitialize, allocating from the arena if given
  */
-void ICACHE_FLASH_ATTR http_header_field_initialize( http_header_field_type* header, uint8_t* name, uint8_t* value )
+void ICACHE_FLASH_ATTR http_header_field_setup( esp_arena_type* arena, http_header_field_type* header, uint8_t* name, uint8_t* value )
 {
     uint16_t n;
 
-    if( header->name != NULL ) {
-        os_free( header->name );
-        header->name = NULL;
-    }
-    if( header->value != NULL ) {
-        os_free( header->value );
-        header->value = NULL;
-    }
+    esp_arena_free( arena, header->name );
+    esp_arena_free( arena, header->value );
 
     if( name == NULL || ( n = strlen( ( char* ) name )) == 0 ) {
         header->name = NULL;
-    } else if( n != 0 ) {
-        header->name = ( uint8_t* ) os_malloc( n + 1 );
+    } else {
+        header->name = ( uint8_t* ) esp_arena_malloc( arena, n + 1 );
         strcpy( ( char* ) header->name, ( char* ) name );
     }
 
     if( value == NULL || ( n = strlen( ( char* ) value )) == 0 ) {
         header->value = NULL;
-    } else if( n != 0 ) {
-        header->value = ( uint8_t* ) os_malloc( n + 1 );
+    } else {
+        header->value = ( uint8_t* ) esp_arena_malloc( arena, n + 1 );
         strcpy( ( char* ) header->value, ( char* ) value );
     }
 }
 
+/**
+ * Initialize a header fields or reinitialize
+ */
+void ICACHE_FLASH_ATTR http_header_field_initialize( http_header_field_type* header, uint8_t* name, uint8_t* value )
+{
+    http_header_field_setup( NULL, header, name, value );
+}
+
 /**
  * Create and initialize a header field
  */
-http_header_field_type* ICACHE_FLASH_ATTR http_header_field_create( uint8_t* name, uint8_t* value )
+http_header_field_type* ICACHE_FLASH_ATTR http_header_field_create( esp_arena_type* arena, uint8_t* name, uint8_t* value )
 {
-    http_header_field_type* insert = ( http_header_field_type* ) os_malloc( sizeof( http_header_field_type ));
+    http_header_field_type* insert = ( http_header_field_type* ) esp_arena_malloc( arena, sizeof( http_header_field_type ));
 
     insert->name = insert->value = NULL;
     insert->chain = NULL;
-    http_header_field_initialize( insert, name, value );
+    http_header_field_setup( arena, insert, name, value );
     return insert;
 }
 
@@ -107,6 +110,14 @@ http_header_field_type* ICACHE_FLASH_ATTR http_header_field_find( http_header_fi
  * Add header field into list
  */
 http_header_field_type* ICACHE_FLASH_ATTR http_header_field_add( http_header_field_type* list, uint8_t* name, uint8_t* value )
+{
+    return http_header_field_insert( NULL, list, name, value );
+}
+
+/**
+ * Add header field into list, allocating from the arena if given
+ */
+http_header_field_type* ICACHE_FLASH_ATTR http_header_field_insert( esp_arena_type* arena, http_header_field_type* list, uint8_t* name, uint8_t* value )
 {
     int8_t field_index;
     http_header_field_type* insert;
@@ -114,7 +125,7 @@ http_header_field_type* ICACHE_FLASH_ATTR http_header_field_add( http_header_fie
 
     search = http_header_field_find( list, &field_index, name );
     if( field_index == -1 ) {
-        insert = http_header_field_create( name, value );
+        insert = http_header_field_create( arena, name, value );
         search = list;
         if( list == NULL ) {
             insert->chain = list;
@@ -129,7 +140,7 @@ http_header_field_type* ICACHE_FLASH_ATTR http_header_field_add( http_header_fie
     if( field_index == 0 ) insert = search;
     else insert = search->chain;
 
-    http_header_field_initialize( insert, name, value );
+    http_header_field_setup( arena, insert, name, value );
     return list;
 }
 
@@ -329,14 +340,59 @@ uint16_t ICACHE_FLASH_ATTR http_header_field_value_length( uint8_t* data )
  */
 void ICACHE_FLASH_ATTR http_request_initialize( http_request_object_type* request )
 {
+    request->arena = NULL;
+    request->owns_location = 0;
     request->method = HTTP_METHOD_NONE;
     request->location = NULL;
+    request->route = NULL;
     request->connection = HTTP_CONNECTION_CLOSE;
     request->content = NULL;
     request->content_length = 0;
     request->headers = NULL;
 }
 
+/**
+ * Parse requests into the given arena, everything is released at once by http_request_deinitialize
+ */
+void ICACHE_FLASH_ATTR http_request_use_arena( http_request_object_type* request, esp_arena_type* arena )
+{
+    request->arena = arena;
+}
+
+/**
+ * Release the memory taken by a parsed request, the request can be parsed into again
+ */
+void ICACHE_FLASH_ATTR http_request_deinitialize( http_request_object_type* request )
+{
+    http_header_field_type* next;
+
+    // parsing puts the Host value into the location, a location the request doesn't own outlives it
+    if( !request->owns_location && request->location != NULL ) {
+        esp_arena_free( request->location->arena, request->location->hostname );
+        request->location->hostname = NULL;
+    }
+    if( request->arena != NULL ) {
+        esp_arena_reset( request->arena );
+    } else {
+        while( request->headers != NULL ) {
+            next = request->headers->chain;
+            http_header_field_destroy( request->headers );
+            request->headers = next;
+        }
+        if( request->owns_location ) {
+            url_deinitialize( request->location );
+            os_free( request->location );
+        }
+    }
+    if( request->owns_location ) request->location = NULL;
+    request->owns_location = 0;
+    request->route = NULL;
+    request->headers = NULL;
+    request->content = NULL;
+    request->content_length = 0;
+    request->method = HTTP_METHOD_NONE;
+}
+
 /**
  * Use URL for the HTTP request
  */
@@ -357,101 +413,111 @@ void ICACHE_FLASH_ATTR http_request_content( http_request_object_type* request,
 }
 
 /**
- * Output HTTP request to string
+ * Write a header field line
  */
-uint8_t* ICACHE_FLASH_ATTR http_request_generate( uint8_t* text, http_request_object_type* request )
+LOCAL void ICACHE_FLASH_ATTR http_request_write_field( url_writer_type* writer, uint8_t* name, uint8_t* value )
+{
+    uint8_t separator[ 3 ] = ": ", line_end[ 3 ] = "\r\n";
+
+    url_writer_put_string( writer, name );
+    url_writer_put( writer, separator, 2 );
+    url_writer_put_string( writer, value );
+    url_writer_put( writer, line_end, 2 );
+}
+
+/**
+ * Write HTTP request line and header fields, without the content headers and the empty line
+ */
+void ICACHE_FLASH_ATTR http_request_write_head( url_writer_type* writer, http_request_object_type* request )
 {
     http_header_field_type* search;
-    uint8_t http_ws = 0;
-    char *p, method_get[ 5 ] = "GET ", method_post[ 6 ] = "POST ", http_v[ 11 ] = "HTTP/1.0\r\n";
+    uint8_t http_ws = 0, ip[ 16 ];
+    char method_get[ 5 ] = "GET ", method_post[ 6 ] = "POST ", http_v[ 11 ] = "HTTP/1.0\r\n", slash[ 3 ] = "/? ";
     char cn[ 11 ] = "Connection", cn_close[ 6 ] = "close", cn_keep[ 11 ] = "keep-alive", cn_upgrade[ 8 ] = "Upgrade";
     char host[ 5 ] = "Host", ua[ 11 ] = "User-Agent", ua_v[ 27 ] = "ESPHttp/1.0 (AirCore; 1.0)";
-    char accept[ 52 ] = "Accept\0 text/html,application/xhtml+xml,*/*;q=0.8\r\n";
-    char content[ 17 ] = "Content-Length: ", ctype[ 50 ] = "Content-Type: application/x-www-form-urlencoded\r\n";
+    char accept[ 7 ] = "Accept", accept_v[ 44 ] = "text/html,application/xhtml+xml,*/*;q=0.8";
     url_object_type* url = request->location;
 
-    if( request->method != HTTP_METHOD_NONE ) {
-        if( request->method == HTTP_METHOD_POST ) strcpy( ( char* ) text, method_post );
-        else strcpy( ( char* ) text, method_get );
-        text += strlen( ( char* ) text );
-
-        if( url != NULL ) {
-            http_ws = url->protocol == URL_PROTOCOL_WS || url->protocol == URL_PROTOCOL_WSS;
-            p = ( char* ) url->path;
-            if( p != NULL && strlen( p ) != 0 ) {
-                strcpy( ( char* ) text, p );
-                text += strlen( ( char* ) text );
-            } else
-                *( text++ ) = '/';
+    url_writer_put_string( writer, ( uint8_t* ) ( ( request->method == HTTP_METHOD_POST ) ? method_post : method_get ) );
 
-            if( request->method == HTTP_METHOD_GET ) {
-                if( request->location->query != NULL ) {
-                    *( text++ ) = '?';
-                    text = url_get_query( text, url );
-                }
-            }
-        } else *( text++ ) = '/';
-
-        *( text++ ) = ' ';
-        if( request->connection != HTTP_CONNECTION_CLOSE || http_ws )
-            http_v[ 7 ] = '1';
-        strcpy( ( char* ) text, http_v );
-        text += strlen( ( char* ) text );
-
-        search = http_header_field_get( request->headers, ( uint8_t* ) host );
-        if( search == NULL ) {
-            if( url != NULL ) {
-                strcpy( ( char* ) text, host );
-                text += strlen( ( char* ) text );
-                *( text++ ) = ':'; *( text++ ) = ' ';
-                if( url->hostname != NULL && ( strlen( ( char* ) url->hostname ) > 0 ) ) strcpy( ( char* ) text, ( char* ) url->hostname );
-                else url_ip_to_hostname( text, url->host_ip );
-                text += strlen( ( char* ) text );
-                *( text++ ) = '\r'; *( text++ ) = '\n';
+    if( url != NULL ) {
+        http_ws = url->protocol == URL_PROTOCOL_WS || url->protocol == URL_PROTOCOL_WSS;
+        if( url->path != NULL && strlen( ( char* ) url->path ) != 0 )
+            url_writer_put_string( writer, url->path );
+        else
+            url_writer_put( writer, ( uint8_t* ) slash, 1 );
+
+        if( request->method == HTTP_METHOD_GET ) {
+            if( url_query_count( url ) > 0 ) {
+                url_writer_put( writer, ( uint8_t* ) slash + 1, 1 );
+                url_write_query( writer, url );
             }
         }
-
-        search = http_header_field_get( request->headers, ( uint8_t* ) cn );
-        if( search == NULL ) {
-            strcpy( ( char* ) text, cn );
-            text += strlen( ( char* ) text );
-            *( text++ ) = ':'; *( text++ ) = ' ';
-            if( request->connection == HTTP_CONNECTION_KEEPALIVE ) strcpy( ( char* ) text, cn_keep );
-            else if( request->connection == HTTP_CONNECTION_UPGRADE || http_ws ) strcpy( ( char* ) text, cn_upgrade );
-            else strcpy( ( char* ) text, cn_close );
-            text += strlen( ( char* ) text );
-            *( text++ ) = '\r'; *( text++ ) = '\n';
+    } else url_writer_put( writer, ( uint8_t* ) slash, 1 );
+
+    url_writer_put( writer, ( uint8_t* ) slash + 2, 1 );
+    if( request->connection != HTTP_CONNECTION_CLOSE || http_ws )
+        http_v[ 7 ] = '1';
+    url_writer_put_string( writer, ( uint8_t* ) http_v );
+
+    search = http_header_field_get( request->headers, ( uint8_t* ) host );
+    if( search == NULL && url != NULL ) {
+        if( url->hostname != NULL && ( strlen( ( char* ) url->hostname ) > 0 ) )
+            http_request_write_field( writer, ( uint8_t* ) host, url->hostname );
+        else {
+            url_ip_to_hostname( ip, url->host_ip );
+            http_request_write_field( writer, ( uint8_t* ) host, ip );
         }
+    }
 
-        search = http_header_field_get( request->headers, ( uint8_t* ) ua );
-        if( search == NULL ) {
-            strcpy( ( char* ) text, ua );
-            text += strlen( ( char* ) text );
-            *( text++ ) = ':'; *( text++ ) = ' ';
-            strcpy( ( char* ) text, ua_v );
-            text += strlen( ( char* ) text );
-            *( text++ ) = '\r'; *( text++ ) = '\n';
-        }
+    search = http_header_field_get( request->headers, ( uint8_t* ) cn );
+    if( search == NULL ) {
+        if( request->connection == HTTP_CONNECTION_KEEPALIVE ) http_request_write_field( writer, ( uint8_t* ) cn, ( uint8_t* ) cn_keep );
+        else if( request->connection == HTTP_CONNECTION_UPGRADE || http_ws ) http_request_write_field( writer, ( uint8_t* ) cn, ( uint8_t* ) cn_upgrade );
+        else http_request_write_field( writer, ( uint8_t* ) cn, ( uint8_t* ) cn_close );
+    }
 
-        search = http_header_field_get( request->headers, ( uint8_t* ) accept );
-        if( search == NULL ) {
-            accept[ 6 ] = ':';
-            strcpy( ( char* ) text, accept );
-            text += strlen( ( char* ) text );
-        }
+    search = http_header_field_get( request->headers, ( uint8_t* ) ua );
+    if( search == NULL )
+        http_request_write_field( writer, ( uint8_t* ) ua, ( uint8_t* ) ua_v );
 
-        search = request->headers;
-        while( search != NULL ) {
-            text = http_header_field_output( text, search );
-            *( text++ ) = '\r'; *( text++ ) = '\n';
-            search = search->chain;
-        }
+    search = http_header_field_get( request->headers, ( uint8_t* ) accept );
+    if( search == NULL )
+        http_request_write_field( writer, ( uint8_t* ) accept, ( uint8_t* ) accept_v );
+
+    for( search = request->headers; search != NULL ; search = search->chain )
+        http_request_write_field( writer, search->name, search->value );
+}
+
+/**
+ * Output HTTP request line and header fields, without the content headers and the empty line
+ */
+uint8_t* ICACHE_FLASH_ATTR http_request_generate_head( uint8_t* text, http_request_object_type* request )
+{
+    url_writer_type writer;
+
+    url_writer_initialize( &writer, text, 0xFFFF );
+    http_request_write_head( &writer, request );
+    return text + writer.position;
+}
+
+/**
+ * Output HTTP request to string
+ */
+uint8_t* ICACHE_FLASH_ATTR http_request_generate( uint8_t* text, http_request_object_type* request )
+{
+    char content[ 17 ] = "Content-Length: ", ctype[ 50 ] = "Content-Type: application/x-www-form-urlencoded\r\n";
+    url_object_type* url = request->location;
+
+    if( request->method != HTTP_METHOD_NONE ) {
+        text = http_request_generate_head( text, request );
 
         if( ( request->method == HTTP_METHOD_POST && url != NULL ) || ( request->content_length != 0 ) ) {
             if( request->method == HTTP_METHOD_POST ) {
                 strcpy( ( char* ) text, ctype );
                 text += strlen( ( char* ) text );
-                request->content_length = url_query_compute_length( url->query );
+                url_query_parse_pending( url );
+                request->content_length = url_query_compute_length( &( url->query ) );
             }
             strcpy( ( char* ) text, content );
             text += strlen( ( char* ) text );
@@ -459,9 +525,11 @@ uint8_t* ICACHE_FLASH_ATTR http_request_generate( uint8_t* text, http_request_ob
             text += strlen( ( char* ) text );
             *( text++ ) = '\r'; *( text++ ) = '\n';
 
-            if( request->method == HTTP_METHOD_POST ) url_get_query( text, url );
-            else strcpy( ( char* ) text, ( char* ) request->content );
-            text += strlen( ( char* ) text );
+            if( request->method == HTTP_METHOD_POST ) text = url_get_query( text, url );
+            else {
+                strcpy( ( char* ) text, ( char* ) request->content );
+                text += strlen( ( char* ) text );
+            }
         } else {
             *( text++ ) = '\r'; *( text++ ) = '\n';
         }
@@ -472,6 +540,109 @@ uint8_t* ICACHE_FLASH_ATTR http_request_generate( uint8_t* text, http_request_ob
 }
 
 
+/**
+ * Initializes a request template over the given buffer
+ */
+void ICACHE_FLASH_ATTR http_request_template_initialize( http_request_template_type* template, uint8_t* text, uint16_t capacity )
+{
+    template->text = text;
+    template->capacity = capacity;
+    template->head_length = 0;
+    template->length = 0;
+    template->field_count = 0;
+}
+
+/**
+ * Reserve a fixed width header field which can be patched on every send, returns the field index
+ */
+int8_t ICACHE_FLASH_ATTR http_request_template_add_field( http_request_template_type* template, uint8_t* name, uint8_t width )
+{
+    http_request_template_field_type* field;
+
+    if( template->field_count == HTTP_REQUEST_TEMPLATE_FIELDS ) return -1;
+    field = &( template->fields[ template->field_count ] );
+    field->name = name;
+    field->width = width;
+    field->offset = 0;
+    return ( int8_t ) ( template->field_count ++ );
+}
+
+/**
+ * Serialise the invariant part of the request, ending with an open Content-Length field. Returns the head length,
+ * 0 if it doesn't fit the template buffer
+ */
+uint16_t ICACHE_FLASH_ATTR http_request_template_compile( http_request_template_type* template, http_request_object_type* request )
+{
+    char content[ 17 ] = "Content-Length: ";
+    uint8_t separator[ 3 ] = ": ", line_end[ 3 ] = "\r\n", blank[ 16 ] = "               ";
+    http_request_template_field_type* field;
+    url_writer_type writer;
+    uint8_t i, width, step;
+
+    template->head_length = template->length = 0;
+    url_writer_initialize( &writer, template->text, template->capacity );
+    http_request_write_head( &writer, request );
+    for( i = 0; i < template->field_count ; i++ ) {
+        field = &( template->fields[ i ] );
+        url_writer_put_string( &writer, field->name );
+        url_writer_put( &writer, separator, 2 );
+        field->offset = ( uint16_t ) writer.total;
+        for( width = field->width; width > 0 ; width -= step ) {
+            step = ( width > sizeof( blank ) - 1 ) ? sizeof( blank ) - 1 : width;
+            url_writer_put( &writer, blank, step );
+        }
+        url_writer_put( &writer, line_end, 2 );
+    }
+    url_writer_put_string( &writer, ( uint8_t* ) content );
+    // the head doesn't fit the buffer
+    if( ! url_writer_complete( &writer ) )
+        return 0;
+
+    template->head_length = template->length = writer.position;
+    return template->head_length;
+}
+
+/**
+ * Patch a reserved field value, padding with whitespace up to the field width
+ */
+void ICACHE_FLASH_ATTR http_request_template_set_field( http_request_template_type* template, uint8_t field_index, uint8_t* value )
+{
+    http_request_template_field_type* field = &( template->fields[ field_index ] );
+    uint8_t* text = template->text + field->offset;
+    uint8_t i;
+
+    for( i = 0; i < field->width && value[ i ] != '\0' ; i++ )
+        text[ i ] = value[ i ];
+    for( ; i < field->width ; i++ )
+        text[ i ] = ' ';
+}
+
+/**
+ * Complete the template with the content length and body, returns the total request length
+ */
+uint16_t ICACHE_FLASH_ATTR http_request_template_render( http_request_template_type* template, uint8_t* content, uint16_t length )
+{
+    uint8_t digits[ 6 ], *text = template->text + template->head_length;
+    uint8_t n = 0, i;
+    uint16_t value = length;
+
+    do {
+        digits[ n++ ] = '0' + ( value % 10 );
+        value /= 10;
+    } while( value != 0 );
+
+    if( ( uint32_t ) template->head_length + n + 4 + length > template->capacity ) return 0;
+    for( i = n; i > 0 ; i-- )
+        *( text++ ) = digits[ i - 1 ];
+    *( text++ ) = '\r'; *( text++ ) = '\n';
+    *( text++ ) = '\r'; *( text++ ) = '\n';
+    os_memcpy( text, content, length );
+
+    template->length = ( uint16_t ) ( text - template->text ) + length;
+    return template->length;
+}
+
+
 /**
  * Check if header field value needs to be saved according to the given scheme
  */
@@ -479,10 +650,12 @@ uint8_t ICACHE_FLASH_ATTR http_header_field_check_scheme( uint8_t* name, http_he
 {
     char header_upgrade[ 8 ] = "Upgrade", header_sec_ws_key[ 18 ] = "Sec-WebSocket-Key", header_sec_ws_version[ 22 ] = "Sec-WebSocket-Version";
     char header_sec_ws_accept[ 21 ] = "Sec-WebSocket-Accept";
-    char content_length[ 15 ] = "Content-Length", hostname[ 5 ] = "Host";
+    char content_length[ 15 ] = "Content-Length", hostname[ 5 ] = "Host", content_type[ 13 ] = "Content-Type";
+    char last_event_id[ 14 ] = "Last-Event-ID";
 
     if( strcmp( hostname, ( char* ) name ) == 0 ) return 0x01;
     if( strcmp( content_length, ( char* ) name ) == 0 ) return 0x01;
+    if( strcmp( content_type, ( char* ) name ) == 0 ) return 0x01;
 
     if( scheme & WS_REQUEST_SCHEME ) {
         if( strcmp( header_upgrade, ( char* ) name ) == 0 ) return 0x01;
@@ -493,6 +666,9 @@ uint8_t ICACHE_FLASH_ATTR http_header_field_check_scheme( uint8_t* name, http_he
         if( strcmp( header_upgrade, ( char* ) name ) == 0 ) return 0x01;
         if( strcmp( header_sec_ws_accept, ( char* ) name ) == 0 ) return 0x01;
     }
+    if( scheme & SSE_REQUEST_SCHEME ) {
+        if( strcmp( last_event_id, ( char* ) name ) == 0 ) return 0x01;
+    }
     // compare to saved fields
     return 0x00;
 }
@@ -519,7 +695,7 @@ uint8_t* ICACHE_FLASH_ATTR http_request_parse_method_line( http_request_object_t
     data = skip_whitespace( w );
     v = *( w = skip_to_whitespace( data ) );
     ( *w ) = '\0';
-    url_parse_path( request->location, data );
+    url_parse_path_lazy( request->location, data );
     ( *w ) = v;
     ( *end ) = ev;
     return skip_line_ending( end );
@@ -532,12 +708,13 @@ uint8_t* ICACHE_FLASH_ATTR http_request_parse_method_line( http_request_object_t
 void ICACHE_FLASH_ATTR http_route_scheme_add( uint8_t* path, http_header_scheme_type scheme )
 {
     http_route_header_scheme_type *p = http_request_scheme_route, *route = ( http_route_header_scheme_type* ) os_malloc( sizeof( http_route_header_scheme_type ) );
-	uint8_t* mpath = ( uint8_t* ) os_malloc( sizeof( uint8_t ) * strlen( ( char* ) path ) );
+	uint8_t* mpath = ( uint8_t* ) os_malloc( sizeof( uint8_t ) * ( strlen( ( char* ) path ) + 1 ) );
     
     strcpy( ( char* ) mpath, ( char* ) path );
 	route->path = mpath;
 	route->scheme = scheme;
 	route->chain = NULL;
+    http_metrics_initialize( &( route->metrics ) );
     
     if( p == NULL ) http_request_scheme_route = route;
     else {
@@ -547,13 +724,12 @@ void ICACHE_FLASH_ATTR http_route_scheme_add( uint8_t* path, http_header_scheme_
 }
 
 /**
- * Path checker function, finds request scheme for the given path
+ * Path checker function, finds the route registered for the given path
  */
-http_header_scheme_type ICACHE_FLASH_ATTR http_request_path_get_scheme( uint8_t* path )
+http_route_header_scheme_type* ICACHE_FLASH_ATTR http_request_path_get_route( uint8_t* path )
 {
     http_route_header_scheme_type *p = http_request_scheme_route;
     char index[ 7 ] = "index.", *s, *z = NULL;
-    http_header_scheme_type h = 0x00;
 
     if( ( s = strstr( ( char * ) path, index ) ) != NULL ) {
         *( s ) = '\0'; 
@@ -561,17 +737,47 @@ http_header_scheme_type ICACHE_FLASH_ATTR http_request_path_get_scheme( uint8_t*
             *( z = s - 1 ) = '\0';
     }
     while( p != NULL ) {
-        if( strcmp( ( char* ) path, ( char* ) p->path ) == 0 ) {
-			h = p->scheme;
-            break;
-        }
+        if( strcmp( ( char* ) path, ( char* ) p->path ) == 0 ) break;
         p = p->chain;
 	}
     if( s != NULL ) {
         *( s ) = 'i';
         if( z != NULL ) *( z ) = '/';
     }
-	return h;
+	return p;
+}
+
+/**
+ * Path checker function, finds request scheme for the given path
+ */
+http_header_scheme_type ICACHE_FLASH_ATTR http_request_path_get_scheme( uint8_t* path )
+{
+    http_route_header_scheme_type *p = http_request_path_get_route( path );
+
+    if( p == NULL ) return 0x00;
+	return p->scheme;
+}
+
+/**
+ * Counters of the route which matched the request
+ */
+http_metrics_type* ICACHE_FLASH_ATTR http_request_metrics( http_request_object_type* request )
+{
+    if( request->route == NULL ) return &http_request_unrouted_metrics;
+    return &( request->route->metrics );
+}
+
+
+/**
+ * Check if the request content is url-encoded, a missing Content-Type is treated as a form
+ */
+uint8_t ICACHE_FLASH_ATTR http_request_content_is_form( http_request_object_type* request )
+{
+    char content_type[ 13 ] = "Content-Type", form[ 34 ] = "application/x-www-form-urlencoded";
+    http_header_field_type* search = http_header_field_get( request->headers, ( uint8_t* ) content_type );
+
+    if( search == NULL || search->value == NULL ) return 0x01;
+    return strnicmp( ( char* ) skip_whitespace( search->value ), form, 33 ) == 0;
 }
 
 
@@ -582,19 +788,24 @@ uint8_t* ICACHE_FLASH_ATTR http_request_parse( http_request_object_type* request
 {
     http_header_scheme_type scheme;
     char empty[ 1 ] = "\0", host[ 5 ] = "Host", content_length[ 15 ] = "Content-Length", header_sec_ws_key[ 18 ] = "Sec-WebSocket-Key";
-    uint8_t* mark, *store, *end;
+    uint8_t* mark, *store, *end, *head = data;
+    esp_arena_type* arena;
+    uint32_t start = http_metrics_cycles();
     uint16_t length;
 
     if( request->location == NULL ) {
-        request->location = ( url_object_type* ) os_malloc( sizeof( url_object_type ) );
-        url_initialize( request->location, URL_PROTOCOL_NONE, ( uint8_t* ) empty, 0, ( uint8_t* ) empty, ( uint8_t* ) empty );
+        request->location = ( url_object_type* ) esp_arena_malloc( request->arena, sizeof( url_object_type ) );
+        url_initialize_arena( request->location, request->arena, URL_PROTOCOL_NONE, ( uint8_t* ) empty, 0, ( uint8_t* ) empty, ( uint8_t* ) empty );
+        request->owns_location = 1;
     }
 
     data = http_request_parse_method_line( request, data );
-    scheme = http_request_path_get_scheme( request->location->path );
+    request->route = http_request_path_get_route( request->location->path );
+    scheme = ( request->route != NULL ) ? request->route->scheme : 0x00;
 
     request->content_length = 0;
     request->headers = NULL;
+    esp_arena_free( request->location->arena, request->location->hostname );
     request->location->hostname = NULL;
     request->location->host_ip = 0x00000000;
     request->scheme = scheme;
@@ -605,16 +816,20 @@ uint8_t* ICACHE_FLASH_ATTR http_request_parse( http_request_object_type* request
             ( *mark ) = '\0';
             if( http_header_field_check_scheme( data, scheme ) ) {
                 length = http_header_field_value_length( mark + 1 );
-                store = ( uint8_t* ) os_malloc( length + 1 );
+                // the Host value belongs to the location, which may not use the request arena
+                arena = ( strcmp( host, ( char* ) data ) == 0 ) ? request->location->arena : request->arena;
+                store = ( uint8_t* ) esp_arena_malloc( arena, length + 1 );
                 end = http_header_field_parse_value( mark + 1, store, 0 );
 
                 if( strcmp( content_length, ( char* ) data ) == 0 ) {
                     parse_uint32( &( request->content_length ), store );
+                    esp_arena_free( request->arena, store );
                 } else if( strcmp( host, ( char* ) data ) == 0 ) {
+                    esp_arena_free( request->location->arena, request->location->hostname );
                     request->location->hostname = store;
                 } else {
-                    request->headers = http_header_field_add( request->headers, data, store );
-                    os_free( store );
+                    request->headers = http_header_field_insert( request->arena, request->headers, data, store );
+                    esp_arena_free( request->arena, store );
                 }
                 data = end;
             } else {
@@ -626,8 +841,9 @@ uint8_t* ICACHE_FLASH_ATTR http_request_parse( http_request_object_type* request
 
     if(( *data ) == '\r' && ( *( data + 1 ) == '\n' )) {
         data += 2;
-        if( request->content_length > 0 )
-            url_parse_query( request->location, data, ( int16_t ) request->content_length );
+        // form fields are parsed on the first parameter access
+        if( request->content_length > 0 && http_request_content_is_form( request ) )
+            url_query_defer( request->location, data, ( uint16_t ) request->content_length );
         request->content = (( *data ) == '\0' ) ? NULL : data;
     } else request->content = data;
 
@@ -637,6 +853,7 @@ uint8_t* ICACHE_FLASH_ATTR http_request_parse( http_request_object_type* request
 	} else if( scheme == WS_REQUEST_SCHEME ) request->location->protocol = URL_PROTOCOL_WS;
     else request->location->protocol = URL_PROTOCOL_HTTP;
 
+    http_metrics_record_parse( http_request_metrics( request ), start, ( uint32_t ) ( data - head ) + request->content_length );
     return data;
 }
 
@@ -13,6 +13,8 @@
 #include "user_interface.h"
 
 #include "esp_url.h"
+#include "esp_arena.h"
+#include "esp_http_metrics.h"
 
 
 /**
@@ -40,7 +42,8 @@ typedef enum {
     HTTP_REQUEST_SCHEME = 0x01,
     HTTP_RESPONSE_SCHEME = 0x02,
     WS_REQUEST_SCHEME = 0x04,
-    WS_RESPONSE_SCHEME = 0x08
+    WS_RESPONSE_SCHEME = 0x08,
+    SSE_REQUEST_SCHEME = 0x10
 } http_header_scheme_type;
 
 /**
@@ -54,13 +57,19 @@ struct http_header_field {
     http_header_field_type* chain;
 };
 
+typedef struct http_route_header_scheme http_route_header_scheme_type;
+
 /**
  * Base object for HTTP request
  */
 typedef struct http_request_object {
+    esp_arena_type* arena;
+    uint8_t owns_location;
+
     http_method_type method;
     url_object_type* location;
     http_header_scheme_type scheme;
+    http_route_header_scheme_type* route;
 
     http_connection_type connection;
     uint32_t content_length;
@@ -86,31 +95,69 @@ typedef struct http_response_object {
 /**
  * Path scheme
  */
-typedef struct http_route_header_scheme http_route_header_scheme_type;
-
 struct http_route_header_scheme {
     uint8_t* path;
     http_header_scheme_type scheme;
+    http_metrics_type metrics;
 
     http_route_header_scheme_type* chain;
 };
 
+/**
+ * Request template fields, patched in place on every send
+ */
+#define HTTP_REQUEST_TEMPLATE_FIELDS 4
+
+typedef struct http_request_template_field {
+    uint8_t* name;
+    uint16_t offset;
+    uint8_t width;
+} http_request_template_field_type;
+
+/**
+ * Precompiled request, the invariant head is serialised once and reused
+ */
+typedef struct http_request_template {
+    uint8_t* text;
+    uint16_t capacity;
+    uint16_t head_length;
+    uint16_t length;
+
+    uint8_t field_count;
+    http_request_template_field_type fields[ HTTP_REQUEST_TEMPLATE_FIELDS ];
+} http_request_template_type;
+
 void ICACHE_FLASH_ATTR http_header_field_initialize( http_header_field_type* header, uint8_t* name, uint8_t* value );
 uint8_t* ICACHE_FLASH_ATTR http_header_field_output( uint8_t* destination, http_header_field_type* header );
 
 http_header_field_type* ICACHE_FLASH_ATTR http_header_field_add( http_header_field_type* list, uint8_t* name, uint8_t* value );
+http_header_field_type* ICACHE_FLASH_ATTR http_header_field_insert( esp_arena_type* arena, http_header_field_type* list, uint8_t* name, uint8_t* value );
 http_header_field_type* ICACHE_FLASH_ATTR http_header_field_get( http_header_field_type* list, uint8_t* name );
 
+uint8_t* ICACHE_FLASH_ATTR parse_uint32( uint32_t* value, uint8_t* data );
 uint8_t* ICACHE_FLASH_ATTR http_header_field_parse_name( uint8_t* data, uint8_t* name, uint8_t skip );
 uint8_t* ICACHE_FLASH_ATTR http_header_field_parse_value( uint8_t* data, uint8_t* value, uint8_t skip );
 
 void ICACHE_FLASH_ATTR http_request_initialize( http_request_object_type* request );
+void ICACHE_FLASH_ATTR http_request_use_arena( http_request_object_type* request, esp_arena_type* arena );
+void ICACHE_FLASH_ATTR http_request_deinitialize( http_request_object_type* request );
 void ICACHE_FLASH_ATTR http_request_url( http_request_object_type* request, url_object_type* url, http_method_type method );
 void ICACHE_FLASH_ATTR http_request_content( http_request_object_type* request, uint8_t* content, uint32_t length );
 
 void ICACHE_FLASH_ATTR http_route_scheme_add( uint8_t* path, http_header_scheme_type scheme );
+http_route_header_scheme_type* ICACHE_FLASH_ATTR http_request_path_get_route( uint8_t* path );
+http_metrics_type* ICACHE_FLASH_ATTR http_request_metrics( http_request_object_type* request );
 
+void ICACHE_FLASH_ATTR http_request_write_head( url_writer_type* writer, http_request_object_type* request );
+uint8_t* ICACHE_FLASH_ATTR http_request_generate_head( uint8_t* text, http_request_object_type* request );
 uint8_t* ICACHE_FLASH_ATTR http_request_generate( uint8_t* text, http_request_object_type* request );
 uint8_t* ICACHE_FLASH_ATTR http_request_parse( http_request_object_type* request, uint8_t* data );
+uint8_t ICACHE_FLASH_ATTR http_request_content_is_form( http_request_object_type* request );
+
+void ICACHE_FLASH_ATTR http_request_template_initialize( http_request_template_type* template, uint8_t* text, uint16_t capacity );
+int8_t ICACHE_FLASH_ATTR http_request_template_add_field( http_request_template_type* template, uint8_t* name, uint8_t width );
+uint16_t ICACHE_FLASH_ATTR http_request_template_compile( http_request_template_type* template, http_request_object_type* request );
+void ICACHE_FLASH_ATTR http_request_template_set_field( http_request_template_type* template, uint8_t field_index, uint8_t* value );
+uint16_t ICACHE_FLASH_ATTR http_request_template_render( http_request_template_type* template, uint8_t* content, uint16_t length );
 
 #endif
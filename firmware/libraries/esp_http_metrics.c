@@ -0,0 +1,167 @@
+/**
+ * \brief		HTTP Route Metrics
+ * \file		esp_http_metrics.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HTTP_METRICS_C__
+#define __ESP_HTTP_METRICS_C__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#include "esp_http.h"
+#include "esp_http_metrics.h"
+
+
+/**
+ * Routing table and the counters of requests with no registered route
+ */
+extern http_route_header_scheme_type* http_request_scheme_route;
+extern http_metrics_type http_request_unrouted_metrics;
+
+/**
+ * Reset the counters
+ */
+void ICACHE_FLASH_ATTR http_metrics_initialize( http_metrics_type* metrics )
+{
+    os_memset( metrics, 0, sizeof( http_metrics_type ) );
+}
+
+/**
+ * Microseconds elapsed since start and the histogram bucket they fall into
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR http_metrics_elapsed( uint32_t start, uint8_t* bucket )
+{
+    uint32_t us = ( http_metrics_cycles() - start ) / HTTP_METRICS_CYCLES_PER_US;
+
+    ( *bucket ) = ( us == 0 ) ? 0 : 32 - __builtin_clz( us );
+    if( ( *bucket ) >= HTTP_METRICS_BUCKETS ) ( *bucket ) = HTTP_METRICS_BUCKETS - 1;
+    return us;
+}
+
+/**
+ * Count a parsed request
+ */
+void ICACHE_FLASH_ATTR http_metrics_record_parse( http_metrics_type* metrics, uint32_t start, uint32_t bytes_in )
+{
+    uint8_t bucket;
+
+    metrics->parse_time += http_metrics_elapsed( start, &bucket );
+    metrics->parse_histogram[ bucket ]++;
+    metrics->requests++;
+    metrics->bytes_in += bytes_in;
+}
+
+/**
+ * Count a handled request, start is the cycle counter read before the handler ran
+ */
+void ICACHE_FLASH_ATTR http_metrics_record_handler( http_metrics_type* metrics, uint32_t start, uint32_t bytes_out )
+{
+    uint8_t bucket;
+
+    metrics->handler_time += http_metrics_elapsed( start, &bucket );
+    metrics->handler_histogram[ bucket ]++;
+    metrics->bytes_out += bytes_out;
+}
+
+/**
+ * Register the metrics endpoint
+ */
+void ICACHE_FLASH_ATTR http_metrics_register_route( void )
+{
+    char path[ 9 ] = HTTP_METRICS_HTTP_PATH;
+    http_route_scheme_add( ( uint8_t* ) path, HTTP_REQUEST_SCHEME );
+}
+
+
+/**
+ * Write the decimal value
+ */
+LOCAL uint8_t* ICACHE_FLASH_ATTR http_metrics_write_uint32( uint8_t* text, uint32_t value )
+{
+    uint8_t digits[ 10 ], i = 0;
+
+    do {
+        digits[ i++ ] = '0' + ( value % 10 );
+        value /= 10;
+    } while( value > 0 );
+    for( ; i > 0 ; i-- )
+        *( text++ ) = digits[ i - 1 ];
+    return text;
+}
+
+/**
+ * Write a histogram as comma separated bucket counts, trailing empty buckets are left out
+ */
+LOCAL uint8_t* ICACHE_FLASH_ATTR http_metrics_write_histogram( uint8_t* text, uint8_t prefix, uint32_t* histogram )
+{
+    uint8_t i, n = HTTP_METRICS_BUCKETS;
+
+    while( n > 1 && histogram[ n - 1 ] == 0 ) n--;
+    *( text++ ) = ' ';
+    *( text++ ) = prefix;
+    *( text++ ) = ':';
+    for( i = 0; i < n ; i++ ) {
+        if( i > 0 ) *( text++ ) = ',';
+        text = http_metrics_write_uint32( text, histogram[ i ] );
+    }
+    return text;
+}
+
+/**
+ * Write one route line into the scratch buffer
+ */
+LOCAL uint16_t ICACHE_FLASH_ATTR http_metrics_write_line( uint8_t* text, uint8_t* path, http_metrics_type* metrics )
+{
+    uint8_t* start = text;
+    uint32_t counters[ 5 ];
+    uint8_t i;
+
+    counters[ 0 ] = metrics->requests;
+    counters[ 1 ] = metrics->bytes_in;
+    counters[ 2 ] = metrics->bytes_out;
+    counters[ 3 ] = metrics->parse_time;
+    counters[ 4 ] = metrics->handler_time;
+
+    for( ; ( *path ) != '\0' ; path++ )
+        *( text++ ) = ( *path );
+    for( i = 0; i < 5 ; i++ ) {
+        *( text++ ) = ' ';
+        text = http_metrics_write_uint32( text, counters[ i ] );
+    }
+    text = http_metrics_write_histogram( text, 'p', metrics->parse_histogram );
+    text = http_metrics_write_histogram( text, 'h', metrics->handler_histogram );
+    *( text++ ) = '\n';
+    return ( uint16_t ) ( text - start );
+}
+
+/**
+ * Write the counters of every route, lines which don't fit the capacity are left out
+ */
+uint16_t ICACHE_FLASH_ATTR http_metrics_output( uint8_t* text, uint16_t capacity )
+{
+    // path plus 5 counters and 2 histograms of up to 10 digits each
+    uint8_t line[ 64 + 5 * 11 + 2 * ( 3 + HTTP_METRICS_BUCKETS * 11 ) + 1 ];
+    http_route_header_scheme_type* route;
+    char unrouted[ 2 ] = "*";
+    uint16_t length, n;
+
+    length = http_metrics_write_line( line, ( uint8_t* ) unrouted, &http_request_unrouted_metrics );
+    if( length > capacity ) return 0;
+    os_memcpy( text, line, length );
+
+    for( route = http_request_scheme_route; route != NULL ; route = route->chain ) {
+        if( strlen( ( char* ) route->path ) >= 64 ) continue;
+        n = http_metrics_write_line( line, route->path, &( route->metrics ) );
+        if( length + n > capacity ) break;
+        os_memcpy( text + length, line, n );
+        length += n;
+    }
+    return length;
+}
+
+
+#endif
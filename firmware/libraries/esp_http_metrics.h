@@ -0,0 +1,69 @@
+/**
+ * \brief		HTTP Route Metrics
+ * \file		esp_http_metrics.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Request, byte and latency counters kept inside every registered route. Durations are taken from the CPU cycle
+ * counter and sorted into power of two microsecond buckets, bucket i holds the durations below 2^i us and the last
+ * one everything above. Recording is a handful of increments into preallocated counters, no allocation and no
+ * locking, the non-OS SDK runs the HTTP callbacks from a single task.
+ *
+ * The counters of every route are served as compact text from /metrics, one line per route:
+ * <path> <requests> <bytes in> <bytes out> <parse us> <handler us> p:<buckets,..> h:<buckets,..>
+ */
+#ifndef __ESP_HTTP_METRICS_H__
+#define __ESP_HTTP_METRICS_H__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#define HTTP_METRICS_BUCKETS 16
+#define HTTP_METRICS_HTTP_PATH "/metrics"
+
+/**
+ * Route counters
+ */
+typedef struct http_metrics {
+    uint32_t requests;
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+
+    uint32_t parse_time;
+    uint32_t handler_time;
+    uint32_t parse_histogram[ HTTP_METRICS_BUCKETS ];
+    uint32_t handler_histogram[ HTTP_METRICS_BUCKETS ];
+} http_metrics_type;
+
+/**
+ * Cycle counter, the host build falls back to the monotonic clock in nanoseconds
+ */
+#ifdef __XTENSA__
+static inline uint32_t http_metrics_cycles( void )
+{
+    uint32_t cycles;
+    __asm__ __volatile__( "rsr %0, ccount" : "=a"( cycles ) );
+    return cycles;
+}
+#define HTTP_METRICS_CYCLES_PER_US ( ( uint32_t ) system_get_cpu_freq() )
+#else
+#include <time.h>
+static inline uint32_t http_metrics_cycles( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint32_t ) ( now.tv_sec * 1000000000ULL + now.tv_nsec );
+}
+#define HTTP_METRICS_CYCLES_PER_US 1000
+#endif
+
+void ICACHE_FLASH_ATTR http_metrics_initialize( http_metrics_type* metrics );
+void ICACHE_FLASH_ATTR http_metrics_record_parse( http_metrics_type* metrics, uint32_t start, uint32_t bytes_in );
+void ICACHE_FLASH_ATTR http_metrics_record_handler( http_metrics_type* metrics, uint32_t start, uint32_t bytes_out );
+
+void ICACHE_FLASH_ATTR http_metrics_register_route( void );
+uint16_t ICACHE_FLASH_ATTR http_metrics_output( uint8_t* text, uint16_t capacity );
+
+#endif
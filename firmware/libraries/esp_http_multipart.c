@@ -0,0 +1,244 @@
+/**
+ * \brief		HTTP multipart/form-data Stream Parser
+ * \file		esp_http_multipart.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HTTP_MULTIPART_C__
+#define __ESP_HTTP_MULTIPART_C__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#include "esp_http_multipart.h"
+
+
+/**
+ * Copy a header parameter value ( name="value" ) into destination, returns 1 when found and not cut to fit
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR http_multipart_header_parameter( uint8_t* line, char* key, uint8_t* destination, uint8_t size )
+{
+    uint8_t* p = line, *e;
+    uint8_t n = strlen( key ), i = 0;
+
+    while( ( p = ( uint8_t* ) strchr( ( char* ) p, ';' ) ) != NULL ) {
+        p = skip_whitespace( p + 1 );
+        if( strnicmp( ( char* ) p, key, n ) != 0 || p[ n ] != '=' ) continue;
+        p += n + 1;
+        if( ( *p ) == '"' ) {
+            p++;
+            e = ( uint8_t* ) strchr( ( char* ) p, '"' );
+        } else e = ( uint8_t* ) strchr( ( char* ) p, ';' );
+        if( e == NULL ) e = p + strlen( ( char* ) p );
+
+        for( ; p < e && i < size - 1 ; p++ )
+            destination[ i++ ] = ( *p );
+        destination[ i ] = '\0';
+        // cut to fit the destination
+        return ( p == e ) ? 0x01 : 0x00;
+    }
+    destination[ 0 ] = '\0';
+    return 0x00;
+}
+
+/**
+ * Parse a part header line
+ */
+LOCAL void ICACHE_FLASH_ATTR http_multipart_parse_header( http_multipart_context_type* context )
+{
+    char disposition[ 21 ] = "Content-Disposition:", ctype[ 14 ] = "Content-Type:", name[ 5 ] = "name", filename[ 9 ] = "filename";
+    uint8_t* line = context->line, *value;
+    uint8_t i;
+
+    if( strnicmp( ( char* ) line, disposition, 20 ) == 0 ) {
+        http_multipart_header_parameter( line, name, context->name, HTTP_MULTIPART_NAME_LENGTH );
+        http_multipart_header_parameter( line, filename, context->filename, HTTP_MULTIPART_FILENAME_LENGTH );
+    } else if( strnicmp( ( char* ) line, ctype, 13 ) == 0 ) {
+        value = skip_whitespace( line + 13 );
+        for( i = 0; value[ i ] != '\0' && i < HTTP_MULTIPART_CONTENT_TYPE_LENGTH - 1 ; i++ )
+            context->content_type[ i ] = value[ i ];
+        context->content_type[ i ] = '\0';
+    }
+}
+
+/**
+ * Pass part data to the callback
+ */
+LOCAL void ICACHE_FLASH_ATTR http_multipart_emit( http_multipart_context_type* context, uint8_t* data, uint32_t length )
+{
+    if( length == 0 || context->state != HTTP_MULTIPART_DATA ) return;
+    context->part_length += length;
+    context->part_callback( context, HTTP_MULTIPART_PART_DATA, data, length );
+}
+
+/**
+ * Byte at the given position of the held tail followed by the new data
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR http_multipart_at( http_multipart_context_type* context, uint8_t* data, uint32_t i )
+{
+    if( i < context->held_length ) return context->held[ i ];
+    return data[ i - context->held_length ];
+}
+
+/**
+ * Search for the delimiter, emits data before it and returns the number of consumed bytes
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR http_multipart_scan( http_multipart_context_type* context, uint8_t* data, uint32_t length )
+{
+    uint32_t total = context->held_length + length, pos = 0, consumed;
+    uint8_t m = context->delimiter_length, j, held = context->held_length;
+
+    while( pos + m <= total ) {
+        j = m - 1;
+        while( http_multipart_at( context, data, pos + j ) == context->delimiter[ j ] ) {
+            if( j == 0 ) break;
+            j--;
+        }
+        if( j == 0 && http_multipart_at( context, data, pos ) == context->delimiter[ 0 ] ) {
+            // delimiter found, flush everything before it
+            if( pos < held ) {
+                http_multipart_emit( context, context->held, pos );
+            } else {
+                http_multipart_emit( context, context->held, held );
+                http_multipart_emit( context, data, pos - held );
+            }
+            if( context->state == HTTP_MULTIPART_DATA )
+                context->part_callback( context, HTTP_MULTIPART_PART_END, NULL, context->part_length );
+
+            consumed = pos + m - held;
+            context->held_length = 0;
+            context->line_length = 0;
+            context->state = HTTP_MULTIPART_BOUNDARY;
+            return consumed;
+        }
+        pos += context->skip[ http_multipart_at( context, data, pos + m - 1 ) ];
+    }
+
+    // no delimiter, bytes before pos can't start one, keep the rest
+    if( pos < held ) {
+        http_multipart_emit( context, context->held, pos );
+        os_memmove( context->held, context->held + pos, held - pos );
+        os_memcpy( context->held + held - pos, data, length );
+    } else {
+        http_multipart_emit( context, context->held, held );
+        http_multipart_emit( context, data, pos - held );
+        os_memcpy( context->held, data + pos - held, total - pos );
+    }
+    context->held_length = ( uint8_t ) ( total - pos );
+    return length;
+}
+
+/**
+ * Collect a header or boundary line, returns 1 once the line is complete
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR http_multipart_line( http_multipart_context_type* context, uint8_t c )
+{
+    if( c == '\n' ) {
+        if( context->line_length > 0 && context->line[ context->line_length - 1 ] == '\r' )
+            context->line_length--;
+        context->line[ context->line_length ] = '\0';
+        return 0x01;
+    }
+    if( context->line_length < HTTP_MULTIPART_LINE_LENGTH - 1 )
+        context->line[ context->line_length++ ] = c;
+    return 0x00;
+}
+
+/**
+ * Initializes the parser from a Content-Type header value, returns 0 if it isn't multipart/form-data
+ */
+uint8_t ICACHE_FLASH_ATTR http_multipart_initialize( http_multipart_context_type* context, uint8_t* content_type, http_multipart_callback_type fn, void* arg )
+{
+    char multipart[ 20 ] = "multipart/form-data", boundary[ 9 ] = "boundary";
+    uint8_t i, m;
+
+    if( content_type == NULL ) return 0x00;
+    content_type = skip_whitespace( content_type );
+    if( strnicmp( ( char* ) content_type, multipart, 19 ) != 0 ) return 0x00;
+
+    context->delimiter[ 0 ] = '\r'; context->delimiter[ 1 ] = '\n';
+    context->delimiter[ 2 ] = '-'; context->delimiter[ 3 ] = '-';
+    // a shortened boundary would also match the start of the real one
+    if( ! http_multipart_header_parameter( content_type, boundary, context->delimiter + 4, HTTP_MULTIPART_DELIMITER_LENGTH - 4 ) )
+        return 0x00;
+    if( context->delimiter[ 4 ] == '\0' ) return 0x00;
+    context->delimiter_length = m = 4 + strlen( ( char* ) ( context->delimiter + 4 ) );
+
+    // horspool bad character table
+    os_memset( context->skip, m, sizeof( context->skip ) );
+    for( i = 0; i < m - 1 ; i++ )
+        context->skip[ context->delimiter[ i ] ] = m - 1 - i;
+
+    context->state = HTTP_MULTIPART_PREAMBLE;
+    context->part_callback = fn;
+    context->arg = arg;
+    context->line_length = 0;
+    context->part_length = 0;
+    context->name[ 0 ] = context->filename[ 0 ] = context->content_type[ 0 ] = '\0';
+    // the first boundary may not be preceded by CRLF
+    context->held[ 0 ] = '\r'; context->held[ 1 ] = '\n';
+    context->held_length = 2;
+    return 0x01;
+}
+
+/**
+ * Initializes the parser from the Content-Type of a parsed request
+ */
+uint8_t ICACHE_FLASH_ATTR http_multipart_request_initialize( http_multipart_context_type* context, http_request_object_type* request, http_multipart_callback_type fn, void* arg )
+{
+    char ctype[ 13 ] = "Content-Type";
+    http_header_field_type* header = http_header_field_get( request->headers, ( uint8_t* ) ctype );
+
+    if( header == NULL ) return 0x00;
+    return http_multipart_initialize( context, header->value, fn, arg );
+}
+
+/**
+ * Feeds the next chunk of the request body into the parser
+ */
+void ICACHE_FLASH_ATTR http_multipart_feed( http_multipart_context_type* context, uint8_t* data, uint32_t length )
+{
+    uint32_t consumed;
+
+    while( length > 0 && context->state != HTTP_MULTIPART_EPILOGUE ) {
+        if( context->state == HTTP_MULTIPART_PREAMBLE || context->state == HTTP_MULTIPART_DATA ) {
+            consumed = http_multipart_scan( context, data, length );
+        } else {
+            consumed = 1;
+            if( context->state == HTTP_MULTIPART_BOUNDARY ) {
+                // either the closing dashes or the end of the delimiter line
+                if( http_multipart_line( context, *data ) ) {
+                    context->state = HTTP_MULTIPART_HEADERS;
+                    context->line_length = 0;
+                    context->name[ 0 ] = context->filename[ 0 ] = context->content_type[ 0 ] = '\0';
+                } else if( context->line_length == 2 && context->line[ 0 ] == '-' && context->line[ 1 ] == '-' ) {
+                    context->state = HTTP_MULTIPART_EPILOGUE;
+                }
+            } else if( http_multipart_line( context, *data ) ) {
+                if( context->line_length == 0 ) {
+                    context->state = HTTP_MULTIPART_DATA;
+                    context->part_length = 0;
+                    context->part_callback( context, HTTP_MULTIPART_PART_BEGIN, NULL, 0 );
+                } else {
+                    http_multipart_parse_header( context );
+                    context->line_length = 0;
+                }
+            }
+        }
+        data += consumed;
+        length -= consumed;
+    }
+}
+
+/**
+ * Checks if the closing boundary was received
+ */
+uint8_t ICACHE_FLASH_ATTR http_multipart_finished( http_multipart_context_type* context )
+{
+    return context->state == HTTP_MULTIPART_EPILOGUE;
+}
+
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * \brief		HTTP multipart/form-data Stream Parser
+ * \file		esp_http_multipart.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Incremental multipart/form-data parser. The request body is fed in chunks as it arrives from the connection and
+ * every part is passed to the registered callback piece by piece, so uploads larger than the available RAM can be
+ * written straight to flash. Boundaries are searched with a precomputed Horspool skip table, only a boundary length
+ * tail is kept between chunks.
+ */
+#ifndef __ESP_HTTP_MULTIPART_H__
+#define __ESP_HTTP_MULTIPART_H__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#include "esp_http.h"
+
+/**
+ * Buffer sizes, delimiter is CRLF, two dashes, at most 70 boundary characters and the terminator
+ */
+#define HTTP_MULTIPART_BOUNDARY_LENGTH 70
+#define HTTP_MULTIPART_DELIMITER_LENGTH ( 4 + HTTP_MULTIPART_BOUNDARY_LENGTH + 1 )
+#define HTTP_MULTIPART_LINE_LENGTH 128
+#define HTTP_MULTIPART_NAME_LENGTH 32
+#define HTTP_MULTIPART_FILENAME_LENGTH 64
+#define HTTP_MULTIPART_CONTENT_TYPE_LENGTH 48
+
+/**
+ * Parser states
+ */
+typedef enum {
+    HTTP_MULTIPART_PREAMBLE = 0,
+    HTTP_MULTIPART_BOUNDARY,
+    HTTP_MULTIPART_HEADERS,
+    HTTP_MULTIPART_DATA,
+    HTTP_MULTIPART_EPILOGUE
+} http_multipart_state_type;
+
+/**
+ * Events passed to the part callback
+ */
+typedef enum {
+    HTTP_MULTIPART_PART_BEGIN = 1,
+    HTTP_MULTIPART_PART_DATA,
+    HTTP_MULTIPART_PART_END
+} http_multipart_event_type;
+
+typedef struct http_multipart_context http_multipart_context_type;
+
+typedef void ( *http_multipart_callback_type )( http_multipart_context_type*, http_multipart_event_type, uint8_t*, uint32_t );
+
+/**
+ * Parser context, holds the boundary tables and the current part details
+ */
+struct http_multipart_context {
+    http_multipart_state_type state;
+    http_multipart_callback_type part_callback;
+    void* arg;
+
+    uint8_t delimiter[ HTTP_MULTIPART_DELIMITER_LENGTH ];
+    uint8_t delimiter_length;
+    uint8_t skip[ 256 ];
+
+    uint8_t held[ HTTP_MULTIPART_DELIMITER_LENGTH ];
+    uint8_t held_length;
+
+    uint8_t line[ HTTP_MULTIPART_LINE_LENGTH ];
+    uint8_t line_length;
+
+    uint8_t name[ HTTP_MULTIPART_NAME_LENGTH ];
+    uint8_t filename[ HTTP_MULTIPART_FILENAME_LENGTH ];
+    uint8_t content_type[ HTTP_MULTIPART_CONTENT_TYPE_LENGTH ];
+    uint32_t part_length;
+};
+
+uint8_t ICACHE_FLASH_ATTR http_multipart_initialize( http_multipart_context_type* context, uint8_t* content_type, http_multipart_callback_type fn, void* arg );
+uint8_t ICACHE_FLASH_ATTR http_multipart_request_initialize( http_multipart_context_type* context, http_request_object_type* request, http_multipart_callback_type fn, void* arg );
+void ICACHE_FLASH_ATTR http_multipart_feed( http_multipart_context_type* context, uint8_t* data, uint32_t length );
+uint8_t ICACHE_FLASH_ATTR http_multipart_finished( http_multipart_context_type* context );
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * \brief		HTTP Server-Sent Events
+ * \file		esp_http_sse.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HTTP_SSE_C__
+#define __ESP_HTTP_SSE_C__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#include "esp_http_sse.h"
+
+
+/**
+ * Register a path as an event stream, Last-Event-ID is saved for its requests
+ */
+void ICACHE_FLASH_ATTR http_sse_register_route( uint8_t* path )
+{
+    http_route_scheme_add( path, HTTP_REQUEST_SCHEME | SSE_REQUEST_SCHEME );
+}
+
+/**
+ * Initializes an empty channel
+ */
+void ICACHE_FLASH_ATTR http_sse_channel_initialize( http_sse_channel_type* channel )
+{
+    uint8_t i;
+
+    for( i = 0; i < HTTP_SSE_HISTORY_LENGTH ; i++ )
+        channel->history[ i ].id = 0;
+    channel->last_id = 0;
+    channel->clients = NULL;
+}
+
+/**
+ * Find a stored event, NULL if it was already overwritten
+ */
+LOCAL http_sse_event_type* ICACHE_FLASH_ATTR http_sse_event_get( http_sse_channel_type* channel, uint32_t id )
+{
+    http_sse_event_type* event = &( channel->history[ id % HTTP_SSE_HISTORY_LENGTH ] );
+
+    if( id == 0 || event->id != id ) return NULL;
+    return event;
+}
+
+/**
+ * Queue an event for a client, coalesced events replace a pending one of the same name
+ */
+LOCAL void ICACHE_FLASH_ATTR http_sse_client_enqueue( http_sse_channel_type* channel, http_sse_client_type* client, http_sse_event_type* event, uint8_t coalesce )
+{
+    http_sse_event_type* pending;
+    uint8_t i, j, slot;
+
+    if( coalesce && event->name[ 0 ] != '\0' ) {
+        for( i = 0; i < client->queue_count ; i++ ) {
+            slot = ( client->queue_head + i ) % HTTP_SSE_QUEUE_LENGTH;
+            pending = http_sse_event_get( channel, client->queue[ slot ] );
+            if( pending == NULL || strcmp( ( char* ) pending->name, ( char* ) event->name ) != 0 ) continue;
+            // remove it, the replacement goes to the back so ids stay in order
+            for( j = i + 1; j < client->queue_count ; j++ )
+                client->queue[ ( client->queue_head + j - 1 ) % HTTP_SSE_QUEUE_LENGTH ] = client->queue[ ( client->queue_head + j ) % HTTP_SSE_QUEUE_LENGTH ];
+            client->queue_count--;
+            break;
+        }
+    }
+    if( client->queue_count == HTTP_SSE_QUEUE_LENGTH ) {
+        // full, drop the oldest
+        client->queue_head = ( client->queue_head + 1 ) % HTTP_SSE_QUEUE_LENGTH;
+        client->queue_count--;
+        client->dropped++;
+    }
+    client->queue[ ( client->queue_head + client->queue_count ) % HTTP_SSE_QUEUE_LENGTH ] = event->id;
+    client->queue_count++;
+}
+
+/**
+ * Attach a client to the channel, replays the stored events newer than the request Last-Event-ID
+ */
+void ICACHE_FLASH_ATTR http_sse_client_attach( http_sse_channel_type* channel, http_sse_client_type* client, http_request_object_type* request, void* arg )
+{
+    char last_event_id[ 14 ] = "Last-Event-ID";
+    http_header_field_type* header = NULL;
+    http_sse_event_type* event;
+    uint32_t id;
+
+    client->queue_head = client->queue_count = 0;
+    client->dropped = 0;
+    client->last_id = channel->last_id;
+    client->arg = arg;
+
+    if( request != NULL ) header = http_header_field_get( request->headers, ( uint8_t* ) last_event_id );
+    if( header != NULL && header->value != NULL ) {
+        parse_uint32( &( client->last_id ), header->value );
+        if( client->last_id > channel->last_id ) client->last_id = channel->last_id;
+        // events older than the history are lost
+        id = client->last_id + 1;
+        if( channel->last_id - client->last_id > HTTP_SSE_HISTORY_LENGTH ) {
+            id = channel->last_id - HTTP_SSE_HISTORY_LENGTH + 1;
+            client->dropped = id - client->last_id - 1;
+        }
+        for( ; id <= channel->last_id ; id++ )
+            if( ( event = http_sse_event_get( channel, id ) ) != NULL ) http_sse_client_enqueue( channel, client, event, 0x00 );
+    }
+
+    client->chain = channel->clients;
+    channel->clients = client;
+}
+
+/**
+ * Remove a client from the channel
+ */
+void ICACHE_FLASH_ATTR http_sse_client_detach( http_sse_channel_type* channel, http_sse_client_type* client )
+{
+    http_sse_client_type** p = &( channel->clients );
+
+    while( ( *p ) != NULL ) {
+        if( ( *p ) == client ) {
+            ( *p ) = client->chain;
+            break;
+        }
+        p = &( ( *p )->chain );
+    }
+    client->chain = NULL;
+}
+
+/**
+ * Number of events waiting to be sent
+ */
+uint8_t ICACHE_FLASH_ATTR http_sse_client_pending( http_sse_client_type* client )
+{
+    return client->queue_count;
+}
+
+/**
+ * Store an event and queue it for every client, returns the event id or 0 if it doesn't fit
+ */
+uint32_t ICACHE_FLASH_ATTR http_sse_publish( http_sse_channel_type* channel, uint8_t* name, uint8_t* data, uint16_t length, uint8_t coalesce )
+{
+    http_sse_client_type* client;
+    http_sse_event_type* event;
+    uint8_t i = 0;
+
+    if( length > HTTP_SSE_EVENT_DATA_LENGTH ) return 0;
+    channel->last_id++;
+    event = &( channel->history[ channel->last_id % HTTP_SSE_HISTORY_LENGTH ] );
+    event->id = channel->last_id;
+    if( name != NULL )
+        for( ; name[ i ] != '\0' && i < HTTP_SSE_EVENT_NAME_LENGTH - 1 ; i++ )
+            event->name[ i ] = name[ i ];
+    event->name[ i ] = '\0';
+    os_memcpy( event->data, data, length );
+    event->length = length;
+
+    for( client = channel->clients; client != NULL ; client = client->chain )
+        http_sse_client_enqueue( channel, client, event, coalesce );
+    return event->id;
+}
+
+
+/**
+ * Write the decimal value, returns the number of digits
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR http_sse_write_uint32( uint8_t* text, uint32_t value )
+{
+    uint8_t digits[ 10 ], i = 0, n;
+
+    do {
+        digits[ i++ ] = '0' + ( value % 10 );
+        value /= 10;
+    } while( value > 0 );
+    for( n = i; i > 0 ; i-- )
+        *( text++ ) = digits[ i - 1 ];
+    return n;
+}
+
+/**
+ * Length of the formatted event
+ */
+LOCAL uint16_t ICACHE_FLASH_ATTR http_sse_event_length( http_sse_event_type* event )
+{
+    uint8_t digits[ 10 ];
+    uint16_t length, i;
+
+    // id: <id>\n and the closing empty line
+    length = 4 + http_sse_write_uint32( digits, event->id ) + 1 + 1;
+    if( event->name[ 0 ] != '\0' ) length += 7 + strlen( ( char* ) event->name ) + 1;
+    // data: prefix for every line
+    length += 6 + event->length + 1;
+    for( i = 0; i < event->length ; i++ )
+        if( event->data[ i ] == '\n' ) length += 6;
+    return length;
+}
+
+/**
+ * Format an event, multi-line data is split into several data fields
+ */
+LOCAL uint8_t* ICACHE_FLASH_ATTR http_sse_event_output( uint8_t* text, http_sse_event_type* event )
+{
+    char id[ 5 ] = "id: ", name[ 8 ] = "event: ", data[ 7 ] = "data: ";
+    uint16_t i;
+
+    os_memcpy( text, id, 4 ); text += 4;
+    text += http_sse_write_uint32( text, event->id );
+    *( text++ ) = '\n';
+    if( event->name[ 0 ] != '\0' ) {
+        os_memcpy( text, name, 7 ); text += 7;
+        for( i = 0; event->name[ i ] != '\0' ; i++ )
+            *( text++ ) = event->name[ i ];
+        *( text++ ) = '\n';
+    }
+    os_memcpy( text, data, 6 ); text += 6;
+    for( i = 0; i < event->length ; i++ ) {
+        *( text++ ) = event->data[ i ];
+        if( event->data[ i ] == '\n' ) {
+            os_memcpy( text, data, 6 );
+            text += 6;
+        }
+    }
+    *( text++ ) = '\n';
+    *( text++ ) = '\n';
+    return text;
+}
+
+/**
+ * Write the response head which opens the event stream
+ */
+uint16_t ICACHE_FLASH_ATTR http_sse_response_head( uint8_t* text )
+{
+    char head[ 102 ] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n";
+    char retry[ 8 ] = "retry: ";
+    uint8_t* start = text;
+    uint8_t n = strlen( head );
+
+    os_memcpy( text, head, n ); text += n;
+    os_memcpy( text, retry, 7 ); text += 7;
+    text += http_sse_write_uint32( text, HTTP_SSE_RETRY );
+    *( text++ ) = '\n';
+    *( text++ ) = '\n';
+    return ( uint16_t ) ( text - start );
+}
+
+/**
+ * Format as many whole queued events as fit into the buffer, returns the length to send
+ */
+uint16_t ICACHE_FLASH_ATTR http_sse_client_flush( http_sse_channel_type* channel, http_sse_client_type* client, uint8_t* buffer, uint16_t capacity )
+{
+    http_sse_event_type* event;
+    uint8_t* text = buffer;
+    uint16_t length;
+
+    while( client->queue_count > 0 ) {
+        event = http_sse_event_get( channel, client->queue[ client->queue_head ] );
+        if( event != NULL ) {
+            length = http_sse_event_length( event );
+            if( ( uint16_t ) ( text - buffer ) + length > capacity ) {
+                // leave it for the next flush, unless it can never fit
+                if( text != buffer ) break;
+                client->dropped++;
+            } else {
+                text = http_sse_event_output( text, event );
+                client->last_id = event->id;
+            }
+        } else client->dropped++;
+        client->queue_head = ( client->queue_head + 1 ) % HTTP_SSE_QUEUE_LENGTH;
+        client->queue_count--;
+    }
+    return ( uint16_t ) ( text - buffer );
+}
+
+/**
+ * Comment line which keeps proxies from closing an idle stream
+ */
+uint16_t ICACHE_FLASH_ATTR http_sse_keepalive( uint8_t* text )
+{
+    text[ 0 ] = ':'; text[ 1 ] = '\n'; text[ 2 ] = '\n';
+    return 3;
+}
+
+
+#endif
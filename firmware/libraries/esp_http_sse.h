@@ -0,0 +1,92 @@
+/**
+ * \brief		HTTP Server-Sent Events
+ * \file		esp_http_sse.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * One-way push over a kept open HTTP response ( text/event-stream ). Published events are stored once in the
+ * channel history ring and every attached client keeps a small queue of event ids still to be sent, so the
+ * memory use is fixed by the history and queue sizes regardless of how slow a client drains.
+ *
+ * Events published with coalescing replace the pending event of the same name in every client queue, a slow
+ * client only receives the latest reading instead of the backlog. When a queue is full the oldest event is
+ * dropped. A reconnecting browser sends Last-Event-ID and gets the newer events still in the history replayed.
+ */
+#ifndef __ESP_HTTP_SSE_H__
+#define __ESP_HTTP_SSE_H__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#include "esp_http.h"
+
+/**
+ * Channel history and client queue sizes
+ */
+#ifndef HTTP_SSE_HISTORY_LENGTH
+#define HTTP_SSE_HISTORY_LENGTH 8
+#endif
+#ifndef HTTP_SSE_QUEUE_LENGTH
+#define HTTP_SSE_QUEUE_LENGTH 8
+#endif
+#define HTTP_SSE_EVENT_NAME_LENGTH 16
+#define HTTP_SSE_EVENT_DATA_LENGTH 128
+
+/**
+ * Reconnect delay advertised to the browser, in milliseconds
+ */
+#define HTTP_SSE_RETRY 3000
+
+/**
+ * Stored event
+ */
+typedef struct http_sse_event {
+    uint32_t id;
+    uint8_t name[ HTTP_SSE_EVENT_NAME_LENGTH ];
+    uint16_t length;
+    uint8_t data[ HTTP_SSE_EVENT_DATA_LENGTH ];
+} http_sse_event_type;
+
+/**
+ * Attached client, the connection is kept in arg
+ */
+typedef struct http_sse_client http_sse_client_type;
+
+struct http_sse_client {
+    uint32_t queue[ HTTP_SSE_QUEUE_LENGTH ];
+    uint8_t queue_head;
+    uint8_t queue_count;
+
+    uint32_t last_id;
+    uint32_t dropped;
+    void* arg;
+
+    http_sse_client_type* chain;
+};
+
+/**
+ * Event channel
+ */
+typedef struct http_sse_channel {
+    http_sse_event_type history[ HTTP_SSE_HISTORY_LENGTH ];
+    uint32_t last_id;
+
+    http_sse_client_type* clients;
+} http_sse_channel_type;
+
+void ICACHE_FLASH_ATTR http_sse_register_route( uint8_t* path );
+void ICACHE_FLASH_ATTR http_sse_channel_initialize( http_sse_channel_type* channel );
+
+void ICACHE_FLASH_ATTR http_sse_client_attach( http_sse_channel_type* channel, http_sse_client_type* client, http_request_object_type* request, void* arg );
+void ICACHE_FLASH_ATTR http_sse_client_detach( http_sse_channel_type* channel, http_sse_client_type* client );
+uint8_t ICACHE_FLASH_ATTR http_sse_client_pending( http_sse_client_type* client );
+
+uint32_t ICACHE_FLASH_ATTR http_sse_publish( http_sse_channel_type* channel, uint8_t* name, uint8_t* data, uint16_t length, uint8_t coalesce );
+
+uint16_t ICACHE_FLASH_ATTR http_sse_response_head( uint8_t* text );
+uint16_t ICACHE_FLASH_ATTR http_sse_client_flush( http_sse_channel_type* channel, http_sse_client_type* client, uint8_t* buffer, uint16_t capacity );
+uint16_t ICACHE_FLASH_ATTR http_sse_keepalive( uint8_t* text );
+
+#endif
@@ -0,0 +1,560 @@
+/**
+ * \brief		Streaming JSON Writer and Tokenizer
+ * \file		esp_json.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_JSON_C__
+#define __ESP_JSON_C__
+
+#include "osapi.h"
+
+#include "esp_json.h"
+
+
+/**
+ * Pass the buffered output to the flush callback
+ */
+LOCAL void ICACHE_FLASH_ATTR json_writer_flush( json_writer_type* writer, uint8_t flags )
+{
+    if( writer->flush == NULL ) return;
+    if( ! writer->flushed ) flags |= JSON_FLUSH_FIRST;
+    writer->flush( writer->arg, writer->buffer, writer->fill, flags );
+    writer->fill = 0;
+    writer->flushed = 1;
+}
+
+/**
+ * Output one character
+ */
+LOCAL void ICACHE_FLASH_ATTR json_put( json_writer_type* writer, uint8_t c )
+{
+    if( writer->fill == writer->capacity )
+        json_writer_flush( writer, 0x00 );
+    if( writer->fill == writer->capacity ) {
+        writer->error = 1;
+        return;
+    }
+    writer->buffer[ writer->fill++ ] = c;
+    writer->length++;
+}
+
+/**
+ * Output a string without escaping
+ */
+LOCAL void ICACHE_FLASH_ATTR json_put_text( json_writer_type* writer, char* text )
+{
+    while( *( text ) != '\0' )
+        json_put( writer, ( uint8_t ) *( text++ ) );
+}
+
+/**
+ * Output the member separator if the current container already has members
+ */
+LOCAL void ICACHE_FLASH_ATTR json_write_separator( json_writer_type* writer )
+{
+    uint32_t bit;
+
+    if( writer->after_key ) {
+        writer->after_key = 0;
+        return;
+    }
+    if( writer->depth == 0 ) return;
+    bit = 1UL << ( writer->depth - 1 );
+    if( writer->members & bit ) json_put( writer, ',' );
+    writer->members |= bit;
+}
+
+/**
+ * Open an object or array
+ */
+LOCAL void ICACHE_FLASH_ATTR json_write_container_begin( json_writer_type* writer, uint8_t is_object )
+{
+    uint32_t bit;
+
+    json_write_separator( writer );
+    if( writer->depth == JSON_MAX_DEPTH ) {
+        writer->error = 1;
+        return;
+    }
+    json_put( writer, is_object ? '{' : '[' );
+    bit = 1UL << ( writer->depth++ );
+    if( is_object ) writer->containers |= bit;
+    else writer->containers &= ~bit;
+    writer->members &= ~bit;
+}
+
+/**
+ * Close the current object or array
+ */
+LOCAL void ICACHE_FLASH_ATTR json_write_container_end( json_writer_type* writer, uint8_t is_object )
+{
+    if( writer->depth == 0 ) {
+        writer->error = 1;
+        return;
+    }
+    writer->depth--;
+    json_put( writer, is_object ? '}' : ']' );
+}
+
+/**
+ * Initializes the writer over the given buffer
+ */
+void ICACHE_FLASH_ATTR json_writer_initialize( json_writer_type* writer, uint8_t* buffer, uint16_t capacity, json_writer_flush_type flush, void* arg )
+{
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    writer->fill = 0;
+    writer->flush = flush;
+    writer->arg = arg;
+    writer->containers = writer->members = 0;
+    writer->depth = writer->after_key = writer->flushed = writer->error = 0;
+    writer->length = 0;
+}
+
+void ICACHE_FLASH_ATTR json_write_object_begin( json_writer_type* writer )
+{
+    json_write_container_begin( writer, 1 );
+}
+
+void ICACHE_FLASH_ATTR json_write_object_end( json_writer_type* writer )
+{
+    json_write_container_end( writer, 1 );
+}
+
+void ICACHE_FLASH_ATTR json_write_array_begin( json_writer_type* writer )
+{
+    json_write_container_begin( writer, 0 );
+}
+
+void ICACHE_FLASH_ATTR json_write_array_end( json_writer_type* writer )
+{
+    json_write_container_end( writer, 0 );
+}
+
+/**
+ * Output an escaped string of the given length
+ */
+void ICACHE_FLASH_ATTR json_write_string_length( json_writer_type* writer, uint8_t* value, uint16_t length )
+{
+    char hex[ 17 ] = "0123456789abcdef";
+    uint8_t c;
+
+    json_write_separator( writer );
+    json_put( writer, '"' );
+    for( ; length > 0 ; length--, value++ ) {
+        c = *( value );
+        if( c == '"' || c == '\\' ) {
+            json_put( writer, '\\' );
+            json_put( writer, c );
+        } else if( c >= 0x20 ) {
+            json_put( writer, c );
+        } else {
+            json_put( writer, '\\' );
+            if( c == '\n' ) json_put( writer, 'n' );
+            else if( c == '\r' ) json_put( writer, 'r' );
+            else if( c == '\t' ) json_put( writer, 't' );
+            else {
+                json_put_text( writer, "u00" );
+                json_put( writer, hex[ c >> 4 ] );
+                json_put( writer, hex[ c & 0x0F ] );
+            }
+        }
+    }
+    json_put( writer, '"' );
+}
+
+void ICACHE_FLASH_ATTR json_write_string( json_writer_type* writer, uint8_t* value )
+{
+    json_write_string_length( writer, value, strlen( ( char* ) value ) );
+}
+
+/**
+ * Output an object member name, the next value belongs to it
+ */
+void ICACHE_FLASH_ATTR json_write_key( json_writer_type* writer, uint8_t* key )
+{
+    json_write_string( writer, key );
+    json_put( writer, ':' );
+    writer->after_key = 1;
+}
+
+/**
+ * Output the digits of an unsigned value, at least the given count
+ */
+LOCAL void ICACHE_FLASH_ATTR json_put_digits( json_writer_type* writer, uint32_t value, uint8_t count )
+{
+    uint8_t digits[ 10 ], n = 0;
+
+    do {
+        digits[ n++ ] = '0' + ( value % 10 );
+        value /= 10;
+    } while( value != 0 || n < count );
+    while( n > 0 )
+        json_put( writer, digits[ --n ] );
+}
+
+void ICACHE_FLASH_ATTR json_write_int( json_writer_type* writer, int32_t value )
+{
+    json_write_separator( writer );
+    if( value < 0 ) json_put( writer, '-' );
+    json_put_digits( writer, ( value < 0 ) ? ( uint32_t ) ( - ( int64_t ) value ) : ( uint32_t ) value, 1 );
+}
+
+/**
+ * Output a fixed point value, e.g. 2150 with 2 decimals is written as 21.50. At most 9 decimals are written, the
+ * scale has to fit 32 bits.
+ */
+void ICACHE_FLASH_ATTR json_write_fixed( json_writer_type* writer, int32_t value, uint8_t decimals )
+{
+    uint32_t magnitude = ( value < 0 ) ? ( uint32_t ) ( - ( int64_t ) value ) : ( uint32_t ) value, scale = 1;
+    uint8_t i;
+
+    if( decimals > 9 ) decimals = 9;
+    for( i = 0; i < decimals ; i++ )
+        scale *= 10;
+    json_write_separator( writer );
+    if( value < 0 ) json_put( writer, '-' );
+    json_put_digits( writer, magnitude / scale, 1 );
+    if( decimals == 0 ) return;
+    json_put( writer, '.' );
+    json_put_digits( writer, magnitude % scale, decimals );
+}
+
+void ICACHE_FLASH_ATTR json_write_bool( json_writer_type* writer, uint8_t value )
+{
+    json_write_separator( writer );
+    json_put_text( writer, value ? "true" : "false" );
+}
+
+void ICACHE_FLASH_ATTR json_write_null( json_writer_type* writer )
+{
+    json_write_separator( writer );
+    json_put_text( writer, "null" );
+}
+
+/**
+ * Flush the remaining output, returns the document length
+ */
+uint32_t ICACHE_FLASH_ATTR json_writer_finish( json_writer_type* writer )
+{
+    json_writer_flush( writer, JSON_FLUSH_FINAL );
+    return writer->length;
+}
+
+
+/**
+ * Report a syntax error and stop parsing
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_error( json_reader_type* reader )
+{
+    reader->state = JSON_READ_ERROR;
+    reader->callback( reader, JSON_EVENT_ERROR, NULL, 0 );
+}
+
+/**
+ * Report the collected token
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_emit( json_reader_type* reader, json_event_type event, uint8_t partial )
+{
+    reader->token[ reader->token_length ] = '\0';
+    reader->partial = partial;
+    reader->callback( reader, event, reader->token, reader->token_length );
+    reader->token_length = 0;
+}
+
+/**
+ * Append to the string token, long strings are reported in pieces
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_append( json_reader_type* reader, uint8_t c )
+{
+    if( reader->token_length >= JSON_TOKEN_LENGTH - 4 )
+        json_reader_emit( reader, reader->is_key ? JSON_EVENT_KEY : JSON_EVENT_STRING, 1 );
+    reader->token[ reader->token_length++ ] = c;
+}
+
+/**
+ * Append an unicode code point as UTF-8
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_append_unicode( json_reader_type* reader, uint32_t code )
+{
+    if( code < 0x80 ) {
+        json_reader_append( reader, code );
+    } else if( code < 0x800 ) {
+        json_reader_append( reader, 0xC0 | ( code >> 6 ) );
+        json_reader_append( reader, 0x80 | ( code & 0x3F ) );
+    } else if( code < 0x10000 ) {
+        json_reader_append( reader, 0xE0 | ( code >> 12 ) );
+        json_reader_append( reader, 0x80 | ( ( code >> 6 ) & 0x3F ) );
+        json_reader_append( reader, 0x80 | ( code & 0x3F ) );
+    } else {
+        json_reader_append( reader, 0xF0 | ( code >> 18 ) );
+        json_reader_append( reader, 0x80 | ( ( code >> 12 ) & 0x3F ) );
+        json_reader_append( reader, 0x80 | ( ( code >> 6 ) & 0x3F ) );
+        json_reader_append( reader, 0x80 | ( code & 0x3F ) );
+    }
+}
+
+/**
+ * A value was completed, continue in the enclosing container
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_value_end( json_reader_type* reader )
+{
+    reader->state = ( reader->depth == 0 ) ? JSON_READ_DONE : JSON_READ_COMMA_OR_END;
+}
+
+/**
+ * Open an object or array
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_push( json_reader_type* reader, uint8_t is_object )
+{
+    uint32_t bit;
+
+    if( reader->depth == JSON_MAX_DEPTH ) {
+        json_reader_error( reader );
+        return;
+    }
+    bit = 1UL << ( reader->depth++ );
+    if( is_object ) reader->containers |= bit;
+    else reader->containers &= ~bit;
+    reader->state = is_object ? JSON_READ_KEY_OR_END : JSON_READ_VALUE_OR_END;
+    reader->callback( reader, is_object ? JSON_EVENT_OBJECT_BEGIN : JSON_EVENT_ARRAY_BEGIN, NULL, 0 );
+}
+
+/**
+ * Close the current container if it matches
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_pop( json_reader_type* reader, uint8_t is_object )
+{
+    uint8_t top_is_object;
+
+    if( reader->depth == 0 ) {
+        json_reader_error( reader );
+        return;
+    }
+    top_is_object = ( reader->containers >> ( reader->depth - 1 ) ) & 0x01;
+    if( top_is_object != is_object ) {
+        json_reader_error( reader );
+        return;
+    }
+    reader->depth--;
+    reader->callback( reader, is_object ? JSON_EVENT_OBJECT_END : JSON_EVENT_ARRAY_END, NULL, 0 );
+    json_reader_value_end( reader );
+}
+
+/**
+ * Start a value from its first character
+ */
+LOCAL void ICACHE_FLASH_ATTR json_reader_value_start( json_reader_type* reader, uint8_t c )
+{
+    reader->token_length = 0;
+    if( c == '{' ) json_reader_push( reader, 1 );
+    else if( c == '[' ) json_reader_push( reader, 0 );
+    else if( c == '"' ) {
+        reader->is_key = 0;
+        reader->state = JSON_READ_STRING;
+    } else if( c == '-' || isdigit( c ) ) {
+        reader->token[ reader->token_length++ ] = c;
+        reader->state = JSON_READ_NUMBER;
+    } else if( c == 't' || c == 'f' || c == 'n' ) {
+        reader->literal = ( c == 't' ) ? 0 : ( c == 'f' ) ? 1 : 2;
+        reader->literal_index = 1;
+        reader->state = JSON_READ_LITERAL;
+    } else json_reader_error( reader );
+}
+
+/**
+ * Initializes the reader and registers the event callback
+ */
+void ICACHE_FLASH_ATTR json_reader_initialize( json_reader_type* reader, json_reader_callback_type fn, void* arg )
+{
+    reader->state = JSON_READ_VALUE;
+    reader->callback = fn;
+    reader->arg = arg;
+    reader->containers = 0;
+    reader->depth = reader->is_key = reader->partial = 0;
+    reader->token_length = 0;
+    reader->surrogate = 0;
+}
+
+/**
+ * Feeds one more character to the reader
+ */
+void ICACHE_FLASH_ATTR json_reader_feed_one( json_reader_type* reader, uint8_t c )
+{
+    char literals[ 3 ][ 6 ] = { "true", "false", "null" };
+    json_event_type literal_events[ 3 ] = { JSON_EVENT_TRUE, JSON_EVENT_FALSE, JSON_EVENT_NULL };
+    uint32_t code;
+
+    switch( reader->state ) {
+        case JSON_READ_STRING:
+            if( c == '"' ) {
+                json_reader_emit( reader, reader->is_key ? JSON_EVENT_KEY : JSON_EVENT_STRING, 0 );
+                if( reader->is_key ) reader->state = JSON_READ_COLON;
+                else json_reader_value_end( reader );
+            } else if( c == '\\' ) {
+                reader->state = JSON_READ_ESCAPE;
+            } else if( c < 0x20 ) {
+                json_reader_error( reader );
+            } else json_reader_append( reader, c );
+            return;
+
+        case JSON_READ_ESCAPE:
+            reader->state = JSON_READ_STRING;
+            if( c == 'n' ) c = '\n';
+            else if( c == 'r' ) c = '\r';
+            else if( c == 't' ) c = '\t';
+            else if( c == 'b' ) c = '\b';
+            else if( c == 'f' ) c = '\f';
+            else if( c == 'u' ) {
+                reader->state = JSON_READ_UNICODE;
+                reader->unicode = 0;
+                reader->unicode_digits = 0;
+                return;
+            } else if( c != '"' && c != '\\' && c != '/' ) {
+                json_reader_error( reader );
+                return;
+            }
+            json_reader_append( reader, c );
+            return;
+
+        case JSON_READ_UNICODE:
+            if( ! isxdigit( c ) ) {
+                json_reader_error( reader );
+                return;
+            }
+            reader->unicode = ( reader->unicode << 4 ) | ( ( c <= '9' ) ? c - '0' : 10 + toupper( c ) - 'A' );
+            if( ++( reader->unicode_digits ) < 4 ) return;
+            reader->state = JSON_READ_STRING;
+            // combine surrogate pairs
+            if( reader->unicode >= 0xD800 && reader->unicode < 0xDC00 ) {
+                reader->surrogate = reader->unicode;
+                return;
+            }
+            code = reader->unicode;
+            if( reader->surrogate != 0 && code >= 0xDC00 && code < 0xE000 )
+                code = 0x10000 + ( ( ( uint32_t ) reader->surrogate - 0xD800 ) << 10 ) + ( code - 0xDC00 );
+            reader->surrogate = 0;
+            json_reader_append_unicode( reader, code );
+            return;
+
+        case JSON_READ_NUMBER:
+            if( isdigit( c ) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-' ) {
+                if( reader->token_length == JSON_TOKEN_LENGTH - 1 ) json_reader_error( reader );
+                else reader->token[ reader->token_length++ ] = c;
+                return;
+            }
+            json_reader_emit( reader, JSON_EVENT_NUMBER, 0 );
+            json_reader_value_end( reader );
+            json_reader_feed_one( reader, c );
+            return;
+
+        case JSON_READ_LITERAL:
+            if( c != ( uint8_t ) literals[ reader->literal ][ reader->literal_index ] ) {
+                json_reader_error( reader );
+                return;
+            }
+            if( literals[ reader->literal ][ ++( reader->literal_index ) ] == '\0' ) {
+                reader->callback( reader, literal_events[ reader->literal ], NULL, 0 );
+                json_reader_value_end( reader );
+            }
+            return;
+
+        case JSON_READ_ERROR:
+            return;
+
+        default:
+            break;
+    }
+
+    if( isspace( c ) ) return;
+
+    switch( reader->state ) {
+        case JSON_READ_VALUE_OR_END:
+            if( c == ']' ) {
+                json_reader_pop( reader, 0 );
+                return;
+            }
+            // fall through
+        case JSON_READ_VALUE:
+            json_reader_value_start( reader, c );
+            return;
+
+        case JSON_READ_KEY_OR_END:
+            if( c == '}' ) {
+                json_reader_pop( reader, 1 );
+                return;
+            }
+            // fall through
+        case JSON_READ_KEY:
+            if( c != '"' ) break;
+            reader->is_key = 1;
+            reader->token_length = 0;
+            reader->state = JSON_READ_STRING;
+            return;
+
+        case JSON_READ_COLON:
+            if( c != ':' ) break;
+            reader->state = JSON_READ_VALUE;
+            return;
+
+        case JSON_READ_COMMA_OR_END:
+            if( c == ',' ) {
+                reader->state = ( ( reader->containers >> ( reader->depth - 1 ) ) & 0x01 ) ? JSON_READ_KEY : JSON_READ_VALUE;
+                return;
+            }
+            if( c == '}' || c == ']' ) {
+                json_reader_pop( reader, c == '}' );
+                return;
+            }
+            break;
+
+        default:
+            break;
+    }
+    json_reader_error( reader );
+}
+
+/**
+ * Feeds the next chunk of the document
+ */
+void ICACHE_FLASH_ATTR json_reader_feed( json_reader_type* reader, uint8_t* data, uint32_t length )
+{
+    while( length -- )
+        json_reader_feed_one( reader, *( data++ ) );
+}
+
+/**
+ * Checks if a complete top level value was read, a trailing number is completed here
+ */
+uint8_t ICACHE_FLASH_ATTR json_reader_finished( json_reader_type* reader )
+{
+    if( reader->state == JSON_READ_NUMBER && reader->depth == 0 ) {
+        json_reader_emit( reader, JSON_EVENT_NUMBER, 0 );
+        reader->state = JSON_READ_DONE;
+    }
+    return reader->state == JSON_READ_DONE;
+}
+
+/**
+ * Parse an integer number token
+ */
+int32_t ICACHE_FLASH_ATTR json_parse_int( uint8_t* data, uint16_t length )
+{
+    int32_t value = 0;
+    uint8_t negative = 0;
+
+    if( length > 0 && ( *data ) == '-' ) {
+        negative = 1;
+        data++;
+        length--;
+    }
+    for( ; length > 0 && isdigit( *data ) ; length--, data++ )
+        value = ( value * 10 ) + ( ( *data ) - '0' );
+    return negative ? -value : value;
+}
+
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * \brief		Streaming JSON Writer and Tokenizer
+ * \file		esp_json.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Allocation free JSON encoding and decoding. The writer fills a caller buffer and hands it to a flush callback
+ * whenever it is full, so a document of any size can be sent through a small buffer, either as the HTTP body or as
+ * WebSocket frames ( text frame first, continuation frames after, FIN on the final flush ). The reader is fed
+ * chunk by chunk, the same way as the WebSocket decoder, and reports SAX style events. Strings longer than the
+ * token buffer are reported in pieces with the partial flag set. Nesting is tracked in a bit stack, so stack and
+ * context use are fixed and independent of the document size.
+ */
+#ifndef __ESP_JSON_H__
+#define __ESP_JSON_H__
+
+#include "osapi.h"
+
+/**
+ * Maximum nesting depth and token buffer size
+ */
+#define JSON_MAX_DEPTH 32
+#define JSON_TOKEN_LENGTH 64
+
+/**
+ * Flush flags
+ */
+#define JSON_FLUSH_FIRST 0x01
+#define JSON_FLUSH_FINAL 0x02
+
+typedef void ( *json_writer_flush_type )( void* arg, uint8_t* data, uint16_t length, uint8_t flags );
+
+/**
+ * Writer context
+ */
+typedef struct json_writer {
+    uint8_t* buffer;
+    uint16_t capacity;
+    uint16_t fill;
+    json_writer_flush_type flush;
+    void* arg;
+
+    uint32_t containers;
+    uint32_t members;
+    uint8_t depth;
+    uint8_t after_key;
+    uint8_t flushed;
+    uint8_t error;
+    uint32_t length;
+} json_writer_type;
+
+/**
+ * Reader events
+ */
+typedef enum {
+    JSON_EVENT_OBJECT_BEGIN = 1,
+    JSON_EVENT_OBJECT_END,
+    JSON_EVENT_ARRAY_BEGIN,
+    JSON_EVENT_ARRAY_END,
+    JSON_EVENT_KEY,
+    JSON_EVENT_STRING,
+    JSON_EVENT_NUMBER,
+    JSON_EVENT_TRUE,
+    JSON_EVENT_FALSE,
+    JSON_EVENT_NULL,
+    JSON_EVENT_ERROR
+} json_event_type;
+
+/**
+ * Reader states
+ */
+typedef enum {
+    JSON_READ_VALUE = 0,
+    JSON_READ_VALUE_OR_END,
+    JSON_READ_KEY,
+    JSON_READ_KEY_OR_END,
+    JSON_READ_COLON,
+    JSON_READ_COMMA_OR_END,
+    JSON_READ_STRING,
+    JSON_READ_ESCAPE,
+    JSON_READ_UNICODE,
+    JSON_READ_NUMBER,
+    JSON_READ_LITERAL,
+    JSON_READ_DONE,
+    JSON_READ_ERROR
+} json_reader_state_type;
+
+typedef struct json_reader json_reader_type;
+
+typedef void ( *json_reader_callback_type )( json_reader_type*, json_event_type, uint8_t*, uint16_t );
+
+/**
+ * Reader context
+ */
+struct json_reader {
+    json_reader_state_type state;
+    json_reader_callback_type callback;
+    void* arg;
+
+    uint32_t containers;
+    uint8_t depth;
+    uint8_t is_key;
+    uint8_t partial;
+
+    uint8_t literal;
+    uint8_t literal_index;
+    uint8_t unicode_digits;
+    uint16_t unicode;
+    uint16_t surrogate;
+
+    uint8_t token[ JSON_TOKEN_LENGTH ];
+    uint8_t token_length;
+};
+
+/**
+ * Writer functions
+ */
+void ICACHE_FLASH_ATTR json_writer_initialize( json_writer_type* writer, uint8_t* buffer, uint16_t capacity, json_writer_flush_type flush, void* arg );
+void ICACHE_FLASH_ATTR json_write_object_begin( json_writer_type* writer );
+void ICACHE_FLASH_ATTR json_write_object_end( json_writer_type* writer );
+void ICACHE_FLASH_ATTR json_write_array_begin( json_writer_type* writer );
+void ICACHE_FLASH_ATTR json_write_array_end( json_writer_type* writer );
+void ICACHE_FLASH_ATTR json_write_key( json_writer_type* writer, uint8_t* key );
+void ICACHE_FLASH_ATTR json_write_string( json_writer_type* writer, uint8_t* value );
+void ICACHE_FLASH_ATTR json_write_string_length( json_writer_type* writer, uint8_t* value, uint16_t length );
+void ICACHE_FLASH_ATTR json_write_int( json_writer_type* writer, int32_t value );
+void ICACHE_FLASH_ATTR json_write_fixed( json_writer_type* writer, int32_t value, uint8_t decimals );
+void ICACHE_FLASH_ATTR json_write_bool( json_writer_type* writer, uint8_t value );
+void ICACHE_FLASH_ATTR json_write_null( json_writer_type* writer );
+uint32_t ICACHE_FLASH_ATTR json_writer_finish( json_writer_type* writer );
+
+/**
+ * Reader functions
+ */
+void ICACHE_FLASH_ATTR json_reader_initialize( json_reader_type* reader, json_reader_callback_type fn, void* arg );
+void ICACHE_FLASH_ATTR json_reader_feed_one( json_reader_type* reader, uint8_t c );
+void ICACHE_FLASH_ATTR json_reader_feed( json_reader_type* reader, uint8_t* data, uint32_t length );
+uint8_t ICACHE_FLASH_ATTR json_reader_finished( json_reader_type* reader );
+int32_t ICACHE_FLASH_ATTR json_parse_int( uint8_t* data, uint16_t length );
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ * \brief		Firmware update over HTTP
+ * \file		esp_ota_update.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_OTA_UPDATE_C__
+#define __ESP_OTA_UPDATE_C__
+
+#include "osapi.h"
+#include "user_interface.h"
+#include "upgrade.h"
+
+#include "esp_ota_update.h"
+#include "esp_crc32.h"
+
+/**
+ * Multipart upload progress
+ */
+#define ESP_OTA_MULTIPART_NONE 0x00
+#define ESP_OTA_MULTIPART_WAIT 0x01
+#define ESP_OTA_MULTIPART_IMAGE 0x02
+#define ESP_OTA_MULTIPART_DONE 0x03
+
+
+/**
+ * Returns the address of the partition which is not running
+ */
+uint32_t ICACHE_FLASH_ATTR esp_ota_inactive_partition( void )
+{
+    if( system_upgrade_userbin_check() == UPGRADE_FW_BIN1 )
+        return ESP_OTA_USER2_ADDRESS;
+    return ESP_OTA_USER1_ADDRESS;
+}
+
+/**
+ * Erase the next sector of the partition
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_ota_erase_next( esp_ota_update_type* ota )
+{
+    if( ota->erased >= ESP_OTA_PARTITION_SIZE ) return 0x00;
+    if( SPI_FLASH_RESULT_OK != spi_flash_erase_sector( ( ota->partition_address + ota->erased ) >> 12 ) ) return 0x00;
+    ota->erased += ESP_OTA_SECTOR_SIZE;
+    return 0x01;
+}
+
+/**
+ * Erase ahead, runs after the receive callback returns so it overlaps with the next segment
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_ota_erase_ahead( void* arg )
+{
+    esp_ota_update_type* ota = ( esp_ota_update_type* ) arg;
+
+    if( ota->state == ESP_OTA_RECEIVING && ota->erased - ota->written < ESP_OTA_SECTOR_SIZE )
+        esp_ota_erase_next( ota );
+}
+
+/**
+ * Write the buffered data into the partition
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_ota_flush( esp_ota_update_type* ota )
+{
+    uint16_t length = ( ota->buffer_fill + 0x3 ) & ( ~0x3 );
+    uint32_t stall;
+
+    if( length == 0 ) return 0x01;
+    if( ota->written + length > ESP_OTA_PARTITION_SIZE ) return 0x00;
+    // pad the last word
+    os_memset( ( ( uint8_t* ) ota->buffer ) + ota->buffer_fill, 0xFF, length - ota->buffer_fill );
+    // erase ahead didn't keep up, erase in place
+    if( ota->erased < ota->written + length ) {
+        stall = system_get_time();
+        while( ota->erased < ota->written + length )
+            if( ! esp_ota_erase_next( ota ) ) return 0x00;
+        ota->stall_count ++;
+        ota->stall_time += system_get_time() - stall;
+    }
+    if( SPI_FLASH_RESULT_OK != spi_flash_write( ota->partition_address + ota->written, ota->buffer, length ) ) return 0x00;
+    ota->written += length;
+    ota->buffer_fill = 0;
+    // schedule the next erase
+    if( ota->erased - ota->written < ESP_OTA_SECTOR_SIZE && ota->erased < ESP_OTA_PARTITION_SIZE ) {
+        os_timer_disarm( &( ota->erase_timer ) );
+        os_timer_arm( &( ota->erase_timer ), 0, 0 );
+    }
+    return 0x01;
+}
+
+/**
+ * Start an update into the inactive partition
+ */
+uint8_t ICACHE_FLASH_ATTR esp_ota_begin( esp_ota_update_type* ota, uint32_t image_crc )
+{
+    ota->partition_address = esp_ota_inactive_partition();
+    ota->image_crc = image_crc;
+    ota->received = ota->written = ota->erased = 0;
+    ota->crc = ESP_CRC32_INITIAL;
+    ota->buffer_fill = 0;
+    ota->start_time = system_get_time();
+    ota->stall_count = ota->stall_time = 0;
+
+    os_timer_disarm( &( ota->erase_timer ) );
+    os_timer_setfn( &( ota->erase_timer ), ( os_timer_func_t* ) esp_ota_erase_ahead, ota );
+
+    system_upgrade_flag_set( UPGRADE_FLAG_START );
+    ota->state = esp_ota_erase_next( ota ) ? ESP_OTA_RECEIVING : ESP_OTA_FAILED;
+    return ota->state == ESP_OTA_RECEIVING;
+}
+
+/**
+ * Stream the next image chunk into flash
+ */
+uint8_t ICACHE_FLASH_ATTR esp_ota_write( esp_ota_update_type* ota, uint8_t* data, uint32_t length )
+{
+    uint8_t* buffer = ( uint8_t* ) ota->buffer;
+    uint16_t copy;
+
+    if( ota->state != ESP_OTA_RECEIVING ) return 0x00;
+    // check the image header magic
+    if( ota->received == 0 && length > 0 && data[ 0 ] != 0xE9 && data[ 0 ] != 0xEA ) {
+        esp_ota_abort( ota );
+        return 0x00;
+    }
+    ota->crc = esp_crc32_update( ota->crc, data, length );
+    ota->received += length;
+
+    while( length > 0 ) {
+        copy = ESP_OTA_BUFFER_SIZE - ota->buffer_fill;
+        if( copy > length ) copy = length;
+        os_memcpy( buffer + ota->buffer_fill, data, copy );
+        ota->buffer_fill += copy;
+        data += copy;
+        length -= copy;
+
+        if( ota->buffer_fill == ESP_OTA_BUFFER_SIZE && ! esp_ota_flush( ota ) ) {
+            esp_ota_abort( ota );
+            return 0x00;
+        }
+    }
+    return 0x01;
+}
+
+/**
+ * Flush the image, verify it against the expected checksum and mark it for boot
+ */
+uint8_t ICACHE_FLASH_ATTR esp_ota_finish( esp_ota_update_type* ota )
+{
+    uint32_t offset, crc = ESP_CRC32_INITIAL;
+    uint16_t length;
+
+    if( ota->state != ESP_OTA_RECEIVING ) return 0x00;
+    if( ! esp_ota_flush( ota ) || ota->received == 0 || ota->crc != ota->image_crc ) {
+        esp_ota_abort( ota );
+        return 0x00;
+    }
+    os_timer_disarm( &( ota->erase_timer ) );
+    // read back what landed in flash
+    for( offset = 0; offset < ota->received ; offset += length ) {
+        length = ( ota->received - offset > ESP_OTA_BUFFER_SIZE ) ? ESP_OTA_BUFFER_SIZE : ota->received - offset;
+        if( SPI_FLASH_RESULT_OK != spi_flash_read( ota->partition_address + offset, ota->buffer, ( length + 0x3 ) & ( ~0x3 ) ) ) break;
+        crc = esp_crc32_update( crc, ( uint8_t* ) ota->buffer, length );
+    }
+    if( offset < ota->received || crc != ota->image_crc ) {
+        esp_ota_abort( ota );
+        return 0x00;
+    }
+    // commit, the boot loader switches on the next restart
+    system_upgrade_flag_set( UPGRADE_FLAG_FINISH );
+    ota->state = ESP_OTA_VERIFIED;
+    return 0x01;
+}
+
+/**
+ * Cancel the update, the running image stays selected
+ */
+void ICACHE_FLASH_ATTR esp_ota_abort( esp_ota_update_type* ota )
+{
+    os_timer_disarm( &( ota->erase_timer ) );
+    system_upgrade_flag_set( UPGRADE_FLAG_IDLE );
+    ota->state = ESP_OTA_FAILED;
+}
+
+/**
+ * Restart into the verified image
+ */
+void ICACHE_FLASH_ATTR esp_ota_reboot( esp_ota_update_type* ota )
+{
+    if( ota->state == ESP_OTA_VERIFIED )
+        system_upgrade_reboot();
+}
+
+
+/**
+ * Register the update endpoint
+ */
+void ICACHE_FLASH_ATTR esp_ota_register_route( void )
+{
+    char path[ 8 ] = ESP_OTA_HTTP_PATH;
+    http_route_scheme_add( ( uint8_t* ) path, HTTP_REQUEST_SCHEME );
+}
+
+/**
+ * Passes the first file part of a multipart upload to the image writer
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_ota_multipart_part( http_multipart_context_type* context, http_multipart_event_type event, uint8_t* data, uint32_t length )
+{
+    esp_ota_update_type* ota = ( esp_ota_update_type* ) context->arg;
+
+    if( event == HTTP_MULTIPART_PART_BEGIN ) {
+        if( ota->multipart_mode == ESP_OTA_MULTIPART_WAIT && context->filename[ 0 ] != '\0' )
+            ota->multipart_mode = ESP_OTA_MULTIPART_IMAGE;
+    } else if( ota->multipart_mode == ESP_OTA_MULTIPART_IMAGE ) {
+        if( event == HTTP_MULTIPART_PART_DATA ) esp_ota_write( ota, data, length );
+        else ota->multipart_mode = ESP_OTA_MULTIPART_DONE;
+    }
+}
+
+/**
+ * Parse a hex value
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR esp_ota_parse_hex( uint8_t* data )
+{
+    uint32_t value = 0;
+    uint8_t c;
+
+    for( ; ( c = *( data ) ) != '\0' ; data++ ) {
+        if( c >= '0' && c <= '9' ) value = ( value << 4 ) | ( c - '0' );
+        else if( isxdigit( c ) ) value = ( value << 4 ) | ( 10 + toupper( c ) - 'A' );
+        else break;
+    }
+    return value;
+}
+
+/**
+ * Start an update from a parsed POST request
+ */
+uint8_t ICACHE_FLASH_ATTR esp_ota_http_begin( esp_ota_update_type* ota, http_request_object_type* request )
+{
+    char crc[ 4 ] = "crc";
+    url_query_parameter_type* parameter;
+
+    ota->state = ESP_OTA_IDLE;
+    if( request->method != HTTP_METHOD_POST || request->location == NULL ) return 0x00;
+    parameter = url_get_query_parameter( request->location, ( uint8_t* ) crc );
+    if( parameter == NULL ) return 0x00;
+
+    ota->multipart_mode = ESP_OTA_MULTIPART_NONE;
+    if( http_multipart_request_initialize( &( ota->multipart ), request, esp_ota_multipart_part, ota ) )
+        ota->multipart_mode = ESP_OTA_MULTIPART_WAIT;
+    return esp_ota_begin( ota, esp_ota_parse_hex( parameter->value ) );
+}
+
+/**
+ * Feed request body data, returns 0 once the update failed
+ */
+uint8_t ICACHE_FLASH_ATTR esp_ota_http_receive( esp_ota_update_type* ota, uint8_t* data, uint32_t length )
+{
+    if( ota->multipart_mode == ESP_OTA_MULTIPART_NONE ) return esp_ota_write( ota, data, length );
+    http_multipart_feed( &( ota->multipart ), data, length );
+    return ota->state == ESP_OTA_RECEIVING || ota->state == ESP_OTA_VERIFIED;
+}
+
+/**
+ * Complete the request body, returns 1 if the image verified and was committed
+ */
+uint8_t ICACHE_FLASH_ATTR esp_ota_http_end( esp_ota_update_type* ota )
+{
+    if( ota->multipart_mode != ESP_OTA_MULTIPART_NONE && ota->multipart_mode != ESP_OTA_MULTIPART_DONE ) {
+        if( ota->state == ESP_OTA_RECEIVING ) esp_ota_abort( ota );
+        return 0x00;
+    }
+    return esp_ota_finish( ota );
+}
+
+
+#endif
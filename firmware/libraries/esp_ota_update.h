@@ -0,0 +1,86 @@
+/**
+ * \brief		Firmware update over HTTP
+ * \file		esp_ota_update.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Streams a firmware image received over HTTP into the inactive user partition. The image body is either raw
+ * ( application/octet-stream ) or the first file part of a multipart/form-data upload. The expected CRC32 is given
+ * in the crc query parameter, e.g. POST /update?crc=1a2b3c4d.
+ *
+ * The sector after the one being written is erased from a zero delay timer, once the receive callback returns, so
+ * the erase overlaps with the reception of the next TCP segment. The image is checksummed as it streams and read
+ * back from flash before the boot flag is switched. Until then the running image stays bootable, a power loss
+ * during the transfer leaves the device on the old firmware.
+ */
+#ifndef __ESP_OTA_UPDATE_H__
+#define __ESP_OTA_UPDATE_H__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#include "esp_http.h"
+#include "esp_http_multipart.h"
+
+/**
+ * Flash layout for 512KB + 512KB user partitions
+ */
+#define ESP_OTA_SECTOR_SIZE 0x1000
+#define ESP_OTA_USER1_ADDRESS 0x00001000
+#define ESP_OTA_USER2_ADDRESS 0x00081000
+#define ESP_OTA_PARTITION_SIZE 0x0007B000
+
+#define ESP_OTA_BUFFER_SIZE 1024
+#define ESP_OTA_HTTP_PATH "/update"
+
+/**
+ * Update states
+ */
+typedef enum {
+    ESP_OTA_IDLE = 0,
+    ESP_OTA_RECEIVING,
+    ESP_OTA_VERIFIED,
+    ESP_OTA_FAILED
+} esp_ota_state_type;
+
+/**
+ * Update context
+ */
+typedef struct esp_ota_update {
+    esp_ota_state_type state;
+    uint32_t partition_address;
+    uint32_t image_crc;
+
+    uint32_t received;
+    uint32_t written;
+    uint32_t erased;
+    uint32_t crc;
+
+    uint32_t start_time;
+    uint32_t stall_count;
+    uint32_t stall_time;
+
+    os_timer_t erase_timer;
+    uint8_t multipart_mode;
+    http_multipart_context_type multipart;
+
+    uint16_t buffer_fill;
+    uint32_t buffer[ ESP_OTA_BUFFER_SIZE / sizeof( uint32_t ) ];
+} esp_ota_update_type;
+
+uint32_t ICACHE_FLASH_ATTR esp_ota_inactive_partition( void );
+
+uint8_t ICACHE_FLASH_ATTR esp_ota_begin( esp_ota_update_type* ota, uint32_t image_crc );
+uint8_t ICACHE_FLASH_ATTR esp_ota_write( esp_ota_update_type* ota, uint8_t* data, uint32_t length );
+uint8_t ICACHE_FLASH_ATTR esp_ota_finish( esp_ota_update_type* ota );
+void ICACHE_FLASH_ATTR esp_ota_abort( esp_ota_update_type* ota );
+void ICACHE_FLASH_ATTR esp_ota_reboot( esp_ota_update_type* ota );
+
+void ICACHE_FLASH_ATTR esp_ota_register_route( void );
+uint8_t ICACHE_FLASH_ATTR esp_ota_http_begin( esp_ota_update_type* ota, http_request_object_type* request );
+uint8_t ICACHE_FLASH_ATTR esp_ota_http_receive( esp_ota_update_type* ota, uint8_t* data, uint32_t length );
+uint8_t ICACHE_FLASH_ATTR esp_ota_http_end( esp_ota_update_type* ota );
+
+#endif
@@ -1,6 +1,7 @@
 #include "esp_setup_access.h"
 #include "esp_setup_configuration.h"
 #include "esp_flash_save.c"
+#include "esp_setup_parameters.c"
 
 #include "ets_sys.h"
 #include "os_type.h"
@@ -82,21 +83,32 @@ LOCAL void ICACHE_FLASH_ATTR esp_wifi_setup_access_connection( char* ssid, char*
  */
 LOCAL void ICACHE_FLASH_ATTR esp_wifi_get_access_config( char* ssid, char* password )
 {
-    char ssid_src[ WIFI_SSID_LENGTH ] = WIFI_ACCESS_SSID;
-    char password_src[ WIFI_PASSWORD_LENGTH ] = WIFI_ACCESS_PASSWORD;
-    // check if parameters don't exist
-    if( esp_flash_read_parameter( ESP_WIFI_SSID_ACCESS_ID, ssid_src ) == 0x00 )
-    {
-        // save parameter defaults in flash
-        esp_flash_save_parameter( ESP_WIFI_SSID_ACCESS_ID, ssid_src, os_strlen( ssid_src ) );
-        esp_flash_save_parameter( ESP_WIFI_PASSWORD_ACCESS_ID, password_src, os_strlen( password_src ) );
-    } else {
-        // read the other parameter
-        esp_flash_read_parameter( ESP_WIFI_PASSWORD_ACCESS_ID, password_src );
-    }
+    // stored values, or the defaults
+    esp_setup_parameters_type* parameters = esp_setup_get_parameters();
     // copy defined WiFi configuration into the given memory space
-    os_memcpy( ssid, ssid_src, os_strlen( ssid_src ) );
-    os_memcpy( password, password_src, os_strlen( password_src ) );
+    os_memcpy( ssid, parameters->access_ssid, os_strlen( parameters->access_ssid ) );
+    os_memcpy( password, parameters->access_password, os_strlen( parameters->access_password ) );
+}
+
+/**
+ * Stores a new WiFi configuration, both values or neither of them, in one flash write. Returns 0 if a value is
+ * too long for its setup field, the load would replace it with the default, or if a transaction is already open
+ */
+LOCAL uint8_t ICACHE_FLASH_ATTR esp_wifi_set_access_config( char* ssid, char* password )
+{
+    uint8_t result;
+    // strings keep room for the terminator
+    if( os_strlen( ssid ) >= ESP_FLASH_SCHEMA_SIZE( esp_setup_parameters_type, access_ssid ) ||
+        os_strlen( password ) >= ESP_FLASH_SCHEMA_SIZE( esp_setup_parameters_type, access_password ) )
+        return 0x00;
+    if( ! esp_flash_transaction_begin() )
+        return 0x00;
+    esp_flash_save_parameter( ESP_WIFI_SSID_ACCESS_ID, ( uint8_t* ) ssid, os_strlen( ssid ) );
+    esp_flash_save_parameter( ESP_WIFI_PASSWORD_ACCESS_ID, ( uint8_t* ) password, os_strlen( password ) );
+    result = esp_flash_transaction_commit();
+    // pick up the stored values
+    esp_setup_reload_parameters();
+    return result;
 }
 
 
@@ -0,0 +1,84 @@
+/**
+ * \brief		WiFi setup parameters
+ * \file		esp_setup_parameters.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_SETUP_PARAMETERS_C__
+#define __ESP_SETUP_PARAMETERS_C__
+
+#include "esp_setup_parameters.h"
+#include "esp_flash_save.c"
+
+#include "osapi.h"
+#include "user_interface.h"
+
+
+/**
+ * Defaults
+ */
+LOCAL const char esp_setup_default_access_ssid[] = WIFI_ACCESS_SSID;
+LOCAL const char esp_setup_default_access_password[] = WIFI_ACCESS_PASSWORD;
+LOCAL const uint8_t esp_setup_default_ap_mac[ 6 ] = { WIFI_AP_MAC_ADDRESS };
+LOCAL const uint8_t esp_setup_default_ap_ip[ 4 ] = { WIFI_AP_IP_SELF };
+LOCAL const uint8_t esp_setup_default_ap_gateway[ 4 ] = { WIFI_AP_IP_GATEWAY };
+LOCAL const uint8_t esp_setup_default_ap_mask[ 4 ] = { WIFI_AP_IP_MASK };
+LOCAL const uint8_t esp_setup_default_ap_security = AUTH_WPA_WPA2_PSK;
+LOCAL const uint8_t esp_setup_default_ap_hidden = 0x00;
+LOCAL const char esp_setup_default_ap_ssid[] = WIFI_AP_SSID;
+LOCAL const char esp_setup_default_ap_password[] = WIFI_AP_PASSWORD;
+LOCAL const uint8_t esp_setup_default_dhcp_enable = 0x01;
+LOCAL const uint8_t esp_setup_default_dhcp_start_ip[ 4 ] = { WIFI_DHCP_SERVER_START_IP };
+LOCAL const uint8_t esp_setup_default_dhcp_end_ip[ 4 ] = { WIFI_DHCP_SERVER_END_IP };
+
+#define ESP_SETUP_BYTES( id, field, value ) \
+    { id, ESP_FLASH_SCHEMA_BYTES, ESP_FLASH_SCHEMA_SIZE( esp_setup_parameters_type, field ), ESP_FLASH_SCHEMA_OFFSET( esp_setup_parameters_type, field ), &( value ), sizeof( value ) }
+#define ESP_SETUP_STRING( id, field, value ) \
+    { id, ESP_FLASH_SCHEMA_STRING, ESP_FLASH_SCHEMA_SIZE( esp_setup_parameters_type, field ), ESP_FLASH_SCHEMA_OFFSET( esp_setup_parameters_type, field ), value, sizeof( value ) - 1 }
+
+/**
+ * Schema
+ */
+LOCAL const esp_flash_schema_entry_type esp_setup_schema[] = {
+    ESP_SETUP_STRING( ESP_WIFI_SSID_ACCESS_ID, access_ssid, esp_setup_default_access_ssid ),
+    ESP_SETUP_STRING( ESP_WIFI_PASSWORD_ACCESS_ID, access_password, esp_setup_default_access_password ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_MAC_ID, ap_mac, esp_setup_default_ap_mac ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_IP_SELF_ID, ap_ip, esp_setup_default_ap_ip ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_IP_GATEWAY_ID, ap_gateway, esp_setup_default_ap_gateway ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_IP_MASK_ID, ap_mask, esp_setup_default_ap_mask ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_SECURITY_ID, ap_security, esp_setup_default_ap_security ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_HIDDEN_ID, ap_hidden, esp_setup_default_ap_hidden ),
+    ESP_SETUP_STRING( ESP_WIFI_SSID_APMODE_ID, ap_ssid, esp_setup_default_ap_ssid ),
+    ESP_SETUP_STRING( ESP_WIFI_PASSWORD_APMODE_ID, ap_password, esp_setup_default_ap_password ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_DHCP_ENABLE_ID, dhcp_enable, esp_setup_default_dhcp_enable ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_DHCP_START_IP_ID, dhcp_start_ip, esp_setup_default_dhcp_start_ip ),
+    ESP_SETUP_BYTES( ESP_WIFI_APMODE_DHCP_END_IP_ID, dhcp_end_ip, esp_setup_default_dhcp_end_ip )
+};
+
+LOCAL esp_setup_parameters_type esp_setup_parameters;
+LOCAL uint8_t esp_setup_parameters_loaded = 0x00;
+
+
+/**
+ * Load the setup parameters again, after some of them were saved
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_setup_reload_parameters( void )
+{
+    esp_flash_schema_load( esp_setup_schema, sizeof( esp_setup_schema ) / sizeof( esp_setup_schema[ 0 ] ), ( uint8_t* ) &esp_setup_parameters );
+    esp_setup_parameters_loaded = 0x01;
+}
+
+/**
+ * Returns the setup parameters, loaded from flash on first use
+ */
+LOCAL esp_setup_parameters_type* ICACHE_FLASH_ATTR esp_setup_get_parameters( void )
+{
+    if( esp_setup_parameters_loaded == 0x00 )
+        esp_setup_reload_parameters();
+    return &esp_setup_parameters;
+}
+
+
+#endif
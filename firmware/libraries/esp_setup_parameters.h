@@ -0,0 +1,48 @@
+/**
+ * \brief		WiFi setup parameters
+ * \file		esp_setup_parameters.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * The parameters of the station and access point setup are declared once in a schema table with their defaults
+ * and loaded at boot into one RAM struct, with a single read of the parameter sector. Parameters which were never
+ * stored are written together, so a first boot costs one sector write.
+ *
+ * The struct holds the values as loaded, a parameter saved later is picked up by esp_setup_reload_parameters.
+ */
+#ifndef __ESP_SETUP_PARAMETERS_H__
+#define __ESP_SETUP_PARAMETERS_H__
+
+#include "os_type.h"
+#include "user_interface.h"
+
+#include "esp_setup_configuration.h"
+#include "esp_flash_save.h"
+
+/**
+ * Stored setup values
+ */
+typedef struct esp_setup_parameters {
+    char access_ssid[ WIFI_SSID_LENGTH ];
+    char access_password[ WIFI_PASSWORD_LENGTH ];
+
+    uint8_t ap_mac[ 6 ];
+    uint8_t ap_ip[ 4 ];
+    uint8_t ap_gateway[ 4 ];
+    uint8_t ap_mask[ 4 ];
+    uint8_t ap_security;
+    uint8_t ap_hidden;
+    char ap_ssid[ WIFI_SSID_LENGTH ];
+    char ap_password[ WIFI_PASSWORD_LENGTH ];
+
+    uint8_t dhcp_enable;
+    uint8_t dhcp_start_ip[ 4 ];
+    uint8_t dhcp_end_ip[ 4 ];
+} esp_setup_parameters_type;
+
+LOCAL esp_setup_parameters_type* ICACHE_FLASH_ATTR esp_setup_get_parameters( void );
+LOCAL void ICACHE_FLASH_ATTR esp_setup_reload_parameters( void );
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * \brief		Hashed Timer Wheel
+ * \file		esp_timer_wheel.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_TIMER_WHEEL_C__
+#define __ESP_TIMER_WHEEL_C__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+#include "esp_timer_wheel.h"
+
+#define ESP_TIMER_WHEEL_MASK ( ESP_TIMER_WHEEL_SLOTS - 1 )
+
+
+/**
+ * Link the timer at the front of a list
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_wheel_timer_link( esp_wheel_timer_type** list, esp_wheel_timer_type* timer )
+{
+    timer->next = ( *list );
+    if( timer->next != NULL ) timer->next->link = &( timer->next );
+    timer->link = list;
+    ( *list ) = timer;
+}
+
+/**
+ * Initializes an empty wheel
+ */
+void ICACHE_FLASH_ATTR esp_timer_wheel_initialize( esp_timer_wheel_type* wheel )
+{
+    uint8_t i;
+
+    for( i = 0; i < ESP_TIMER_WHEEL_SLOTS ; i++ )
+        wheel->slots[ i ] = NULL;
+    wheel->now = 0;
+    os_timer_disarm( &( wheel->tick_timer ) );
+    os_timer_setfn( &( wheel->tick_timer ), ( os_timer_func_t* ) esp_timer_wheel_tick, wheel );
+}
+
+/**
+ * Start the periodic tick
+ */
+void ICACHE_FLASH_ATTR esp_timer_wheel_start( esp_timer_wheel_type* wheel )
+{
+    os_timer_disarm( &( wheel->tick_timer ) );
+    os_timer_arm( &( wheel->tick_timer ), ESP_TIMER_WHEEL_TICK, 1 );
+}
+
+/**
+ * Stop the periodic tick, armed timers keep their remaining time
+ */
+void ICACHE_FLASH_ATTR esp_timer_wheel_stop( esp_timer_wheel_type* wheel )
+{
+    os_timer_disarm( &( wheel->tick_timer ) );
+}
+
+/**
+ * Advance the wheel by one tick and fire the timers which expired
+ */
+void ICACHE_FLASH_ATTR esp_timer_wheel_tick( esp_timer_wheel_type* wheel )
+{
+    esp_wheel_timer_type* pending = NULL, *timer;
+    esp_wheel_timer_type** slot;
+
+    wheel->now++;
+    slot = &( wheel->slots[ wheel->now & ESP_TIMER_WHEEL_MASK ] );
+
+    // take the slot list out, callbacks may arm into this slot or cancel any pending timer
+    if( ( pending = ( *slot ) ) != NULL ) pending->link = &pending;
+    ( *slot ) = NULL;
+
+    while( ( timer = pending ) != NULL ) {
+        pending = timer->next;
+        if( pending != NULL ) pending->link = &pending;
+
+        if( ( int32_t ) ( wheel->now - timer->expiry ) >= 0 ) {
+            timer->next = NULL;
+            timer->link = NULL;
+            timer->callback( timer, timer->arg );
+        } else {
+            // a later turn of the wheel
+            esp_wheel_timer_link( slot, timer );
+        }
+    }
+}
+
+/**
+ * Initializes an unarmed timer
+ */
+void ICACHE_FLASH_ATTR esp_wheel_timer_initialize( esp_wheel_timer_type* timer, esp_wheel_timer_callback_type fn, void* arg )
+{
+    timer->next = NULL;
+    timer->link = NULL;
+    timer->expiry = 0;
+    timer->callback = fn;
+    timer->arg = arg;
+}
+
+/**
+ * Arm or rearm a timer, the delay is rounded up to whole ticks
+ */
+void ICACHE_FLASH_ATTR esp_wheel_timer_arm( esp_timer_wheel_type* wheel, esp_wheel_timer_type* timer, uint32_t milliseconds )
+{
+    uint32_t ticks = ( milliseconds + ESP_TIMER_WHEEL_TICK - 1 ) / ESP_TIMER_WHEEL_TICK;
+
+    if( ticks == 0 ) ticks = 1;
+    esp_wheel_timer_cancel( timer );
+    timer->expiry = wheel->now + ticks;
+    esp_wheel_timer_link( &( wheel->slots[ timer->expiry & ESP_TIMER_WHEEL_MASK ] ), timer );
+}
+
+/**
+ * Cancel a timer, does nothing if it isn't armed
+ */
+void ICACHE_FLASH_ATTR esp_wheel_timer_cancel( esp_wheel_timer_type* timer )
+{
+    if( timer->link == NULL ) return;
+    ( *timer->link ) = timer->next;
+    if( timer->next != NULL ) timer->next->link = timer->link;
+    timer->next = NULL;
+    timer->link = NULL;
+}
+
+/**
+ * Checks if the timer is waiting to fire
+ */
+uint8_t ICACHE_FLASH_ATTR esp_wheel_timer_armed( esp_wheel_timer_type* timer )
+{
+    return timer->link != NULL;
+}
+
+
+/**
+ * Default duration of each deadline kind
+ */
+LOCAL uint32_t ICACHE_FLASH_ATTR esp_deadline_default_timeout( esp_deadline_kind_type kind )
+{
+    switch( kind ) {
+        case ESP_DEADLINE_HEADER_READ: return ESP_DEADLINE_HEADER_READ_TIMEOUT;
+        case ESP_DEADLINE_IDLE: return ESP_DEADLINE_IDLE_TIMEOUT;
+        case ESP_DEADLINE_WS_PING: return ESP_DEADLINE_WS_PING_INTERVAL;
+        default: return ESP_DEADLINE_WRITE_STALL_TIMEOUT;
+    }
+}
+
+/**
+ * Passes an expired deadline to the connection callback
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_deadline_expired( esp_wheel_timer_type* timer, void* arg )
+{
+    esp_connection_deadlines_type* deadlines = ( esp_connection_deadlines_type* ) arg;
+
+    deadlines->callback( deadlines, ( esp_deadline_kind_type ) ( timer - deadlines->timers ) );
+}
+
+/**
+ * Initializes the deadlines of a connection, none armed
+ */
+void ICACHE_FLASH_ATTR esp_deadlines_initialize( esp_connection_deadlines_type* deadlines, esp_timer_wheel_type* wheel, esp_deadline_callback_type fn, void* arg )
+{
+    uint8_t i;
+
+    deadlines->wheel = wheel;
+    deadlines->callback = fn;
+    deadlines->arg = arg;
+    for( i = 0; i < ESP_DEADLINE_KINDS ; i++ )
+        esp_wheel_timer_initialize( &( deadlines->timers[ i ] ), esp_deadline_expired, deadlines );
+}
+
+/**
+ * Arm a deadline with its default duration
+ */
+void ICACHE_FLASH_ATTR esp_deadline_arm( esp_connection_deadlines_type* deadlines, esp_deadline_kind_type kind )
+{
+    esp_wheel_timer_arm( deadlines->wheel, &( deadlines->timers[ kind ] ), esp_deadline_default_timeout( kind ) );
+}
+
+/**
+ * Arm a deadline with the given duration
+ */
+void ICACHE_FLASH_ATTR esp_deadline_arm_timeout( esp_connection_deadlines_type* deadlines, esp_deadline_kind_type kind, uint32_t milliseconds )
+{
+    esp_wheel_timer_arm( deadlines->wheel, &( deadlines->timers[ kind ] ), milliseconds );
+}
+
+/**
+ * Cancel a deadline
+ */
+void ICACHE_FLASH_ATTR esp_deadline_cancel( esp_connection_deadlines_type* deadlines, esp_deadline_kind_type kind )
+{
+    esp_wheel_timer_cancel( &( deadlines->timers[ kind ] ) );
+}
+
+/**
+ * Cancel every deadline, call before the connection is released
+ */
+void ICACHE_FLASH_ATTR esp_deadlines_cancel_all( esp_connection_deadlines_type* deadlines )
+{
+    uint8_t i;
+
+    for( i = 0; i < ESP_DEADLINE_KINDS ; i++ )
+        esp_wheel_timer_cancel( &( deadlines->timers[ i ] ) );
+}
+
+
+#endif
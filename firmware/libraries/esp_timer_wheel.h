@@ -0,0 +1,104 @@
+/**
+ * \brief		Hashed Timer Wheel
+ * \file		esp_timer_wheel.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Timeouts for any number of connections driven by a single periodic SDK timer. Timers are intrusive list nodes
+ * kept in the caller's objects and hashed into the slot of their expiry tick, so arming and cancelling are constant
+ * time and never allocate. Each tick only walks the timers of one slot, timers more than one turn away stay in the
+ * slot until their turn comes.
+ *
+ * The connection deadlines bundle the four timeouts every connection needs: reading the request header, the idle
+ * keep-alive period, the WebSocket ping interval and a send which never completes. When one fires the callback
+ * gets the kind and normally closes the connection, so slow or half-open clients can't hold a PCB forever.
+ */
+#ifndef __ESP_TIMER_WHEEL_H__
+#define __ESP_TIMER_WHEEL_H__
+
+#include "osapi.h"
+#include "user_interface.h"
+
+/**
+ * Wheel geometry, slots must be a power of two
+ */
+#define ESP_TIMER_WHEEL_SLOTS 64
+#define ESP_TIMER_WHEEL_TICK 100
+
+/**
+ * Default connection deadlines, in milliseconds
+ */
+#define ESP_DEADLINE_HEADER_READ_TIMEOUT 5000
+#define ESP_DEADLINE_IDLE_TIMEOUT 15000
+#define ESP_DEADLINE_WS_PING_INTERVAL 30000
+#define ESP_DEADLINE_WRITE_STALL_TIMEOUT 10000
+
+typedef struct esp_wheel_timer esp_wheel_timer_type;
+
+typedef void ( *esp_wheel_timer_callback_type )( esp_wheel_timer_type* timer, void* arg );
+
+/**
+ * Timer, embedded in the object it times out
+ */
+struct esp_wheel_timer {
+    esp_wheel_timer_type* next;
+    esp_wheel_timer_type** link;
+    uint32_t expiry;
+
+    esp_wheel_timer_callback_type callback;
+    void* arg;
+};
+
+/**
+ * Wheel
+ */
+typedef struct esp_timer_wheel {
+    esp_wheel_timer_type* slots[ ESP_TIMER_WHEEL_SLOTS ];
+    uint32_t now;
+    os_timer_t tick_timer;
+} esp_timer_wheel_type;
+
+/**
+ * Connection deadline kinds
+ */
+typedef enum {
+    ESP_DEADLINE_HEADER_READ = 0,
+    ESP_DEADLINE_IDLE,
+    ESP_DEADLINE_WS_PING,
+    ESP_DEADLINE_WRITE_STALL,
+    ESP_DEADLINE_KINDS
+} esp_deadline_kind_type;
+
+typedef struct esp_connection_deadlines esp_connection_deadlines_type;
+
+typedef void ( *esp_deadline_callback_type )( esp_connection_deadlines_type* deadlines, esp_deadline_kind_type kind );
+
+/**
+ * Deadlines of one connection, the connection is kept in arg
+ */
+struct esp_connection_deadlines {
+    esp_timer_wheel_type* wheel;
+    esp_wheel_timer_type timers[ ESP_DEADLINE_KINDS ];
+    esp_deadline_callback_type callback;
+    void* arg;
+};
+
+void ICACHE_FLASH_ATTR esp_timer_wheel_initialize( esp_timer_wheel_type* wheel );
+void ICACHE_FLASH_ATTR esp_timer_wheel_start( esp_timer_wheel_type* wheel );
+void ICACHE_FLASH_ATTR esp_timer_wheel_stop( esp_timer_wheel_type* wheel );
+void ICACHE_FLASH_ATTR esp_timer_wheel_tick( esp_timer_wheel_type* wheel );
+
+void ICACHE_FLASH_ATTR esp_wheel_timer_initialize( esp_wheel_timer_type* timer, esp_wheel_timer_callback_type fn, void* arg );
+void ICACHE_FLASH_ATTR esp_wheel_timer_arm( esp_timer_wheel_type* wheel, esp_wheel_timer_type* timer, uint32_t milliseconds );
+void ICACHE_FLASH_ATTR esp_wheel_timer_cancel( esp_wheel_timer_type* timer );
+uint8_t ICACHE_FLASH_ATTR esp_wheel_timer_armed( esp_wheel_timer_type* timer );
+
+void ICACHE_FLASH_ATTR esp_deadlines_initialize( esp_connection_deadlines_type* deadlines, esp_timer_wheel_type* wheel, esp_deadline_callback_type fn, void* arg );
+void ICACHE_FLASH_ATTR esp_deadline_arm( esp_connection_deadlines_type* deadlines, esp_deadline_kind_type kind );
+void ICACHE_FLASH_ATTR esp_deadline_arm_timeout( esp_connection_deadlines_type* deadlines, esp_deadline_kind_type kind, uint32_t milliseconds );
+void ICACHE_FLASH_ATTR esp_deadline_cancel( esp_connection_deadlines_type* deadlines, esp_deadline_kind_type kind );
+void ICACHE_FLASH_ATTR esp_deadlines_cancel_all( esp_connection_deadlines_type* deadlines );
+
+#endif
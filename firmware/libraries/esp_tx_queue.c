@@ -0,0 +1,255 @@
+/**
+ * \brief		Connection Transmit Queue
+ * \file		esp_tx_queue.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_TX_QUEUE_C__
+#define __ESP_TX_QUEUE_C__
+
+#include "osapi.h"
+#include "user_interface.h"
+#include "espconn.h"
+
+#include "esp_tx_queue.h"
+
+/**
+ * Every message is prefixed by its length, stored byte by byte since DRAM doesn't allow unaligned access
+ */
+#define ESP_TX_MESSAGE_HEADER 2
+
+#define ESP_TX_NOT_SENDING -1
+
+
+/**
+ * Default send function, arg is the connection
+ */
+LOCAL int8_t ICACHE_FLASH_ATTR esp_tx_queue_espconn_send( void* arg, uint8_t* data, uint16_t length )
+{
+    return espconn_send( ( struct espconn* ) arg, data, length );
+}
+
+/**
+ * Retry timer callback
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_tx_queue_retry( void* arg )
+{
+    esp_tx_queue_pump( ( esp_tx_queue_type* ) arg );
+}
+
+/**
+ * Empty a ring
+ */
+LOCAL void ICACHE_FLASH_ATTR esp_tx_ring_clear( esp_tx_ring_type* ring )
+{
+    ring->head = ring->tail = ring->end = 0;
+    ring->reserved = ring->reserved_offset = 0;
+    ring->count = ring->depth = 0;
+}
+
+/**
+ * Initializes the queue, a NULL send function sends through espconn_send with arg as the connection
+ */
+void ICACHE_FLASH_ATTR esp_tx_queue_initialize( esp_tx_queue_type* queue, esp_tx_send_type send, void* arg )
+{
+    uint8_t i;
+
+    for( i = 0; i < ESP_TX_PRIORITIES ; i++ ) {
+        queue->rings[ i ].buffer = NULL;
+        queue->rings[ i ].size = 0;
+        queue->rings[ i ].max_depth = 0;
+        esp_tx_ring_clear( &( queue->rings[ i ] ) );
+    }
+    queue->send = ( send != NULL ) ? send : esp_tx_queue_espconn_send;
+    queue->arg = arg;
+    queue->in_flight = ESP_TX_NOT_SENDING;
+    queue->waiting_since = 0;
+    queue->stall_time = queue->stall_count = 0;
+    queue->sent_messages = queue->sent_bytes = 0;
+
+    os_timer_disarm( &( queue->retry_timer ) );
+    os_timer_setfn( &( queue->retry_timer ), ( os_timer_func_t* ) esp_tx_queue_retry, queue );
+}
+
+/**
+ * Assign the ring buffer of a priority class, a class without buffer rejects messages
+ */
+void ICACHE_FLASH_ATTR esp_tx_queue_buffer( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint8_t* buffer, uint16_t size )
+{
+    queue->rings[ priority ].buffer = buffer;
+    queue->rings[ priority ].size = size;
+    esp_tx_ring_clear( &( queue->rings[ priority ] ) );
+}
+
+/**
+ * Drop everything queued, call on disconnect
+ */
+void ICACHE_FLASH_ATTR esp_tx_queue_reset( esp_tx_queue_type* queue )
+{
+    uint8_t i;
+
+    os_timer_disarm( &( queue->retry_timer ) );
+    for( i = 0; i < ESP_TX_PRIORITIES ; i++ )
+        esp_tx_ring_clear( &( queue->rings[ i ] ) );
+    queue->in_flight = ESP_TX_NOT_SENDING;
+    queue->waiting_since = 0;
+}
+
+/**
+ * Reserve contiguous space for a message, returns where to write it or NULL if the class is full
+ */
+uint8_t* ICACHE_FLASH_ATTR esp_tx_queue_reserve( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint16_t length )
+{
+    esp_tx_ring_type* ring = &( queue->rings[ priority ] );
+    uint32_t need = ( uint32_t ) length + ESP_TX_MESSAGE_HEADER;
+    uint16_t offset;
+
+    if( ring->buffer == NULL || length == 0 ) return NULL;
+    if( ring->count == 0 ) esp_tx_ring_clear( ring );
+
+    if( ring->end == 0 ) {
+        // data lies in [ head, tail ), room after tail or before head
+        if( ring->size - ring->tail >= need ) offset = ring->tail;
+        else if( ring->head >= need ) offset = 0;
+        else return NULL;
+    } else {
+        // wrapped, data lies in [ head, end ) and [ 0, tail )
+        if( ring->head - ring->tail >= need ) offset = ring->tail;
+        else return NULL;
+    }
+    ring->reserved = length;
+    ring->reserved_offset = offset;
+    return ring->buffer + offset + ESP_TX_MESSAGE_HEADER;
+}
+
+/**
+ * Queue the reserved message with its final length and start sending if the connection is idle
+ */
+void ICACHE_FLASH_ATTR esp_tx_queue_commit( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint16_t length )
+{
+    esp_tx_ring_type* ring = &( queue->rings[ priority ] );
+    uint8_t* header = ring->buffer + ring->reserved_offset;
+
+    if( length > ring->reserved ) length = ring->reserved;
+    ring->reserved = 0;
+    if( length == 0 ) return;
+
+    header[ 0 ] = length & 0xFF;
+    header[ 1 ] = length >> 8;
+    // the message starts over at the front, mark where the data before it ends
+    if( ring->reserved_offset != ring->tail ) ring->end = ring->tail;
+    ring->tail = ring->reserved_offset + length + ESP_TX_MESSAGE_HEADER;
+    ring->count++;
+    ring->depth += length;
+    if( ring->depth > ring->max_depth ) ring->max_depth = ring->depth;
+
+    esp_tx_queue_pump( queue );
+}
+
+/**
+ * Copy a message into the queue, returns 0 if the class is full
+ */
+uint8_t ICACHE_FLASH_ATTR esp_tx_queue_push( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint8_t* data, uint16_t length )
+{
+    uint8_t* p = esp_tx_queue_reserve( queue, priority, length );
+
+    if( p == NULL ) return 0x00;
+    os_memcpy( p, data, length );
+    esp_tx_queue_commit( queue, priority, length );
+    return 0x01;
+}
+
+/**
+ * Hand the first message of the highest priority class to the stack, unless one is in flight
+ */
+void ICACHE_FLASH_ATTR esp_tx_queue_pump( esp_tx_queue_type* queue )
+{
+    esp_tx_ring_type* ring = NULL;
+    uint8_t* header;
+    uint16_t length;
+    int8_t i;
+
+    if( queue->in_flight != ESP_TX_NOT_SENDING ) {
+        // waiting on the sent callback
+        if( queue->waiting_since == 0 ) queue->waiting_since = system_get_time() | 1;
+        return;
+    }
+    for( i = 0; i < ESP_TX_PRIORITIES ; i++ ) {
+        if( queue->rings[ i ].count > 0 ) {
+            ring = &( queue->rings[ i ] );
+            break;
+        }
+    }
+    if( ring == NULL ) return;
+
+    header = ring->buffer + ring->head;
+    length = header[ 0 ] | ( header[ 1 ] << 8 );
+    if( queue->send( queue->arg, header + ESP_TX_MESSAGE_HEADER, length ) != 0 ) {
+        // stack out of memory, try again shortly
+        if( queue->waiting_since == 0 ) queue->waiting_since = system_get_time() | 1;
+        queue->stall_count++;
+        os_timer_disarm( &( queue->retry_timer ) );
+        os_timer_arm( &( queue->retry_timer ), ESP_TX_RETRY_DELAY, 0 );
+        return;
+    }
+    queue->in_flight = i;
+    if( queue->waiting_since != 0 ) {
+        queue->stall_time += system_get_time() - queue->waiting_since;
+        queue->waiting_since = 0;
+    }
+}
+
+/**
+ * The in flight message was sent, release it and send the next one
+ */
+void ICACHE_FLASH_ATTR esp_tx_queue_sent( esp_tx_queue_type* queue )
+{
+    esp_tx_ring_type* ring;
+    uint8_t* header;
+    uint16_t length;
+
+    if( queue->in_flight == ESP_TX_NOT_SENDING ) return;
+    ring = &( queue->rings[ queue->in_flight ] );
+    queue->in_flight = ESP_TX_NOT_SENDING;
+    if( ring->count == 0 ) return;
+
+    header = ring->buffer + ring->head;
+    length = header[ 0 ] | ( header[ 1 ] << 8 );
+    ring->head += length + ESP_TX_MESSAGE_HEADER;
+    ring->depth -= length;
+    ring->count--;
+    if( ring->end != 0 && ring->head == ring->end ) {
+        ring->head = 0;
+        ring->end = 0;
+    }
+    queue->sent_messages++;
+    queue->sent_bytes += length;
+
+    esp_tx_queue_pump( queue );
+}
+
+/**
+ * Bytes waiting in a priority class
+ */
+uint16_t ICACHE_FLASH_ATTR esp_tx_queue_depth( esp_tx_queue_type* queue, esp_tx_priority_type priority )
+{
+    return queue->rings[ priority ].depth;
+}
+
+/**
+ * Checks if nothing is queued or in flight
+ */
+uint8_t ICACHE_FLASH_ATTR esp_tx_queue_idle( esp_tx_queue_type* queue )
+{
+    uint8_t i;
+
+    if( queue->in_flight != ESP_TX_NOT_SENDING ) return 0x00;
+    for( i = 0; i < ESP_TX_PRIORITIES ; i++ )
+        if( queue->rings[ i ].count > 0 ) return 0x00;
+    return 0x01;
+}
+
+
+#endif
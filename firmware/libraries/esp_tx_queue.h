@@ -0,0 +1,97 @@
+/**
+ * \brief		Connection Transmit Queue
+ * \file		esp_tx_queue.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * The SDK accepts one send per connection until the sent callback fires. The queue keeps outgoing messages in one
+ * ring buffer per priority class and hands the next one to the stack from the sent callback, so HTTP responses and
+ * WebSocket frames can be queued at any time without checking whether a send is in flight.
+ *
+ * Messages are stored contiguously ( a bip buffer, a message which doesn't fit before the end of the ring starts
+ * over at the front ), so they can be encoded in place: reserve the worst case length, encode into the returned
+ * pointer and commit the actual length. A higher priority class always goes first, but a message is never split,
+ * so control frames overtake queued assets only between messages.
+ *
+ * Wire it up by calling esp_tx_queue_sent from the connection sent callback and esp_tx_queue_reset on disconnect.
+ */
+#ifndef __ESP_TX_QUEUE_H__
+#define __ESP_TX_QUEUE_H__
+
+#include "osapi.h"
+#include "user_interface.h"
+#include "espconn.h"
+
+/**
+ * Priority classes, lower goes first
+ */
+typedef enum {
+    ESP_TX_PRIORITY_CONTROL = 0,
+    ESP_TX_PRIORITY_DATA,
+    ESP_TX_PRIORITY_BULK,
+    ESP_TX_PRIORITIES
+} esp_tx_priority_type;
+
+/**
+ * Delay before a send rejected by the stack is retried, in milliseconds
+ */
+#define ESP_TX_RETRY_DELAY 10
+
+/**
+ * Send function, returns 0 once the stack accepted the data
+ */
+typedef int8_t ( *esp_tx_send_type )( void* arg, uint8_t* data, uint16_t length );
+
+/**
+ * Message ring of a priority class
+ */
+typedef struct esp_tx_ring {
+    uint8_t* buffer;
+    uint16_t size;
+
+    uint16_t head;
+    uint16_t tail;
+    uint16_t end;
+    uint16_t reserved;
+    uint16_t reserved_offset;
+
+    uint16_t count;
+    uint16_t depth;
+    uint16_t max_depth;
+} esp_tx_ring_type;
+
+/**
+ * Connection queue
+ */
+typedef struct esp_tx_queue {
+    esp_tx_ring_type rings[ ESP_TX_PRIORITIES ];
+    esp_tx_send_type send;
+    void* arg;
+
+    int8_t in_flight;
+    os_timer_t retry_timer;
+
+    uint32_t waiting_since;
+    uint32_t stall_time;
+    uint32_t stall_count;
+    uint32_t sent_messages;
+    uint32_t sent_bytes;
+} esp_tx_queue_type;
+
+void ICACHE_FLASH_ATTR esp_tx_queue_initialize( esp_tx_queue_type* queue, esp_tx_send_type send, void* arg );
+void ICACHE_FLASH_ATTR esp_tx_queue_buffer( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint8_t* buffer, uint16_t size );
+void ICACHE_FLASH_ATTR esp_tx_queue_reset( esp_tx_queue_type* queue );
+
+uint8_t* ICACHE_FLASH_ATTR esp_tx_queue_reserve( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint16_t length );
+void ICACHE_FLASH_ATTR esp_tx_queue_commit( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint16_t length );
+uint8_t ICACHE_FLASH_ATTR esp_tx_queue_push( esp_tx_queue_type* queue, esp_tx_priority_type priority, uint8_t* data, uint16_t length );
+
+void ICACHE_FLASH_ATTR esp_tx_queue_pump( esp_tx_queue_type* queue );
+void ICACHE_FLASH_ATTR esp_tx_queue_sent( esp_tx_queue_type* queue );
+
+uint16_t ICACHE_FLASH_ATTR esp_tx_queue_depth( esp_tx_queue_type* queue, esp_tx_priority_type priority );
+uint8_t ICACHE_FLASH_ATTR esp_tx_queue_idle( esp_tx_queue_type* queue );
+
+#endif
@@ -14,37 +14,94 @@
 #include "mem.h"
 
 #include "esp_url.h"
+#include "esp_arena.h"
 
 
 /**
- * Returns the encoded length of the parameter string
+ * Character classes, four per word so the table can stay in flash where only aligned words can be read.
+ * The low bits flag unreserved characters and hex digits, the high nibble holds the hex digit value.
  */
-uint16_t ICACHE_FLASH_ATTR url_parameter_get_encoded_size( uint8_t* parameter_value )
-{
-    uint16_t length = strlen( ( char* ) parameter_value );
-    char c;
+#define URL_CHAR_UNRESERVED 0x01
+#define URL_CHAR_HEX 0x02
+
+LOCAL const uint32_t url_char_classes[ 64 ] ICACHE_RODATA_ATTR = {
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+    0x00000000, 0x00000000, 0x00000000, 0x00010100, 0x33231303, 0x73635343, 0x00009383, 0x00000000,
+    0xC3B3A300, 0x01F3E3D3, 0x01010101, 0x01010101, 0x01010101, 0x01010101, 0x00010101, 0x01000000,
+    0xC3B3A300, 0x01F3E3D3, 0x01010101, 0x01010101, 0x01010101, 0x01010101, 0x00010101, 0x00010000,
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000
+};
+
+#define URL_CHAR_CLASS( c ) ( ( url_char_classes[ ( uint8_t ) ( c ) >> 2 ] >> ( ( ( c ) & 0x03 ) << 3 ) ) & 0xFF )
+
+/**
+ * Checks if all four bytes of a word are unreserved
+ */
+#define URL_WORD_UNRESERVED( w ) ( URL_CHAR_CLASS( ( w ) & 0xFF ) & URL_CHAR_CLASS( ( ( w ) >> 8 ) & 0xFF ) \
+    & URL_CHAR_CLASS( ( ( w ) >> 16 ) & 0xFF ) & URL_CHAR_CLASS( ( w ) >> 24 ) & URL_CHAR_UNRESERVED )
+
+/**
+ * Checks if any byte of a word equals b
+ */
+#define URL_WORD_HAS_BYTE( w, b ) ( ( ( ( w ) ^ ( 0x01010101UL * ( b ) ) ) - 0x01010101UL ) & ~( ( w ) ^ ( 0x01010101UL * ( b ) ) ) & 0x80808080UL )
 
-    for( ; *( parameter_value ) != 0x00 ; parameter_value++ ) {
-        c = *( parameter_value );
-        if( ( ! isalnum( c ) ) && ( c != '_' ) && ( c != '-' ) && ( c != '.' ) && ( c != '~' ) && ( c != ' ' ) )
-            length++;
+/**
+ * Returns the encoded length of the given number of characters
+ */
+uint16_t ICACHE_FLASH_ATTR url_parameter_get_encoded_size_length( uint8_t* parameter_value, uint16_t length )
+{
+    uint8_t* end = parameter_value + length;
+    uint16_t size = length;
+    uint8_t c;
+
+    while( parameter_value < end ) {
+        // skip runs of unreserved characters a word at a time
+        if( ( ( uintptr_t ) parameter_value & 0x03 ) == 0 && end - parameter_value >= 4
+            && URL_WORD_UNRESERVED( *( uint32_t* ) parameter_value ) ) {
+            parameter_value += 4;
+            continue;
+        }
+        c = *( parameter_value++ );
+        if( ! ( URL_CHAR_CLASS( c ) & URL_CHAR_UNRESERVED ) && c != ' ' ) size += 2;
     }
-    return length;
+    return size;
 }
 
 /**
- * Encodes string values according to URI standards
+ * Returns the encoded length of the parameter string
  */
-void ICACHE_FLASH_ATTR url_parameter_encode( uint8_t* encoded_parameter, uint8_t* parameter_value )
+uint16_t ICACHE_FLASH_ATTR url_parameter_get_encoded_size( uint8_t* parameter_value )
 {
-    char hex[ 17 ] = "0123456789ABCDEF", c;
-    uint8_t* current_ch = parameter_value;
-
-    for( ; *( current_ch ) != 0x00; current_ch++ ) {
-        c = ( char ) *( current_ch );
+    return url_parameter_get_encoded_size_length( parameter_value, strlen( ( char* ) parameter_value ) );
+}
 
-        if( isalnum( c ) || c == '_' || c == '-' || c == '.' || c == '~' ) {
-            *( encoded_parameter++ ) = ( uint8_t ) c;
+/**
+ * Encodes the given number of characters according to URI standards, returns the encoded length
+ */
+uint16_t ICACHE_FLASH_ATTR url_parameter_encode_length( uint8_t* encoded_parameter, uint8_t* parameter_value, uint16_t length )
+{
+    char hex[ 17 ] = "0123456789ABCDEF";
+    uint8_t* start = encoded_parameter, *end = parameter_value + length;
+    uint32_t w;
+    uint8_t c;
+
+    while( parameter_value < end ) {
+        // copy runs of unreserved characters a word at a time, stores stay bytewise since the output may be unaligned
+        if( ( ( uintptr_t ) parameter_value & 0x03 ) == 0 && end - parameter_value >= 4 ) {
+            w = *( uint32_t* ) parameter_value;
+            if( URL_WORD_UNRESERVED( w ) ) {
+                os_memcpy( encoded_parameter, parameter_value, 4 );
+                encoded_parameter += 4;
+                parameter_value += 4;
+                continue;
+            }
+        }
+        c = *( parameter_value++ );
+        if( URL_CHAR_CLASS( c ) & URL_CHAR_UNRESERVED ) {
+            *( encoded_parameter++ ) = c;
         } else if( c == ' ' ) {
             *( encoded_parameter++ ) = '+';
         } else {
@@ -54,138 +111,226 @@ void ICACHE_FLASH_ATTR url_parameter_encode( uint8_t* encoded_parameter, uint8_t
         }
     }
     *( encoded_parameter ) = '\0';
+    return ( uint16_t ) ( encoded_parameter - start );
 }
 
 /**
- * Decodes URI string
+ * Encodes string values according to URI standards, returns the encoded length
  */
-void ICACHE_FLASH_ATTR url_parameter_decode( uint8_t* parameter, uint8_t* encoded_parameter )
+uint16_t ICACHE_FLASH_ATTR url_parameter_encode( uint8_t* encoded_parameter, uint8_t* parameter_value )
 {
-    uint8_t c, d;
+    return url_parameter_encode_length( encoded_parameter, parameter_value, strlen( ( char* ) parameter_value ) );
+}
 
-    for( ; *( encoded_parameter ) != 0x00 ; encoded_parameter ++ ) {
-        if( *( encoded_parameter ) != '%' ) {
-            if( *( encoded_parameter ) == '+' ) {
-                *( parameter++ ) = ' ';
-            } else {
-                *( parameter++ ) = *( encoded_parameter );
+/**
+ * Decodes the given number of characters of an URI string, returns the decoded length.
+ * The output is never longer so the parameter may point to the encoded string to decode in place,
+ * a percent sign which isn't followed by two hex digits is kept as it is.
+ */
+uint16_t ICACHE_FLASH_ATTR url_parameter_decode_length( uint8_t* parameter, uint8_t* encoded_parameter, uint16_t length )
+{
+    uint8_t* start = parameter, *end = encoded_parameter + length;
+    uint8_t c, high, low;
+    uint32_t w;
+
+    while( encoded_parameter < end ) {
+        // copy words without escapes, forward copy is safe in place
+        if( ( ( uintptr_t ) encoded_parameter & 0x03 ) == 0 && end - encoded_parameter >= 4 ) {
+            w = *( uint32_t* ) encoded_parameter;
+            if( ! URL_WORD_HAS_BYTE( w, '%' ) && ! URL_WORD_HAS_BYTE( w, '+' ) ) {
+                if( parameter != encoded_parameter ) os_memmove( parameter, encoded_parameter, 4 );
+                parameter += 4;
+                encoded_parameter += 4;
+                continue;
+            }
+        }
+        c = *( encoded_parameter++ );
+        if( c == '+' ) {
+            c = ' ';
+        } else if( c == '%' && end - encoded_parameter >= 2 ) {
+            high = URL_CHAR_CLASS( encoded_parameter[ 0 ] );
+            low = URL_CHAR_CLASS( encoded_parameter[ 1 ] );
+            if( high & low & URL_CHAR_HEX ) {
+                c = ( high & 0xF0 ) | ( low >> 4 );
+                encoded_parameter += 2;
             }
-        } else {
-            c = *( ++ encoded_parameter );
-            if( c >= '0' && c <= '9' ) d = ( c - '0' ) << 4;
-            else d = ( 10 + toupper( c ) - 'A' ) << 4;
-            c = *( ++ encoded_parameter );
-            if( c >= '0' && c <= '9' ) d |= ( c - '0' ) & 0x0F;
-            else d |= ( 10 + toupper( c ) - 'A' ) & 0x0F;
-            *( parameter++ ) = d;
         }
+        *( parameter++ ) = c;
     }
     *( parameter ) = '\0';
+    return ( uint16_t ) ( parameter - start );
 }
 
 /**
- * Deinitialize URL parameter and frees the memory
+ * Decodes URI string, returns the decoded length
  */
-void ICACHE_FLASH_ATTR url_query_parameter_destroy( url_query_parameter_type* parameter )
+uint16_t ICACHE_FLASH_ATTR url_parameter_decode( uint8_t* parameter, uint8_t* encoded_parameter )
 {
-    if( parameter->name != NULL )
-        os_free( parameter->name );
-    if( parameter->value != NULL )
-        os_free( parameter->value );
-    os_free( parameter );
+    return url_parameter_decode_length( parameter, encoded_parameter, strlen( ( char* ) encoded_parameter ) );
 }
 
-
 /**
- * Initialize a query parameter
+ * Case insensitive hash of a parameter name
  */
-void ICACHE_FLASH_ATTR url_query_parameter_initialize( url_query_parameter_type* parameter, uint8_t* parameter_name, uint8_t* parameter_value, uint8_t encoded_value )
+LOCAL uint8_t ICACHE_FLASH_ATTR url_query_hash( uint8_t* name, uint16_t length )
 {
-    char* value;
-
-    if( parameter->name != NULL ) {
-        os_free( parameter->name );
-        parameter->name = NULL;
-    }
-    if( parameter->value != NULL ) {
-        os_free( parameter->value );
-        parameter->value = NULL;
-    }
+    uint32_t hash = 2166136261UL;
 
-    parameter->name = ( uint8_t* ) os_malloc( strlen( ( char* ) parameter_name ) + 1 );
-    strcpy( ( char* ) parameter->name, ( char* ) parameter_name );
-
-    value = ( char* ) os_malloc( strlen( ( char* ) parameter_value ) + 1 );
+    while( length-- > 0 )
+        hash = ( hash ^ ( uint8_t ) tolower( *( name++ ) ) ) * 16777619UL;
+    return ( uint8_t ) ( hash ^ ( hash >> 16 ) ) & ( URL_QUERY_HASH_SIZE - 1 );
+}
 
-    if( encoded_value ) {
-        url_parameter_decode( ( uint8_t* ) value, parameter_value );
-        parameter->value = ( uint8_t* ) os_malloc( strlen( value ) + 1 );
-        strcpy( ( char* ) parameter->value, value );
-        os_free( value );
-    } else {
-        strcpy( ( char* ) value, ( char* ) parameter_value );
-        parameter->value = ( uint8_t* ) value;
+/**
+ * Rebuild the hash index after entries moved
+ */
+LOCAL void ICACHE_FLASH_ATTR url_query_reindex( url_query_table_type* table )
+{
+    url_query_parameter_type* p;
+    uint8_t i, h;
+
+    os_memset( table->index, URL_QUERY_NONE, URL_QUERY_HASH_SIZE );
+    for( i = 0; i < table->count ; i++ ) {
+        p = &( table->entries[ i ] );
+        h = url_query_hash( p->name, strlen( ( char* ) p->name ) );
+        p->hash_next = table->index[ h ];
+        table->index[ h ] = i;
     }
 }
 
 /**
- * Get query length
+ * Make room for more entries and string bytes, moves the table into a bigger block when needed
  */
-uint32_t ICACHE_FLASH_ATTR url_query_compute_length( url_query_parameter_type* list )
+uint8_t ICACHE_FLASH_ATTR url_query_reserve( url_object_type* url, uint16_t entries, uint32_t bytes )
 {
-    uint32_t length = 0, i = 0;
-
-    while( list != NULL ) {
-        i++;
-        length += strlen( ( char* ) list->name ) + url_parameter_get_encoded_size( list->value ) + 1;
-        list = list->chain;
+    url_query_table_type* table = &( url->query );
+    url_query_parameter_type* moved;
+    uint16_t capacity, used = 0, i, n;
+    uint32_t size, entries_size;
+    uint8_t* block, *strings;
+
+    if( table->count + entries <= table->capacity && table->strings_used + bytes <= table->strings_size ) return 0x01;
+    if( table->count + entries >= URL_QUERY_NONE ) return 0x00;
+
+    // live string bytes, replaced values leave holes behind
+    for( i = 0; i < table->count ; i++ )
+        used += strlen( ( char* ) table->entries[ i ].name ) + strlen( ( char* ) table->entries[ i ].value ) + 2;
+
+    capacity = table->count + entries;
+    if( table->capacity != 0 && capacity < table->capacity * 2 ) capacity = table->capacity * 2;
+    if( capacity >= URL_QUERY_NONE ) capacity = URL_QUERY_NONE - 1;
+    size = used + bytes;
+    if( table->strings_size != 0 && size < ( uint32_t ) table->strings_size * 2 ) size = ( uint32_t ) table->strings_size * 2;
+    // the block length is 16 bit, growth stops at the limit and fails when the live strings don't fit
+    entries_size = ( uint32_t ) capacity * sizeof( url_query_parameter_type );
+    if( entries_size + size > 0xFFFF ) size = 0xFFFF - entries_size;
+    if( size < used + bytes ) return 0x00;
+
+    block = ( uint8_t* ) esp_arena_malloc( url->arena, ( uint16_t ) ( entries_size + size ) );
+    if( block == NULL ) return 0x00;
+    moved = ( url_query_parameter_type* ) block;
+    strings = block + entries_size;
+
+    for( used = 0, i = 0; i < table->count ; i++ ) {
+        moved[ i ].hash_next = table->entries[ i ].hash_next;
+        n = strlen( ( char* ) table->entries[ i ].name ) + 1;
+        moved[ i ].name = strings + used;
+        os_memcpy( moved[ i ].name, table->entries[ i ].name, n );
+        used += n;
+        n = strlen( ( char* ) table->entries[ i ].value ) + 1;
+        moved[ i ].value = strings + used;
+        os_memcpy( moved[ i ].value, table->entries[ i ].value, n );
+        used += n;
     }
-    if( i != 0 ) i--;
-    return length + i;
+
+    esp_arena_free( url->arena, table->block );
+    table->block = block;
+    table->entries = moved;
+    table->capacity = capacity;
+    table->strings = strings;
+    table->strings_size = ( uint16_t ) size;
+    table->strings_used = used;
+    return 0x01;
 }
 
 /**
- * Build a query parameter
+ * Store a string in the table, decoding it if needed
  */
-url_query_parameter_type* ICACHE_FLASH_ATTR url_query_parameter_create( uint8_t* parameter_name, uint8_t* parameter_value, uint8_t encoded_value )
+LOCAL uint8_t* ICACHE_FLASH_ATTR url_query_store( url_query_table_type* table, uint8_t* data, uint16_t length, uint8_t encoded )
 {
-    url_query_parameter_type* p = ( url_query_parameter_type* ) os_malloc( sizeof( url_query_parameter_type ) );
-
-    p->chain = NULL;
-    p->name = NULL;
-    p->value = NULL;
-    url_query_parameter_initialize( p, parameter_name, parameter_value, encoded_value );
+    uint8_t* p = table->strings + table->strings_used;
 
+    if( encoded ) length = url_parameter_decode_length( p, data, length );
+    else {
+        os_memcpy( p, data, length );
+        p[ length ] = '\0';
+    }
+    table->strings_used += length + 1;
     return p;
 }
 
+/**
+ * Get query length
+ */
+uint32_t ICACHE_FLASH_ATTR url_query_compute_length( url_query_table_type* query )
+{
+    uint32_t length = 0;
+    uint8_t i;
+
+    for( i = 0; i < query->count ; i++ )
+        length += strlen( ( char* ) query->entries[ i ].name ) + url_parameter_get_encoded_size( query->entries[ i ].value ) + 1;
+    if( query->count != 0 ) length += query->count - 1;
+    return length;
+}
 
 /**
- * Finds URL query parameter by name, returns the linking parameter in the chain
+ * Finds URL query parameter by name, returns its position or URL_QUERY_NONE
  */
-url_query_parameter_type* ICACHE_FLASH_ATTR url_find_query_parameter( url_query_parameter_type* list, int8_t* parameter_index, uint8_t* parameter_name )
+uint8_t ICACHE_FLASH_ATTR url_find_query_parameter_length( url_query_table_type* query, uint8_t* parameter_name, uint16_t name_length )
 {
-    url_query_parameter_type* link = list;
-    url_query_parameter_type* s;
+    uint8_t i;
 
-    *( parameter_index ) = -1;
-    if( link == NULL ) return NULL;
-    if( stricmp( ( char* ) parameter_name, ( char* ) link->name ) == 0 ) {
-        ( *parameter_index ) ++;
-        return list;
+    if( query->count == 0 ) return URL_QUERY_NONE;
+    for( i = query->index[ url_query_hash( parameter_name, name_length ) ]; i != URL_QUERY_NONE ; i = query->entries[ i ].hash_next ) {
+        if( strnicmp( ( char* ) parameter_name, ( char* ) query->entries[ i ].name, name_length ) == 0 && query->entries[ i ].name[ name_length ] == '\0' )
+            return i;
     }
+    return URL_QUERY_NONE;
+}
 
-    while( link->chain != NULL ) {
-        ( *parameter_index ) ++;
-        s = ( link->chain );
-        if( stricmp( ( char* ) parameter_name, ( char* ) ( s->name ) ) == 0 ) {
-            return link;
+/**
+ * Insert or update query parameter from name and value spans
+ */
+void ICACHE_FLASH_ATTR url_add_query_parameter_length( url_object_type* url, uint8_t* parameter_name, uint16_t name_length, uint8_t* parameter_value, uint16_t value_length, uint8_t encoded_value )
+{
+    url_query_table_type* table = &( url->query );
+    url_query_parameter_type* p;
+    uint8_t i = url_find_query_parameter_length( table, parameter_name, name_length ), h;
+
+    if( i != URL_QUERY_NONE ) {
+        p = &( table->entries[ i ] );
+        // the decoded value is never longer, reuse the old slot when it fits
+        if( value_length <= strlen( ( char* ) p->value ) ) {
+            if( encoded_value ) url_parameter_decode_length( p->value, parameter_value, value_length );
+            else {
+                os_memmove( p->value, parameter_value, value_length );
+                p->value[ value_length ] = '\0';
+            }
+        } else if( url_query_reserve( url, 0, value_length + 1 ) ) {
+            table->entries[ i ].value = url_query_store( table, parameter_value, value_length, encoded_value );
         }
-        link = link->chain;
+        return;
     }
 
-    ( *parameter_index ) = -1;
-    return NULL;
+    if( ! url_query_reserve( url, 1, name_length + value_length + 2 ) ) return;
+    i = table->count++;
+    p = &( table->entries[ i ] );
+    p->name = url_query_store( table, parameter_name, name_length, 0 );
+    p->value = url_query_store( table, parameter_value, value_length, encoded_value );
+
+    h = url_query_hash( parameter_name, name_length );
+    p->hash_next = table->index[ h ];
+    table->index[ h ] = i;
 }
 
 /**
@@ -193,39 +338,40 @@ url_query_parameter_type* ICACHE_FLASH_ATTR url_find_query_parameter( url_query_
  */
 void ICACHE_FLASH_ATTR url_add_query_parameter( url_object_type* url, uint8_t* parameter_name, uint8_t* parameter_value, uint8_t encoded_value )
 {
-    url_query_parameter_type* list = url->query;
-    url_query_parameter_type* search;
-    url_query_parameter_type* insert = NULL;
-    int8_t parameter_index;
-
-    search = url_find_query_parameter( list, &parameter_index, parameter_name );
-    if( parameter_index == -1 ) {
-        insert = url_query_parameter_create( parameter_name, parameter_value, encoded_value );
-        search = list;
-        if( search == NULL ) {
-            url->query = insert;
-        } else {
-            while( search->chain != NULL )
-                search = search->chain;
-            search->chain = insert;
-        }
-    } else {
-        insert = search->chain;
-        url_query_parameter_initialize( insert, parameter_name, parameter_value, encoded_value );
-    }
+    url_query_parse_pending( url );
+    url_add_query_parameter_length( url, parameter_name, strlen( ( char* ) parameter_name ), parameter_value, strlen( ( char* ) parameter_value ), encoded_value );
 }
 
 /**
- * Get the query parameter
+ * Get the query parameter, the pointer is valid until the next parameter is added
  */
 url_query_parameter_type* ICACHE_FLASH_ATTR url_get_query_parameter( url_object_type* url, uint8_t* parameter_name )
 {
-    url_query_parameter_type* search;
-    int8_t parameter_index;
-    search = url_find_query_parameter( url->query, &parameter_index, parameter_name );
-    if( parameter_index > 0 )
-        search = search->chain;
-    return search;
+    uint8_t i;
+
+    url_query_parse_pending( url );
+    i = url_find_query_parameter_length( &( url->query ), parameter_name, strlen( ( char* ) parameter_name ) );
+    if( i == URL_QUERY_NONE ) return NULL;
+    return &( url->query.entries[ i ] );
+}
+
+/**
+ * Number of query parameters
+ */
+uint8_t ICACHE_FLASH_ATTR url_query_count( url_object_type* url )
+{
+    url_query_parse_pending( url );
+    return url->query.count;
+}
+
+/**
+ * Query parameter by position, in the order they were added
+ */
+url_query_parameter_type* ICACHE_FLASH_ATTR url_query_parameter_at( url_object_type* url, uint8_t index )
+{
+    url_query_parse_pending( url );
+    if( index >= url->query.count ) return NULL;
+    return &( url->query.entries[ index ] );
 }
 
 /**
@@ -233,56 +379,80 @@ url_query_parameter_type* ICACHE_FLASH_ATTR url_get_query_parameter( url_object_
  */
 void ICACHE_FLASH_ATTR url_remove_query_parameter( url_object_type* url, uint8_t* parameter_name )
 {
-    url_query_parameter_type* list = url->query;
-    url_query_parameter_type* search;
-    int8_t parameter_index;
-
-    search = url_find_query_parameter( list, &parameter_index, parameter_name );
-    if( parameter_index == 0 ) {
-        url->query = list->chain;
-        url_query_parameter_destroy( list );
-    } else if( parameter_index > 0 ) {
-        list = search->chain;
-        search->chain = list->chain;
-        url_query_parameter_destroy( list );
-    }
+    url_query_table_type* table = &( url->query );
+    uint8_t i;
+
+    url_query_parse_pending( url );
+    i = url_find_query_parameter_length( table, parameter_name, strlen( ( char* ) parameter_name ) );
+    if( i == URL_QUERY_NONE ) return;
+    // keep the order, the strings stay until the table grows
+    os_memmove( &( table->entries[ i ] ), &( table->entries[ i + 1 ] ), ( table->count - i - 1 ) * sizeof( url_query_parameter_type ) );
+    table->count--;
+    url_query_reindex( table );
 }
 
 /**
- * Clean URL query
+ * Initializes an empty query
  */
-void ICACHE_FLASH_ATTR url_remove_query( url_object_type* url )
+void ICACHE_FLASH_ATTR url_query_initialize( url_query_table_type* query )
+{
+    query->block = NULL;
+    query->entries = NULL;
+    query->strings = NULL;
+    query->strings_size = query->strings_used = 0;
+    query->count = query->capacity = 0;
+    query->raw_count = query->raw_parsed = 0;
+    os_memset( query->index, URL_QUERY_NONE, URL_QUERY_HASH_SIZE );
+}
+
+/**
+ * Keep a raw query string to parse on the first parameter access, it must stay valid until then
+ */
+void ICACHE_FLASH_ATTR url_query_defer( url_object_type* url, uint8_t* query, uint16_t length )
 {
-    url_query_parameter_type* list = url->query, *next;
+    url_query_table_type* table = &( url->query );
 
-    while( list != NULL ) {
-        next = list->chain;
-        url_query_parameter_destroy( list );
-        list = next;
+    if( length == 0 ) return;
+    if( table->raw_count == URL_QUERY_RAW_SPANS ) {
+        url_parse_query( url, query, length );
+        return;
     }
-    url->query = NULL;
+    table->raw[ table->raw_count ] = query;
+    table->raw_length[ table->raw_count ] = length;
+    table->raw_count++;
 }
 
-
 /**
- * Write the current query into a string
+ * Parse the deferred raw query strings
  */
-uint8_t* ICACHE_FLASH_ATTR url_get_query( uint8_t* destination, url_object_type* url )
+void ICACHE_FLASH_ATTR url_query_parse_pending( url_object_type* url )
 {
-    url_query_parameter_type* list = url->query;
-
-    while( list != NULL ) {
-        strcpy( ( char* ) destination, ( char* ) list->name );
-        destination = destination + strlen( ( char* ) destination );
-        *( destination++ ) = '=';
-        url_parameter_encode( destination, list->value );
-        destination = destination + strlen( ( char* ) destination );
+    url_query_table_type* table = &( url->query );
+    uint8_t i;
 
-        list = list->chain;
-        if( list != NULL )
-            *( destination++ ) = '&';
+    while( table->raw_parsed < table->raw_count ) {
+        i = table->raw_parsed++;
+        url_parse_query( url, table->raw[ i ], table->raw_length[ i ] );
     }
-    return destination + strlen( ( char* ) destination );
+}
+
+/**
+ * Deferred raw query string, still encoded and not terminated
+ */
+uint8_t* ICACHE_FLASH_ATTR url_query_raw( url_object_type* url, uint8_t index, uint16_t* length )
+{
+    if( index >= url->query.raw_count ) return NULL;
+    ( *length ) = url->query.raw_length[ index ];
+    return url->query.raw[ index ];
+}
+
+/**
+ * Clean URL query
+ */
+void ICACHE_FLASH_ATTR url_remove_query( url_object_type* url )
+{
+    esp_arena_free( url->arena, url->query.block );
+    url_query_initialize( &( url->query ) );
 }
 
 
@@ -296,18 +466,17 @@ void ICACHE_FLASH_ATTR url_ip_to_hostname( uint8_t* hostname, uint32_t ip )
 }
 
 /**
- * Check if the given string is an IP
+ * Check if the given number of characters are an IP
  */
-uint32_t ICACHE_FLASH_ATTR url_hostname_is_ip( uint8_t* hostname )
+uint32_t ICACHE_FLASH_ATTR url_hostname_is_ip_length( uint8_t* hostname, uint16_t n )
 {
     uint8_t ac = 0, ip[ 4 ];
-    uint8_t i, n;
+    uint16_t i;
     uint16_t bval = 0;
     uint32_t address = 0x00000000;
     char c;
 
-    if( hostname == NULL ) return address;
-    n = strlen( ( char* ) hostname );
+    if( hostname == NULL || n == 0 ) return address;
 
     for( i = 0; i < n ; i++ ) {
         c = ( char ) ( *( hostname + i ) );
@@ -334,55 +503,40 @@ uint32_t ICACHE_FLASH_ATTR url_hostname_is_ip( uint8_t* hostname )
 }
 
 /**
- * Parses URL query into usable objects
+ * Check if the given string is an IP
  */
-void ICACHE_FLASH_ATTR url_parse_query( url_object_type* url, uint8_t* query, int16_t length )
+uint32_t ICACHE_FLASH_ATTR url_hostname_is_ip( uint8_t* hostname )
 {
-    url_query_parameter_type* list = url->query;
-    uint8_t value[ 512 ], *parse = query, *eq = NULL, *name = query, *fragment, *end = query + ( length - 1 );
-    uint16_t copy_length;
-    char c;
-    
-    if( length > 0 ) {
-        
-        while( parse != end ) {
-            if( ( *parse ) == '#' ) {
-                fragment = parse;
-                ( *fragment ) = '\0';
-            }
-            parse++;
-        }
-        parse = query;    
-
-        for( ; parse <= end ; parse++ ) {
-            c = ( char ) ( *parse );
-            if( parse == end ) {
-                copy_length = ( int16_t ) ( end - eq );
-                strncpy( value, eq + 1, copy_length );
-                value[ copy_length ] = '\0';
-                if( strlen( ( char* )( value ) ) != 0 && strlen( ( char* )( name ) ) != 0 )
-                    url_add_query_parameter( url, ( uint8_t* ) name, ( uint8_t* ) eq + 1, 1 );
-                ( *eq ) = '=';
-            } else if( c == '&' ) {
-                ( *parse ) = '\0';
-                if( strlen( ( char* )( eq + 1 ) ) != 0 && strlen( ( char* )( name ) ) != 0 )
-                    url_add_query_parameter( url, ( uint8_t* ) name, ( uint8_t* ) eq + 1, 1 );
-                ( *parse ) = '&';
-                ( *eq ) = '=';
-                name = parse + 1;
-                while( ( *name ) == '=' || ( *name ) == '&' ) {
-                    name++;
-                    parse++;
-                }
-            } else if( c == '=' ) {
-                eq = parse;
-                ( *parse ) = '\0';
-            }
-        }
+    if( hostname == NULL ) return 0x00000000;
+    return url_hostname_is_ip_length( hostname, strlen( ( char* ) hostname ) );
+}
 
-        if( fragment != NULL )
-            ( *fragment ) = '#';
-    }
+/**
+ * Parses URL query into usable objects, the query string is left untouched
+ */
+void ICACHE_FLASH_ATTR url_parse_query( url_object_type* url, uint8_t* query, int16_t length )
+{
+    url_view_type view;
+    url_span_type name, value;
+    uint16_t cursor = 0, n;
+
+    if( length <= 0 ) return;
+    // the query ends at the fragment
+    for( n = 0; n < length && query[ n ] != '#' ; n++ );
+
+    view.source = query;
+    view.length = n;
+    view.query.offset = 0;
+    view.query.length = n;
+
+    // size the table once for every pair
+    for( n = 0; url_view_query_next( &view, &cursor, &name, &value ) ; n++ );
+    if( n == 0 ) return;
+    url_query_reserve( url, n, view.query.length + n );
+    cursor = 0;
+    while( url_view_query_next( &view, &cursor, &name, &value ) )
+        if( name.length != 0 && value.length != 0 )
+            url_add_query_parameter_length( url, query + name.offset, name.length, query + value.offset, value.length, 1 );
 }
 
 /**
@@ -390,28 +544,59 @@ void ICACHE_FLASH_ATTR url_parse_query( url_object_type* url, uint8_t* query, in
  */
 void ICACHE_FLASH_ATTR url_initialize( url_object_type* url, url_protocol_type protocol, uint8_t* hostname, uint16_t port, uint8_t* path, uint8_t* query )
 {
+    url_initialize_arena( url, NULL, protocol, hostname, port, path, query );
+}
+
+/**
+ * Initializes an URL object which allocates from the given arena, released all at once with the arena
+ */
+void ICACHE_FLASH_ATTR url_initialize_arena( url_object_type* url, esp_arena_type* arena, url_protocol_type protocol, uint8_t* hostname, uint16_t port, uint8_t* path, uint8_t* query )
+{
+    url->arena = arena;
     url->protocol = protocol;
     url->port = port;
-    url->query = NULL;
+    url_query_initialize( &( url->query ) );
+    url->hostname = NULL;
 
     url->host_ip = url_hostname_is_ip( hostname );
     if( url->host_ip == 0x00000000 ) {
-        if( hostname == NULL ) url->hostname = NULL;
-        else {
-            url->hostname = ( uint8_t* ) os_malloc( strlen( ( char* ) hostname ) + 1 );
+        if( hostname != NULL ) {
+            url->hostname = ( uint8_t* ) esp_arena_malloc( arena, strlen( ( char* ) hostname ) + 1 );
             strcpy( ( char* ) url->hostname, ( char* ) hostname );
         }
     }
 
     if( path == NULL ) url->path = NULL;
     else {
-        url->path = ( uint8_t* ) os_malloc( strlen( ( char* ) path ) + 1 );
+        url->path = ( uint8_t* ) esp_arena_malloc( arena, strlen( ( char* ) path ) + 1 );
         strcpy( ( char* ) url->path, ( char* ) path );
     }
-    if( strlen( query ) > 0 ) 
-        url_parse_query( url, query, strlen( query ) );
-    else 
-        url->query = NULL;
+    if( query != NULL && strlen( ( char* ) query ) > 0 ) 
+        url_parse_query( url, query, strlen( ( char* ) query ) );
+}
+
+/**
+ * Initializes an URL object as an owning copy of the parsed view
+ */
+void ICACHE_FLASH_ATTR url_initialize_view( url_object_type* url, esp_arena_type* arena, url_view_type* view )
+{
+    url->arena = arena;
+    url->protocol = view->protocol;
+    url->port = view->port;
+    url_query_initialize( &( url->query ) );
+    url->hostname = NULL;
+
+    url->host_ip = view->host_ip;
+    if( url->host_ip == 0x00000000 && view->host.length > 0 ) {
+        url->hostname = ( uint8_t* ) esp_arena_malloc( arena, view->host.length + 1 );
+        url_view_copy( view, &( view->host ), url->hostname, view->host.length + 1 );
+    }
+
+    url->path = ( uint8_t* ) esp_arena_malloc( arena, view->path.length + 1 );
+    url_view_copy( view, &( view->path ), url->path, view->path.length + 1 );
+
+    if( view->query.length > 0 )
+        url_parse_query( url, url_view_pointer( view, &( view->query ) ), view->query.length );
 }
 
 /**
@@ -421,8 +606,8 @@ void ICACHE_FLASH_ATTR url_deinitialize( url_object_type* url )
 {
     url_remove_query( url );
 
-    os_free( url->hostname );
-    os_free( url->path );
+    esp_arena_free( url->arena, url->hostname );
+    esp_arena_free( url->arena, url->path );
     url->hostname = NULL;
     url->path = NULL;
 }
@@ -463,22 +648,11 @@ url_protocol_type ICACHE_FLASH_ATTR url_get_protocol_type( uint8_t* protocol )
  */
 void ICACHE_FLASH_ATTR url_write_protocol_type( uint8_t* destination, url_protocol_type protocol )
 {
-    char https[ 6 ] = "http\0\0";
-    char wss[ 4 ] = "ws\0\0";
+    url_writer_type writer;
 
-    if( protocol != URL_PROTOCOL_NONE ) {
-        if( protocol == URL_PROTOCOL_HTTP ) {
-            strcpy( ( char* ) destination, https );
-        } else if( protocol == URL_PROTOCOL_HTTPS ) {
-            https[ 4 ] = 's';
-            strcpy( ( char* ) destination, https );
-        } else if( protocol == URL_PROTOCOL_WS ) {
-            strcpy( ( char* ) destination, wss );
-        } else {
-            wss[ 2 ] = 's';
-            strcpy( ( char* ) destination, wss );
-        }
-    }
+    url_writer_initialize( &writer, destination, 0xFFFF );
+    url_write_protocol( &writer, protocol );
+    url_writer_terminate( &writer );
 }
 
 /**
@@ -491,28 +665,218 @@ uint8_t* ICACHE_FLASH_ATTR skip_whitespace( uint8_t* data )
     return data;
 }
 
+/**
+ * Match URL protocol span
+ */
+url_protocol_type ICACHE_FLASH_ATTR url_get_protocol_type_length( uint8_t* protocol, uint16_t length )
+{
+    char https[ 6 ] = "https", wss[ 4 ] = "wss";
+
+    if( length == 4 && strnicmp( ( char* ) protocol, https, 4 ) == 0 ) return URL_PROTOCOL_HTTP;
+    if( length == 5 && strnicmp( ( char* ) protocol, https, 5 ) == 0 ) return URL_PROTOCOL_HTTPS;
+    if( length == 2 && strnicmp( ( char* ) protocol, wss, 2 ) == 0 ) return URL_PROTOCOL_WS;
+    if( length == 3 && strnicmp( ( char* ) protocol, wss, 3 ) == 0 ) return URL_PROTOCOL_WSS;
+    return URL_PROTOCOL_NONE;
+}
+
+/**
+ * Split path, query and fragment starting at the given offset
+ */
+LOCAL void ICACHE_FLASH_ATTR url_view_parse_target( url_view_type* view, uint16_t offset )
+{
+    uint8_t* s = view->source;
+    uint16_t i = offset, n = view->length;
+
+    for( ; i < n && s[ i ] != '?' && s[ i ] != '#' ; i++ );
+    view->path.offset = offset;
+    view->path.length = i - offset;
+
+    if( i < n && s[ i ] == '?' ) {
+        view->query.offset = ++i;
+        for( ; i < n && s[ i ] != '#' ; i++ );
+        view->query.length = i - view->query.offset;
+    } else view->query.offset = i;
+
+    if( i < n && s[ i ] == '#' ) i++;
+    view->fragment.offset = i;
+    view->fragment.length = n - i;
+}
+
+/**
+ * Reset the view over the given string
+ */
+LOCAL void ICACHE_FLASH_ATTR url_view_reset( url_view_type* view, uint8_t* source, uint16_t length )
+{
+    os_memset( view, 0, sizeof( url_view_type ) );
+    view->source = source;
+    view->length = length;
+}
+
+/**
+ * Parses an URL into spans, returns 0 if the port is malformed
+ */
+uint8_t ICACHE_FLASH_ATTR url_view_parse( url_view_type* view, uint8_t* url_string, uint16_t length )
+{
+    uint8_t* s = url_string;
+    uint16_t i, start = 0, end, host_end;
+    uint32_t port = 0;
+
+    url_view_reset( view, url_string, length );
+
+    if( length >= 2 && s[ 0 ] == '/' && s[ 1 ] == '/' ) {
+        start = 2;
+    } else {
+        // scheme, only if followed by ://
+        for( i = 0; i < length && s[ i ] != ':' && s[ i ] != '/' && s[ i ] != '?' && s[ i ] != '#' ; i++ );
+        if( i + 2 < length && s[ i ] == ':' && s[ i + 1 ] == '/' && s[ i + 2 ] == '/' ) {
+            view->scheme.length = i;
+            view->protocol = url_get_protocol_type_length( s, i );
+            start = i + 3;
+        } else if( length > 0 && s[ 0 ] == '/' ) {
+            // path only
+            url_view_parse_target( view, 0 );
+            return 0x01;
+        }
+    }
+
+    // authority
+    for( end = start; end < length && s[ end ] != '/' && s[ end ] != '?' && s[ end ] != '#' ; end++ );
+    for( i = end; i > start ; i-- ) {
+        if( s[ i - 1 ] == '@' ) {
+            start = i;
+            break;
+        }
+    }
+    for( host_end = start; host_end < end && s[ host_end ] != ':' ; host_end++ );
+    view->host.offset = start;
+    view->host.length = host_end - start;
+    view->host_ip = url_hostname_is_ip_length( s + start, view->host.length );
+
+    for( i = host_end + 1; i < end ; i++ ) {
+        if( ! isdigit( s[ i ] ) || ( port = port * 10 + ( s[ i ] - '0' ) ) > 0xFFFF ) return 0x00;
+    }
+    view->port = ( uint16_t ) port;
+
+    url_view_parse_target( view, end );
+    return 0x01;
+}
+
+/**
+ * Parses a request path with optional query and fragment into spans
+ */
+uint8_t ICACHE_FLASH_ATTR url_view_parse_path( url_view_type* view, uint8_t* url_path, uint16_t length )
+{
+    url_view_reset( view, url_path, length );
+    url_view_parse_target( view, 0 );
+    return 0x01;
+}
+
+/**
+ * Start of the span in the source string
+ */
+uint8_t* ICACHE_FLASH_ATTR url_view_pointer( url_view_type* view, url_span_type* span )
+{
+    return view->source + span->offset;
+}
+
+/**
+ * Copy the span as a string, truncated to the destination size, returns the copied length
+ */
+uint16_t ICACHE_FLASH_ATTR url_view_copy( url_view_type* view, url_span_type* span, uint8_t* destination, uint16_t size )
+{
+    uint16_t length = span->length;
+
+    if( size == 0 ) return 0;
+    if( length > size - 1 ) length = size - 1;
+    os_memcpy( destination, view->source + span->offset, length );
+    destination[ length ] = '\0';
+    return length;
+}
+
+/**
+ * Case insensitive compare of the span with a string
+ */
+uint8_t ICACHE_FLASH_ATTR url_view_equals( url_view_type* view, url_span_type* span, uint8_t* value )
+{
+    return strnicmp( ( char* ) ( view->source + span->offset ), ( char* ) value, span->length ) == 0 && value[ span->length ] == '\0';
+}
+
+/**
+ * Next name=value pair of the query, cursor starts at 0, returns 0 after the last pair
+ */
+uint8_t ICACHE_FLASH_ATTR url_view_query_next( url_view_type* view, uint16_t* cursor, url_span_type* name, url_span_type* value )
+{
+    uint8_t* s = view->source;
+    uint16_t i = view->query.offset + ( *cursor ), end = view->query.offset + view->query.length;
+
+    // skip empty pairs
+    while( i < end && ( s[ i ] == '&' || s[ i ] == '=' ) ) i++;
+    if( i >= end ) {
+        ( *cursor ) = view->query.length;
+        return 0x00;
+    }
+
+    name->offset = i;
+    for( ; i < end && s[ i ] != '=' && s[ i ] != '&' ; i++ );
+    name->length = i - name->offset;
+
+    if( i < end && s[ i ] == '=' ) i++;
+    value->offset = i;
+    for( ; i < end && s[ i ] != '&' ; i++ );
+    value->length = i - value->offset;
+
+    ( *cursor ) = i - view->query.offset;
+    return 0x01;
+}
+
+/**
+ * Find a query parameter by name, the value span is still encoded
+ */
+uint8_t ICACHE_FLASH_ATTR url_view_query_get( url_view_type* view, uint8_t* parameter_name, url_span_type* value )
+{
+    url_span_type name;
+    uint16_t cursor = 0;
+
+    while( url_view_query_next( view, &cursor, &name, value ) )
+        if( url_view_equals( view, &name, parameter_name ) ) return 0x01;
+    return 0x00;
+}
+
 /**
  * Parse URL path and query into object
  */
 void ICACHE_FLASH_ATTR url_parse_path( url_object_type* url, uint8_t* url_path )
 {
-    uint8_t* fragment, *delimiter, *query;
+    url_view_type view;
 
     url_path = skip_whitespace( url_path );
+    url_view_parse_path( &view, url_path, strlen( ( char* ) url_path ) );
 
-    if( ( fragment = ( uint8_t* ) strchr( ( char* ) url_path, '#' ) ) != NULL ) ( *fragment ) = '\0';
-    if( ( delimiter = ( uint8_t* ) strchr( ( char* ) url_path, '?' ) ) != NULL ) {
-        ( *delimiter ) = '\0';
-        query = delimiter + 1;
-        url_parse_query( url, query, strlen( query ) );
-    }
+    if( view.query.length > 0 )
+        url_parse_query( url, url_view_pointer( &view, &( view.query ) ), view.query.length );
+
+    esp_arena_free( url->arena, url->path );
+    url->path = ( uint8_t* ) esp_arena_malloc( url->arena, view.path.length + 1 );
+    url_view_copy( &view, &( view.path ), url->path, view.path.length + 1 );
+}
+
+/**
+ * Parses the path, the query is only kept to be parsed on the first parameter access
+ */
+void ICACHE_FLASH_ATTR url_parse_path_lazy( url_object_type* url, uint8_t* url_path )
+{
+    url_view_type view;
 
-    if( url->path != NULL ) os_free( url_path );
-    url->path = ( uint8_t* ) os_malloc( strlen( ( char* ) url_path ) + 1 );
-    strcpy( ( char* ) url->path, ( char* ) url_path );
+    url_path = skip_whitespace( url_path );
+    url_view_parse_path( &view, url_path, strlen( ( char* ) url_path ) );
+
+    // spans of an earlier request point into its released data
+    url->query.raw_count = url->query.raw_parsed = 0;
+    url_query_defer( url, url_view_pointer( &view, &( view.query ) ), view.query.length );
 
-    if( fragment != NULL ) ( *fragment ) = '#';
-    if( delimiter != NULL ) ( *delimiter ) = '?';
+    esp_arena_free( url->arena, url->path );
+    url->path = ( uint8_t* ) esp_arena_malloc( url->arena, view.path.length + 1 );
+    url_view_copy( &view, &( view.path ), url->path, view.path.length + 1 );
 }
 
 
@@ -521,104 +885,223 @@ void ICACHE_FLASH_ATTR url_parse_path( url_object_type* url, uint8_t* url_path )
  */
 void ICACHE_FLASH_ATTR url_parse( url_object_type* url, uint8_t* url_string )
 {
-    char hostname[ 256 ] = "";
-    uint8_t* delimiter, *parse, *query, *port_syntax, *path;
-    uint16_t port = 0;
+    url_view_type view;
 
-    url->protocol = URL_PROTOCOL_NONE;
+    url_view_parse( &view, url_string, strlen( ( char* ) url_string ) );
+    url_initialize_view( url, NULL, &view );
+}
 
-    if( ( *( url_string ) == '/' ) && ( *( url_string + 1 ) == '/' ) )
-        url_string += 2;
+/**
+ * Start writing into a buffer, a NULL buffer only counts the output
+ */
+void ICACHE_FLASH_ATTR url_writer_initialize( url_writer_type* writer, uint8_t* buffer, uint16_t capacity )
+{
+    writer->buffer = buffer;
+    writer->capacity = ( buffer != NULL ) ? capacity : 0;
+    writer->position = 0;
+    writer->skip = 0;
+    writer->total = 0;
+}
 
-    if( ( delimiter = ( uint8_t* ) strchr( ( char* ) url_string, ':' ) ) != NULL ) {
-        if( ( *( delimiter + 1 ) == '/' ) && ( *( delimiter + 2 ) == '/' ) ) {
-            ( *delimiter ) = '\0';
-            url->protocol = url_get_protocol_type( url_string );
-            ( *delimiter ) = ':';
-            url_string = delimiter + 3;
-        }
-    }
+/**
+ * Continue an output which didn't fit in a new buffer, the same object must be written again
+ * and everything which already went out is skipped
+ */
+void ICACHE_FLASH_ATTR url_writer_resume( url_writer_type* writer, uint8_t* buffer, uint16_t capacity )
+{
+    uint32_t written = writer->skip + writer->position;
 
-    if( ( delimiter = ( uint8_t* ) strchr( ( char* ) url_string, '/' ) ) != NULL )
-        ( *delimiter ) = '\0';
+    url_writer_initialize( writer, buffer, capacity );
+    writer->skip = written;
+}
 
-    if( ( parse = ( uint8_t* ) strchr( ( char* ) url_string, '@' ) ) != NULL )
-        url_string = parse + 1;
+/**
+ * Checks if the whole output went out
+ */
+uint8_t ICACHE_FLASH_ATTR url_writer_complete( url_writer_type* writer )
+{
+    return writer->total <= writer->skip + writer->position;
+}
 
-    if( ( port_syntax = ( uint8_t* ) strchr( ( char* ) url_string, ':' ) ) != NULL ) {
-        ( *port_syntax ) = '\0';
-        for( parse = port_syntax + 1; ( *parse ) != '\0' ; parse++ )
-            if( isdigit( *parse ) )
-                port = ( port * 10 ) + (( *parse ) - '0' );
-    }
-    strcpy( hostname, ( char* ) url_string );
-    if( port_syntax != NULL )
-        ( *port_syntax ) = ':';
+/**
+ * Terminate the output, returns 0 if there was no room for the terminator
+ */
+uint8_t ICACHE_FLASH_ATTR url_writer_terminate( url_writer_type* writer )
+{
+    if( writer->position >= writer->capacity ) return 0x00;
+    writer->buffer[ writer->position ] = '\0';
+    return 0x01;
+}
 
-    if( delimiter != NULL ) {
-        ( *delimiter ) = '/';
-        url_string = path = delimiter;
-    } else {
-        url_string = path = query = url_string + strlen( ( char* ) url_string );
+/**
+ * Append bytes, the part before the resume point is dropped and the part past the capacity only counted
+ */
+void ICACHE_FLASH_ATTR url_writer_put( url_writer_type* writer, uint8_t* data, uint16_t length )
+{
+    uint32_t before = writer->total;
+    uint16_t n;
+
+    writer->total += length;
+    if( before < writer->skip ) {
+        if( writer->skip - before >= length ) return;
+        data += writer->skip - before;
+        length -= writer->skip - before;
+        before = writer->skip;
     }
+    // once something didn't fit nothing after it may be written
+    if( before - writer->skip != writer->position ) return;
+    n = writer->capacity - writer->position;
+    if( n > length ) n = length;
+    if( n == 0 ) return;
+    os_memcpy( writer->buffer + writer->position, data, n );
+    writer->position += n;
+}
 
-    if( ( port_syntax = ( uint8_t* ) strchr( ( char* ) url_string, '#' ) ) != NULL )
-        ( *port_syntax ) = '\0';
+/**
+ * Append a string
+ */
+void ICACHE_FLASH_ATTR url_writer_put_string( url_writer_type* writer, uint8_t* string )
+{
+    url_writer_put( writer, string, strlen( ( char* ) string ) );
+}
 
-    if( ( delimiter = ( uint8_t* ) strchr( ( char* ) url_string, '?' ) ) != NULL ) {
-        ( *delimiter ) = '\0';
-        query = delimiter + 1;
-    } else {
-        query = url_string + strlen( ( char* ) url_string );
+/**
+ * Append a value percent encoded, unreserved runs are copied in one piece
+ */
+void ICACHE_FLASH_ATTR url_writer_put_encoded( url_writer_type* writer, uint8_t* value, uint16_t length )
+{
+    char hex[ 17 ] = "0123456789ABCDEF";
+    uint8_t* end = value + length, *run;
+    uint8_t escape[ 3 ];
+
+    while( value < end ) {
+        for( run = value; value < end && ( URL_CHAR_CLASS( *value ) & URL_CHAR_UNRESERVED ) ; value++ );
+        if( value > run ) url_writer_put( writer, run, value - run );
+        if( value == end ) break;
+
+        if( *value == ' ' ) {
+            escape[ 0 ] = '+';
+            url_writer_put( writer, escape, 1 );
+        } else {
+            escape[ 0 ] = '%';
+            escape[ 1 ] = hex[ *value >> 4 ];
+            escape[ 2 ] = hex[ *value & 0x0F ];
+            url_writer_put( writer, escape, 3 );
+        }
+        value++;
     }
+}
 
-    url_initialize( url, url->protocol, ( uint8_t* ) hostname, port, path, query );
+/**
+ * Append the protocol name
+ */
+void ICACHE_FLASH_ATTR url_write_protocol( url_writer_type* writer, url_protocol_type protocol )
+{
+    char https[ 6 ] = "https";
+    char wss[ 4 ] = "wss";
 
-    if( port_syntax != NULL ) ( *port_syntax ) = '#';
-    if( delimiter != NULL ) ( *delimiter ) = '?';
+    if( protocol == URL_PROTOCOL_HTTP ) url_writer_put( writer, ( uint8_t* ) https, 4 );
+    else if( protocol == URL_PROTOCOL_HTTPS ) url_writer_put( writer, ( uint8_t* ) https, 5 );
+    else if( protocol == URL_PROTOCOL_WS ) url_writer_put( writer, ( uint8_t* ) wss, 2 );
+    else if( protocol == URL_PROTOCOL_WSS ) url_writer_put( writer, ( uint8_t* ) wss, 3 );
 }
 
 /**
- * Returns a full URI address, built from the given URL object
+ * Append the query parameters, without the question mark
  */
-void ICACHE_FLASH_ATTR url_get_string( uint8_t* query, url_object_type* url, uint8_t show_port )
+void ICACHE_FLASH_ATTR url_write_query( url_writer_type* writer, url_object_type* url )
+{
+    url_query_parameter_type* p;
+    uint8_t separator[ 2 ] = "&=";
+    uint8_t i;
+
+    url_query_parse_pending( url );
+    for( i = 0; i < url->query.count ; i++ ) {
+        p = &( url->query.entries[ i ] );
+        if( i > 0 ) url_writer_put( writer, separator, 1 );
+        url_writer_put_string( writer, p->name );
+        url_writer_put( writer, separator + 1, 1 );
+        url_writer_put_encoded( writer, p->value, strlen( ( char* ) p->value ) );
+    }
+}
+
+/**
+ * Append the full URI address of the URL object
+ */
+void ICACHE_FLASH_ATTR url_write_string( url_writer_type* writer, url_object_type* url, uint8_t show_port )
 {
     char delimiter[ 4 ] = "://";
+    uint8_t text[ 16 ], *p;
     uint8_t has_host = 0;
+    uint16_t port;
 
     if( url->protocol != URL_PROTOCOL_NONE ) {
-        url_write_protocol_type( query, url->protocol );
-        query = query + strlen( ( char* ) query );
-        strcpy( ( char* ) query, delimiter );
-        query = query + strlen( ( char* ) query );
+        url_write_protocol( writer, url->protocol );
+        url_writer_put( writer, ( uint8_t* ) delimiter, 3 );
     }
 
-    if( url->hostname != NULL && ( strlen( ( char* ) url->hostname ) > 0 ) ) {
-        strcpy( ( char* ) query, ( char* ) url->hostname );
+    if( url->hostname != NULL && url->hostname[ 0 ] != '\0' ) {
+        url_writer_put_string( writer, url->hostname );
         has_host = 1;
     } else if( url->host_ip != 0x00000000 ) {
-        url_ip_to_hostname( query, url->host_ip );
+        url_ip_to_hostname( text, url->host_ip );
+        url_writer_put_string( writer, text );
         has_host = 1;
     }
 
-    if( has_host ) {
-        query = query + strlen( ( char* ) query );
-        if( show_port && url->port != 0x0000 ) {
-            os_sprintf( ( char* ) query, ":%d", url->port );
-            query = query + strlen( ( char* ) query );
-        }
+    if( has_host && show_port && url->port != 0x0000 ) {
+        // digits written backwards from the end
+        p = text + sizeof( text );
+        for( port = url->port; port > 0 ; port /= 10 )
+            *( --p ) = '0' + ( port % 10 );
+        *( --p ) = ':';
+        url_writer_put( writer, p, text + sizeof( text ) - p );
     }
 
-    if( url->path != NULL && ( strlen( ( char* ) url->path ) > 0 ) ) {
-        strcpy( ( char* ) query, ( char* ) url->path );
-        query = query + strlen( ( char* ) query );
-    }
+    if( url->path != NULL ) url_writer_put_string( writer, url->path );
 
-    if( url->query != NULL ) {
-        *( query++ ) = '?';
-        url_get_query( query, url );
+    if( url_query_count( url ) > 0 ) {
+        text[ 0 ] = '?';
+        url_writer_put( writer, text, 1 );
+        url_write_query( writer, url );
     }
+}
+
+/**
+ * Exact length of the full URI address, without the terminator
+ */
+uint32_t ICACHE_FLASH_ATTR url_get_string_length( url_object_type* url, uint8_t show_port )
+{
+    url_writer_type writer;
+
+    url_writer_initialize( &writer, NULL, 0 );
+    url_write_string( &writer, url, show_port );
+    return writer.total;
+}
+
+/**
+ * Returns a full URI address, built from the given URL object
+ */
+void ICACHE_FLASH_ATTR url_get_string( uint8_t* query, url_object_type* url, uint8_t show_port )
+{
+    url_writer_type writer;
+
+    url_writer_initialize( &writer, query, 0xFFFF );
+    url_write_string( &writer, url, show_port );
+    url_writer_terminate( &writer );
+}
+
+/**
+ * Write the current query into a string, returns the end of the written query
+ */
+uint8_t* ICACHE_FLASH_ATTR url_get_query( uint8_t* destination, url_object_type* url )
+{
+    url_writer_type writer;
 
+    url_writer_initialize( &writer, destination, 0xFFFF );
+    url_write_query( &writer, url );
+    url_writer_terminate( &writer );
+    return destination + writer.position;
 }
 
 
@@ -12,6 +12,8 @@
 #include "osapi.h"
 #include "user_interface.h"
 
+#include "esp_arena.h"
+
 /**
  * URL Schemes
  */
@@ -25,49 +27,158 @@ typedef enum {
 
 
 /**
- * Parameter list structure
+ * Query parameter table size
+ */
+#define URL_QUERY_HASH_SIZE 16
+#define URL_QUERY_NONE 0xFF
+
+/**
+ * Raw query strings kept for parsing on first access, the request path and a form body
  */
-typedef struct url_query_parameter url_query_parameter_type;
+#define URL_QUERY_RAW_SPANS 2
 
-struct url_query_parameter {
+/**
+ * Query parameter, name and value are decoded strings stored in the table block
+ */
+typedef struct url_query_parameter {
     uint8_t* name;
     uint8_t* value;
-    url_query_parameter_type* chain;
-};
+    uint8_t hash_next;
+} url_query_parameter_type;
+
+/**
+ * Query parameter table, entries in insertion order and their strings share one allocation, names are found
+ * through the hash index. Deferred raw strings are parsed into the table by the first parameter access and
+ * must stay valid until then.
+ */
+typedef struct url_query_table {
+    uint8_t* block;
+    url_query_parameter_type* entries;
+    uint8_t* strings;
+    uint16_t strings_size;
+    uint16_t strings_used;
+
+    uint8_t count;
+    uint8_t capacity;
+    uint8_t index[ URL_QUERY_HASH_SIZE ];
+
+    uint8_t* raw[ URL_QUERY_RAW_SPANS ];
+    uint16_t raw_length[ URL_QUERY_RAW_SPANS ];
+    uint8_t raw_count;
+    uint8_t raw_parsed;
+} url_query_table_type;
 
 /**
  * URL Object
  */
 typedef struct url_object {
+    esp_arena_type* arena;
     url_protocol_type protocol;
     uint32_t host_ip;
     uint8_t* hostname;
     uint16_t port;
     uint8_t* path;
-    url_query_parameter_type* query;
+    url_query_table_type query;
 } url_object_type;
 
 
+/**
+ * Span inside the parsed string
+ */
+typedef struct url_span {
+    uint16_t offset;
+    uint16_t length;
+} url_span_type;
+
+/**
+ * Read-only URL view, parsed in place without allocating or modifying the source
+ */
+typedef struct url_view {
+    uint8_t* source;
+    uint16_t length;
+
+    url_protocol_type protocol;
+    uint32_t host_ip;
+    uint16_t port;
+
+    url_span_type scheme;
+    url_span_type host;
+    url_span_type path;
+    url_span_type query;
+    url_span_type fragment;
+} url_view_type;
+
+/**
+ * Bounded output, position counts the bytes in the buffer and total the whole output. Bytes before skip already
+ * went out in an earlier buffer and bytes which don't fit are only counted, so total is the exact length.
+ */
+typedef struct url_writer {
+    uint8_t* buffer;
+    uint16_t capacity;
+    uint16_t position;
+    uint32_t skip;
+    uint32_t total;
+} url_writer_type;
+
+/**
+ * URL Writer functions
+ */
+void ICACHE_FLASH_ATTR url_writer_initialize( url_writer_type* writer, uint8_t* buffer, uint16_t capacity );
+void ICACHE_FLASH_ATTR url_writer_resume( url_writer_type* writer, uint8_t* buffer, uint16_t capacity );
+uint8_t ICACHE_FLASH_ATTR url_writer_complete( url_writer_type* writer );
+uint8_t ICACHE_FLASH_ATTR url_writer_terminate( url_writer_type* writer );
+void ICACHE_FLASH_ATTR url_writer_put( url_writer_type* writer, uint8_t* data, uint16_t length );
+void ICACHE_FLASH_ATTR url_writer_put_string( url_writer_type* writer, uint8_t* string );
+void ICACHE_FLASH_ATTR url_writer_put_encoded( url_writer_type* writer, uint8_t* value, uint16_t length );
+void ICACHE_FLASH_ATTR url_write_protocol( url_writer_type* writer, url_protocol_type protocol );
+void ICACHE_FLASH_ATTR url_write_query( url_writer_type* writer, url_object_type* url );
+void ICACHE_FLASH_ATTR url_write_string( url_writer_type* writer, url_object_type* url, uint8_t show_port );
+uint32_t ICACHE_FLASH_ATTR url_get_string_length( url_object_type* url, uint8_t show_port );
+
+/**
+ * URL View functions
+ */
+uint8_t ICACHE_FLASH_ATTR url_view_parse( url_view_type* view, uint8_t* url_string, uint16_t length );
+uint8_t ICACHE_FLASH_ATTR url_view_parse_path( url_view_type* view, uint8_t* url_path, uint16_t length );
+uint8_t* ICACHE_FLASH_ATTR url_view_pointer( url_view_type* view, url_span_type* span );
+uint16_t ICACHE_FLASH_ATTR url_view_copy( url_view_type* view, url_span_type* span, uint8_t* destination, uint16_t size );
+uint8_t ICACHE_FLASH_ATTR url_view_equals( url_view_type* view, url_span_type* span, uint8_t* value );
+uint8_t ICACHE_FLASH_ATTR url_view_query_next( url_view_type* view, uint16_t* cursor, url_span_type* name, url_span_type* value );
+uint8_t ICACHE_FLASH_ATTR url_view_query_get( url_view_type* view, uint8_t* parameter_name, url_span_type* value );
+
 /**
  * URL Constructor functions
  */
 void ICACHE_FLASH_ATTR url_initialize( url_object_type*, url_protocol_type protocol, uint8_t* hostname, uint16_t port, uint8_t* path, uint8_t* query );
+void ICACHE_FLASH_ATTR url_initialize_arena( url_object_type*, esp_arena_type* arena, url_protocol_type protocol, uint8_t* hostname, uint16_t port, uint8_t* path, uint8_t* query );
+void ICACHE_FLASH_ATTR url_initialize_view( url_object_type* url, esp_arena_type* arena, url_view_type* view );
 void ICACHE_FLASH_ATTR url_parse( url_object_type* url, uint8_t* url_string );
 void ICACHE_FLASH_ATTR url_parse_path( url_object_type* url, uint8_t* url_path );
+void ICACHE_FLASH_ATTR url_parse_path_lazy( url_object_type* url, uint8_t* url_path );
 void ICACHE_FLASH_ATTR url_parse_query( url_object_type*, uint8_t* query, int16_t length );
 void ICACHE_FLASH_ATTR url_get_string( uint8_t* query, url_object_type* url, uint8_t show_port );
 
 /**
  * URL Query parameter functions
  */
-void ICACHE_FLASH_ATTR url_parameter_encode( uint8_t* encoded_parameter, uint8_t* parameter_value );
-void ICACHE_FLASH_ATTR url_parameter_decode( uint8_t* parameter, uint8_t* encoded_parameter );
+uint16_t ICACHE_FLASH_ATTR url_parameter_get_encoded_size( uint8_t* parameter_value );
+uint16_t ICACHE_FLASH_ATTR url_parameter_get_encoded_size_length( uint8_t* parameter_value, uint16_t length );
+uint16_t ICACHE_FLASH_ATTR url_parameter_encode( uint8_t* encoded_parameter, uint8_t* parameter_value );
+uint16_t ICACHE_FLASH_ATTR url_parameter_encode_length( uint8_t* encoded_parameter, uint8_t* parameter_value, uint16_t length );
+uint16_t ICACHE_FLASH_ATTR url_parameter_decode( uint8_t* parameter, uint8_t* encoded_parameter );
+uint16_t ICACHE_FLASH_ATTR url_parameter_decode_length( uint8_t* parameter, uint8_t* encoded_parameter, uint16_t length );
 
 void ICACHE_FLASH_ATTR url_add_query_parameter( url_object_type*, uint8_t* parameter_name, uint8_t* parameter_value, uint8_t encoded_value );
 url_query_parameter_type* ICACHE_FLASH_ATTR url_get_query_parameter( url_object_type* url, uint8_t* parameter_name );
+uint8_t ICACHE_FLASH_ATTR url_query_count( url_object_type* url );
+url_query_parameter_type* ICACHE_FLASH_ATTR url_query_parameter_at( url_object_type* url, uint8_t index );
 void ICACHE_FLASH_ATTR url_remove_query_parameter( url_object_type*, uint8_t* parameter_name );
 uint8_t* ICACHE_FLASH_ATTR url_get_query( uint8_t* destination, url_object_type* url );
-uint32_t ICACHE_FLASH_ATTR url_query_compute_length( url_query_parameter_type* list );
+uint32_t ICACHE_FLASH_ATTR url_query_compute_length( url_query_table_type* query );
+
+void ICACHE_FLASH_ATTR url_query_defer( url_object_type* url, uint8_t* query, uint16_t length );
+void ICACHE_FLASH_ATTR url_query_parse_pending( url_object_type* url );
+uint8_t* ICACHE_FLASH_ATTR url_query_raw( url_object_type* url, uint8_t index, uint16_t* length );
 
 /**
  * IP Functions
@@ -37,6 +37,12 @@ uint32_t __ws_stream_generate_mask( void )
 
 
 uint32_t websocket_stream_encode( uint8_t* dest_data, uint8_t* source_data, uint32_t data_length, uint8_t opcode, uint8_t mask_data )
+{
+    return websocket_stream_encode_fragment( dest_data, source_data, data_length, opcode, 1, mask_data );
+}
+
+
+uint32_t websocket_stream_encode_fragment( uint8_t* dest_data, uint8_t* source_data, uint32_t data_length, uint8_t opcode, uint8_t fin, uint8_t mask_data )
 {
     uint8_t* packet_data;
     uint8_t header_size = 2;
@@ -54,7 +60,7 @@ uint32_t websocket_stream_encode( uint8_t* dest_data, uint8_t* source_data, uint
     if( data_length < 0x7E ) ;
     else if( data_length < 0xFFFF ) header_size += 2;
     else header_size += 8;
-    __WS_BIT_SET( dest_data[ 0 ], __WS_FIN_BIT );
+    if( fin ) __WS_BIT_SET( dest_data[ 0 ], __WS_FIN_BIT );
     // set opcode
     dest_data[ 0 ] |= opcode & __WS_MASK_OPCODE_BITS;
     // set the mask bit
@@ -118,6 +118,14 @@ uint32_t __ws_stream_generate_mask( void );
 uint32_t websocket_stream_encode( uint8_t *dest_data, uint8_t* source_data, uint32_t data_length, uint8_t opcode, uint8_t mask_data );
 
 
+/**
+ * /fn          websocket_stream_encode_fragment
+ * /brief       Create one fragment of a message, the first uses the data opcode, the next ones continuation (0x0)
+ * Set fin on the last fragment. Used to stream messages which are generated in chunks.
+ */
+uint32_t websocket_stream_encode_fragment( uint8_t *dest_data, uint8_t* source_data, uint32_t data_length, uint8_t opcode, uint8_t fin, uint8_t mask_data );
+
+
 /**
  * /fn 			websocket_stream_decode_init
  * /brief		Initialize the stream decoder and register the message callback
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Builds the flash simulator benchmarks, the parameter store for both layouts and the firmware update
+cd "$(dirname "$0")"
+mkdir -p bin
+SOURCES="source/esp_flash_bench.c source/esp_flash_sim.c source/esp_host_sdk.c ../../firmware/libraries/esp_crc32.c"
+FLAGS="-O2 -g -std=gnu99 -Isdk -Isource -I../../firmware/libraries $CFLAGS"
+cc $FLAGS $SOURCES -o bin/esp_flash_bench || exit 1
+cc $FLAGS -DESP_FLASH_LOG_STRUCTURED $SOURCES -o bin/esp_flash_bench_log || exit 1
+L=../../firmware/libraries
+OTA_SOURCES="source/esp_ota_bench.c source/esp_flash_sim.c source/esp_host_sdk.c $L/esp_ota_update.c $L/esp_crc32.c $L/esp_http.c $L/esp_http_multipart.c $L/esp_http_metrics.c $L/esp_url.c $L/esp_arena.c"
+cc $FLAGS $OTA_SOURCES -o bin/esp_ota_bench || exit 1
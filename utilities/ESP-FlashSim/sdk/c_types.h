@@ -0,0 +1,33 @@
+/**
+ * \brief		Host stand-in for the SDK c_types.h
+ * \file		c_types.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HOST_C_TYPES_H__
+#define __ESP_HOST_C_TYPES_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t sint8;
+typedef int16_t sint16;
+typedef int32_t sint32;
+
+#ifndef __cplusplus
+typedef unsigned char bool;
+#define true 1
+#define false 0
+#endif
+
+#define LOCAL static
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RODATA_ATTR
+#define IRAM_ATTR
+
+#endif
@@ -0,0 +1,14 @@
+/**
+ * \brief		Host stand-in for the SDK ets_sys.h
+ * \file		ets_sys.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HOST_ETS_SYS_H__
+#define __ESP_HOST_ETS_SYS_H__
+
+#include "c_types.h"
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * \brief		Host stand-in for the SDK mem.h
+ * \file		mem.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HOST_MEM_H__
+#define __ESP_HOST_MEM_H__
+
+#include <stdlib.h>
+
+#define os_malloc malloc
+#define os_zalloc( size ) calloc( 1, size )
+#define os_realloc realloc
+#define os_free free
+
+#endif
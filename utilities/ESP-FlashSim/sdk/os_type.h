@@ -0,0 +1,14 @@
+/**
+ * \brief		Host stand-in for the SDK os_type.h
+ * \file		os_type.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HOST_OS_TYPE_H__
+#define __ESP_HOST_OS_TYPE_H__
+
+#include "osapi.h"
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * \brief		Host stand-in for the SDK osapi.h
+ * \file		osapi.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * The string functions map to libc, the timers are implemented in esp_host_sdk.c.
+ */
+#ifndef __ESP_HOST_OSAPI_H__
+#define __ESP_HOST_OSAPI_H__
+
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "c_types.h"
+
+#define os_memcpy memcpy
+#define os_memset memset
+#define os_memcmp memcmp
+#define os_memmove memmove
+#define os_strlen strlen
+#define os_strcmp strcmp
+#define os_strncmp strncmp
+#define os_strcpy strcpy
+#define os_sprintf sprintf
+#define os_printf printf
+#define stricmp strcasecmp
+#define strnicmp strncasecmp
+
+typedef void os_timer_func_t( void* timer_arg );
+
+typedef struct _os_timer_t {
+    struct _os_timer_t* timer_next;
+    uint32_t timer_expire;
+    uint32_t timer_period;
+    os_timer_func_t* timer_func;
+    void* timer_arg;
+    uint8_t timer_armed;
+} os_timer_t;
+
+void os_timer_setfn( os_timer_t* timer, os_timer_func_t* function, void* arg );
+void os_timer_arm( os_timer_t* timer, uint32_t milliseconds, bool repeat );
+void os_timer_disarm( os_timer_t* timer );
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * \brief		Host stand-in for the SDK spi_flash.h
+ * \file		spi_flash.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Implemented by the flash simulator in esp_flash_sim.c.
+ */
+#ifndef __ESP_HOST_SPI_FLASH_H__
+#define __ESP_HOST_SPI_FLASH_H__
+
+#include "c_types.h"
+
+typedef enum {
+    SPI_FLASH_RESULT_OK,
+    SPI_FLASH_RESULT_ERR,
+    SPI_FLASH_RESULT_TIMEOUT
+} SpiFlashOpResult;
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+SpiFlashOpResult spi_flash_erase_sector( uint16 sector );
+SpiFlashOpResult spi_flash_write( uint32 destination, uint32* source, uint32 size );
+SpiFlashOpResult spi_flash_read( uint32 source, uint32* destination, uint32 size );
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * \brief		Host stand-in for the SDK upgrade.h
+ * \file		upgrade.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * The upgrade flag lives in RAM like on the chip, a power cut before system_upgrade_reboot forgets it. Implemented
+ * in esp_host_sdk.c.
+ */
+#ifndef __ESP_HOST_UPGRADE_H__
+#define __ESP_HOST_UPGRADE_H__
+
+#include "c_types.h"
+
+#define UPGRADE_FW_BIN1 0x00
+#define UPGRADE_FW_BIN2 0x01
+
+#define UPGRADE_FLAG_IDLE 0x00
+#define UPGRADE_FLAG_START 0x01
+#define UPGRADE_FLAG_FINISH 0x02
+
+uint8 system_upgrade_userbin_check( void );
+void system_upgrade_flag_set( uint8 flag );
+uint8 system_upgrade_flag_check( void );
+void system_upgrade_reboot( void );
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * \brief		Host stand-in for the SDK user_interface.h
+ * \file		user_interface.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#ifndef __ESP_HOST_USER_INTERFACE_H__
+#define __ESP_HOST_USER_INTERFACE_H__
+
+#include "c_types.h"
+#include "os_type.h"
+#include "spi_flash.h"
+
+uint32 system_get_time( void );
+void system_restart( void );
+
+#endif
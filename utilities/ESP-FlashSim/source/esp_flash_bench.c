@@ -0,0 +1,745 @@
+/**
+ * \brief		Parameter store benchmark and power loss stress test
+ * \file		esp_flash_bench.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Runs esp_flash_save.c on the flash simulator. The benchmark drives random save, remove and read workloads against
+ * a model of the stored values and reports the operations per second, the erases and bytes written per update, the
+ * SPI bytes read per lookup and the wear of the busiest sector. The stress test cuts the power at a random byte of
+ * an update, boots again and checks every parameter holds either its old or its new value, and that a transaction
+ * applied whole. The log build also cuts the power while it takes over a sorted store. The queued workload commits
+ * on the idle timeout, the batched one only once the queued bytes reach the commit threshold, and the transaction
+ * workload aborts some of its transactions. The blob workloads stream random blobs in and out of the blob area, and
+ * cut the power while one is written or removed to check the newest complete copy is the one read back.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "esp_flash_sim.h"
+#include "esp_host_sdk.h"
+#include "esp_flash_save.c"
+
+/**
+ * Parameter ids used by the workloads, values are 1 to ESP_FLASH_BENCH_MAX_SIZE bytes
+ */
+#define ESP_FLASH_BENCH_IDS 24
+#define ESP_FLASH_BENCH_MAX_SIZE 48
+#define ESP_FLASH_BENCH_TRANSACTION_SIZE 6
+
+/**
+ * Blob ids used by the blob workloads, every blob fits a share of the area so a new copy always finds room
+ */
+#define ESP_FLASH_BENCH_BLOB_IDS 4
+#define ESP_FLASH_BENCH_BLOB_MAX ( ESP_FLASH_BLOB_SECTORS / ( ESP_FLASH_BENCH_BLOB_IDS + 1 ) * ESP_FLASH_BLOB_SECTOR_SIZE - sizeof( esp_flash_blob_header_type ) )
+#define ESP_FLASH_BENCH_BLOB_STEP 700
+
+/**
+ * Parameter ids of the schema workload, after the ones of the other workloads, and of the values which fill the
+ * sector around it
+ */
+#define ESP_FLASH_BENCH_SCHEMA_ID ( ESP_FLASH_BENCH_IDS + 1 )
+#define ESP_FLASH_BENCH_SCHEMA_COUNT 4
+#define ESP_FLASH_BENCH_FILLER_ID 0xC0
+
+/**
+ * Workloads
+ */
+typedef enum {
+    ESP_FLASH_BENCH_INSTANT = 0,
+    ESP_FLASH_BENCH_QUEUED,
+    ESP_FLASH_BENCH_BATCHED,
+    ESP_FLASH_BENCH_TRANSACTION
+} esp_flash_bench_mode_type;
+
+/**
+ * Expected value of a parameter, size 0 when it isn't stored
+ */
+typedef struct esp_flash_bench_value {
+    uint8_t data[ ESP_FLASH_BENCH_MAX_SIZE ];
+    uint8_t size;
+} esp_flash_bench_value_type;
+
+/**
+ * Expected content of a blob, stored 0 when it isn't in flash. Entry 0 holds a new blob until it is sealed.
+ */
+typedef struct esp_flash_bench_blob {
+    uint8_t data[ ESP_FLASH_BENCH_BLOB_MAX ];
+    uint32_t length;
+    uint8_t stored;
+} esp_flash_bench_blob_type;
+
+/**
+ * Settings loaded through a schema, the fields leave no padding so the struct compares whole
+ */
+typedef struct esp_flash_bench_settings {
+    uint32_t interval;
+    uint8_t mode;
+    char name[ 24 ];
+    char label[ 15 ];
+} esp_flash_bench_settings_type;
+
+static const uint32_t esp_flash_bench_default_interval = 60000;
+static const uint8_t esp_flash_bench_default_mode = 0x03;
+static const char esp_flash_bench_default_name[] = "sensor";
+static const char esp_flash_bench_default_label[] = "";
+
+#define ESP_FLASH_BENCH_SCHEMA_FIELD( id, type, field, value, size ) \
+    { id, type, ESP_FLASH_SCHEMA_SIZE( esp_flash_bench_settings_type, field ), ESP_FLASH_SCHEMA_OFFSET( esp_flash_bench_settings_type, field ), value, size }
+
+static const esp_flash_schema_entry_type esp_flash_bench_schema[ ESP_FLASH_BENCH_SCHEMA_COUNT ] = {
+    ESP_FLASH_BENCH_SCHEMA_FIELD( ESP_FLASH_BENCH_SCHEMA_ID, ESP_FLASH_SCHEMA_BYTES, interval, &esp_flash_bench_default_interval, sizeof( uint32_t ) ),
+    ESP_FLASH_BENCH_SCHEMA_FIELD( ESP_FLASH_BENCH_SCHEMA_ID + 1, ESP_FLASH_SCHEMA_BYTES, mode, &esp_flash_bench_default_mode, 1 ),
+    ESP_FLASH_BENCH_SCHEMA_FIELD( ESP_FLASH_BENCH_SCHEMA_ID + 2, ESP_FLASH_SCHEMA_STRING, name, esp_flash_bench_default_name, sizeof( esp_flash_bench_default_name ) - 1 ),
+    ESP_FLASH_BENCH_SCHEMA_FIELD( ESP_FLASH_BENCH_SCHEMA_ID + 3, ESP_FLASH_SCHEMA_STRING, label, esp_flash_bench_default_label, 0 )
+};
+
+static esp_flash_bench_value_type esp_flash_bench_model[ ESP_FLASH_BENCH_IDS + 1 ];
+static esp_flash_bench_blob_type esp_flash_bench_blobs[ ESP_FLASH_BENCH_BLOB_IDS + 1 ];
+static uint32_t esp_flash_bench_read_ratio = 70;
+
+
+/**
+ * Wall clock in seconds
+ */
+static double esp_flash_bench_now( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Boot, the model takes the stored values
+ */
+static void esp_flash_bench_boot( void )
+{
+    uint8_t id;
+    esp_flash_setup();
+    for( id = 1; id <= ESP_FLASH_BENCH_IDS ; id ++ )
+        esp_flash_bench_model[ id ].size = esp_flash_read_parameter( id, esp_flash_bench_model[ id ].data );
+}
+
+/**
+ * Random value for a parameter
+ */
+static void esp_flash_bench_value( esp_flash_bench_value_type* value )
+{
+    uint8_t i;
+    value->size = 1 + esp_flash_sim_random() % ESP_FLASH_BENCH_MAX_SIZE;
+    for( i = 0; i < value->size ; i ++ )
+        value->data[ i ] = ( uint8_t ) esp_flash_sim_random();
+}
+
+/**
+ * Compare a parameter in flash with a value, returns 1 when they match
+ */
+static uint8_t esp_flash_bench_matches( uint8_t id, esp_flash_bench_value_type* value )
+{
+    uint8_t data[ 0x100 ];
+    uint8_t size = esp_flash_read_parameter( id, data );
+    return size == value->size && memcmp( data, value->data, size ) == 0;
+}
+
+/**
+ * Apply one save or remove to flash and to the model
+ */
+static void esp_flash_bench_update( uint8_t id )
+{
+    esp_flash_bench_value_type value;
+    if( esp_flash_sim_random() % 10 == 0 ){
+        esp_flash_remove_parameter( id );
+        esp_flash_bench_model[ id ].size = 0;
+    } else {
+        esp_flash_bench_value( &value );
+        esp_flash_save_parameter( id, value.data, value.size );
+        esp_flash_bench_model[ id ] = value;
+    }
+}
+
+/**
+ * Run a workload, returns the number of reads which didn't match the model
+ */
+static uint32_t esp_flash_bench_run( esp_flash_bench_mode_type mode, uint32_t operations )
+{
+    static const char* names[] = { "instant", "queued", "batched", "transaction" };
+    esp_flash_sim_stats_type* stats = esp_flash_sim_get_stats();
+    esp_flash_bench_value_type before[ ESP_FLASH_BENCH_IDS + 1 ];
+    uint32_t i, j, count, reads = 0, updates = 0, aborts = 0, errors = 0, wear = 0, flushes = esp_host_cache_flushes();
+    uint64_t lookup_bytes = 0, read_bytes;
+    uint16_t sector;
+    double start, elapsed;
+
+    esp_flash_sim_reset_stats();
+    if( mode != ESP_FLASH_BENCH_INSTANT )
+        esp_flash_disable_instant_update();
+    // batched updates wait for the commit threshold, however long the application stays quiet
+    if( mode == ESP_FLASH_BENCH_BATCHED )
+        esp_flash_set_commit_policy( 0, ESP_FLASH_COMMIT_THRESHOLD );
+    start = esp_flash_bench_now();
+    for( i = 0; i < operations ; i ++ ){
+        uint8_t id = 1 + esp_flash_sim_random() % ESP_FLASH_BENCH_IDS;
+        if( esp_flash_sim_random() % 100 < esp_flash_bench_read_ratio ){
+            read_bytes = stats->read_bytes;
+            if( ! esp_flash_bench_matches( id, &esp_flash_bench_model[ id ] ) )
+                errors ++;
+            lookup_bytes += stats->read_bytes - read_bytes;
+            reads ++;
+        } else if( mode == ESP_FLASH_BENCH_TRANSACTION ){
+            // a group of parameters changed together
+            count = 2 + esp_flash_sim_random() % ( ESP_FLASH_BENCH_TRANSACTION_SIZE - 1 );
+            memcpy( before, esp_flash_bench_model, sizeof( before ) );
+            esp_flash_transaction_begin();
+            // transactions don't nest
+            if( esp_flash_transaction_begin() )
+                errors ++;
+            for( j = 0; j < count ; j ++ )
+                esp_flash_bench_update( 1 + ( id + j ) % ESP_FLASH_BENCH_IDS );
+            // some groups are dropped half way, none of their updates reach the flash
+            if( esp_flash_sim_random() % 8 == 0 ){
+                esp_flash_transaction_abort();
+                memcpy( esp_flash_bench_model, before, sizeof( before ) );
+                aborts ++;
+                continue;
+            }
+            if( ! esp_flash_transaction_commit() )
+                errors ++;
+            updates += count;
+        } else {
+            esp_flash_bench_update( id );
+            updates ++;
+        }
+        // queued updates are committed once the application goes quiet
+        if( mode == ESP_FLASH_BENCH_QUEUED || mode == ESP_FLASH_BENCH_BATCHED )
+            esp_host_run_timers( ( esp_flash_sim_random() % 16 == 0 ) ? ESP_FLASH_COMMIT_IDLE_TIMEOUT : 10 );
+    }
+    if( mode == ESP_FLASH_BENCH_BATCHED )
+        esp_flash_set_commit_policy( ESP_FLASH_COMMIT_IDLE_TIMEOUT, ESP_FLASH_COMMIT_THRESHOLD );
+    if( mode != ESP_FLASH_BENCH_INSTANT )
+        esp_flash_enable_instant_update();
+    elapsed = esp_flash_bench_now() - start;
+    // the values survive a reboot
+    esp_flash_setup();
+    for( i = 1; i <= ESP_FLASH_BENCH_IDS ; i ++ ){
+        if( ! esp_flash_bench_matches( i, &esp_flash_bench_model[ i ] ) )
+            errors ++;
+    }
+    for( sector = 0; sector < esp_flash_sim_size() / ESP_FLASH_SIM_SECTOR_SIZE ; sector ++ ){
+        if( esp_flash_sim_sector_erases( sector ) > wear )
+            wear = esp_flash_sim_sector_erases( sector );
+    }
+    printf( "%-12s %8u ops %8u updates %8u reads %8u aborted transactions\n", names[ mode ], operations, updates, reads, aborts );
+    printf( "             %10.0f ops/s host %10.1f ops/s flash time\n",
+            operations / ( elapsed > 0 ? elapsed : 1e-9 ), operations / ( stats->busy_us > 0 ? stats->busy_us / 1e6 : 1e-9 ) );
+    printf( "             %10.3f erases/update %8.1f bytes written/update %8.1f SPI bytes read/lookup\n",
+            updates ? ( double ) stats->erases / updates : 0.0, updates ? ( double ) stats->write_bytes / updates : 0.0,
+            reads ? ( double ) lookup_bytes / reads : 0.0 );
+    printf( "             %10u erases on the busiest sector %8u cache flushes\n", wear, esp_host_cache_flushes() - flushes );
+    printf( "             %10llu rejected calls %8llu set bits %8u errors\n",
+            ( unsigned long long ) stats->rejected, ( unsigned long long ) stats->set_bits, errors );
+    return errors;
+}
+
+#ifdef ESP_FLASH_LOG_STRUCTURED
+
+/**
+ * Store the model in the sorted layout of older firmware on erased flash, rewritten the given number of times so
+ * the newest sorted sector moves around the ring
+ */
+static void esp_flash_bench_sorted_store( uint8_t rewrites )
+{
+    uint32_t data[ ESP_FLASH_SECTOR_LENGTH ];
+    uint8_t id;
+
+    esp_flash_sim_erase_all();
+    memset( data, 0x00, sizeof( data ) );
+    data[ 0 ] = 0x00000001;
+    data[ 1 ] = ESP_FLASH_DEFAULT_CONFIG_FLAGS;
+    for( id = 1; id <= ESP_FLASH_BENCH_IDS ; id ++ ){
+        if( esp_flash_bench_model[ id ].size > 0 )
+            esp_flash_insert_parameter( data, id, esp_flash_bench_model[ id ].data, esp_flash_bench_model[ id ].size );
+    }
+    esp_flash_current_sector_address = ESP_FLASH_RING_START_ADDRESS;
+    esp_flash_backup_sector_address = esp_flash_ring_next( esp_flash_current_sector_address );
+    for( ; rewrites > 0 ; rewrites -- )
+        esp_flash_data_save( data );
+}
+
+/**
+ * Cut the power while the log takes over a sorted store, returns the number of boots which lost a parameter.
+ * Until the log is sealed the sorted sector still holds every value, after that the log does.
+ */
+static uint32_t esp_flash_bench_migrate_stress( uint32_t cuts )
+{
+    esp_flash_sim_stats_type* stats = esp_flash_sim_get_stats();
+    uint32_t i, failures = 0, budget;
+    uint64_t used;
+    uint8_t id;
+
+    for( i = 0; i < cuts ; i ++ ){
+        // a quarter of the parameters isn't stored
+        for( id = 1; id <= ESP_FLASH_BENCH_IDS ; id ++ ){
+            esp_flash_bench_value( &esp_flash_bench_model[ id ] );
+            if( esp_flash_sim_random() % 4 == 0 )
+                esp_flash_bench_model[ id ].size = 0;
+        }
+        // bytes the whole migration takes, then the cut lands inside them
+        esp_flash_bench_sorted_store( 1 + esp_flash_sim_random() % 2 );
+        used = stats->write_bytes + stats->erases * ESP_FLASH_SIM_SECTOR_SIZE;
+        esp_flash_setup();
+        budget = ( uint32_t ) ( stats->write_bytes + stats->erases * ESP_FLASH_SIM_SECTOR_SIZE - used );
+        esp_flash_bench_sorted_store( 1 + esp_flash_sim_random() % 2 );
+        esp_flash_sim_cut_random( budget );
+        esp_flash_setup();
+        esp_flash_sim_power_on();
+        esp_flash_setup();
+        for( id = 1; id <= ESP_FLASH_BENCH_IDS ; id ++ ){
+            if( ! esp_flash_bench_matches( id, &esp_flash_bench_model[ id ] ) ){
+                failures ++;
+                break;
+            }
+        }
+    }
+    esp_flash_bench_boot();
+    printf( "%-12s %8u power cuts %8u failures, recovery %.2f%%\n",
+            "migration", cuts, failures, cuts ? 100.0 * ( cuts - failures ) / cuts : 100.0 );
+    return failures;
+}
+
+#endif
+
+/**
+ * Cut the power during updates, returns the number of boots which found a half applied update or lost one which
+ * finished. Transactions go up to the queue size, so a batch cut short is followed by longer ones.
+ */
+static uint32_t esp_flash_bench_stress( uint32_t cuts )
+{
+    esp_flash_sim_stats_type* stats = esp_flash_sim_get_stats();
+    esp_flash_bench_value_type before[ ESP_FLASH_BENCH_IDS + 1 ];
+    uint8_t touched[ ESP_FLASH_BENCH_IDS + 1 ];
+    uint32_t done = 0, attempts = 0, failures = 0, applied = 0, lost = 0, budget = ESP_FLASH_SIM_SECTOR_SIZE;
+    uint64_t used;
+    uint32_t i, count;
+    uint8_t id, old_state, new_state, transaction;
+
+    while( done < cuts && attempts < cuts * 100 ){
+        attempts ++;
+        memcpy( before, esp_flash_bench_model, sizeof( before ) );
+        memset( touched, 0x00, sizeof( touched ) );
+        transaction = esp_flash_sim_random() % 2;
+        count = transaction ? 2 + esp_flash_sim_random() % ( ESP_FLASH_UPDATE_QUEUE_SIZE - 1 ) : 1;
+        id = 1 + esp_flash_sim_random() % ESP_FLASH_BENCH_IDS;
+        used = stats->write_bytes + stats->erases * ESP_FLASH_SIM_SECTOR_SIZE;
+        // every other update runs to the end, after the torn ones before it
+        if( esp_flash_sim_random() % 2 )
+            esp_flash_sim_cut_random( budget );
+        if( transaction )
+            esp_flash_transaction_begin();
+        for( i = 0; i < count ; i ++ ){
+            touched[ 1 + ( id + i ) % ESP_FLASH_BENCH_IDS ] = 0x01;
+            esp_flash_bench_update( 1 + ( id + i ) % ESP_FLASH_BENCH_IDS );
+        }
+        if( transaction )
+            esp_flash_transaction_commit();
+        if( esp_flash_sim_powered() ){
+            // finished before the cut, aim the next one inside the bytes an update takes
+            used = stats->write_bytes + stats->erases * ESP_FLASH_SIM_SECTOR_SIZE - used;
+            budget = ( budget * 3 + ( uint32_t ) used + 1 ) / 4 + 1;
+            esp_flash_sim_power_on();
+            // a finished update survives a reboot, also after torn records of an earlier one
+            esp_flash_setup();
+            for( i = 1; i <= ESP_FLASH_BENCH_IDS ; i ++ ){
+                if( ! esp_flash_bench_matches( i, &esp_flash_bench_model[ i ] ) ){
+                    lost ++;
+                    esp_flash_bench_boot();
+                    break;
+                }
+            }
+            continue;
+        }
+        done ++;
+        esp_flash_sim_power_on();
+        esp_flash_setup();
+        // all the touched parameters hold their old values, or all hold the new ones
+        old_state = new_state = 0x01;
+        for( i = 1; i <= ESP_FLASH_BENCH_IDS ; i ++ ){
+            if( ! touched[ i ] ){
+                if( ! esp_flash_bench_matches( i, &before[ i ] ) )
+                    old_state = new_state = 0x00;
+                continue;
+            }
+            if( ! esp_flash_bench_matches( i, &before[ i ] ) )
+                old_state = 0x00;
+            if( ! esp_flash_bench_matches( i, &esp_flash_bench_model[ i ] ) )
+                new_state = 0x00;
+        }
+        if( new_state )
+            applied ++;
+        if( ! old_state && ! new_state ){
+            failures ++;
+            esp_flash_bench_boot();
+        } else if( ! new_state ){
+            memcpy( esp_flash_bench_model, before, sizeof( before ) );
+        }
+    }
+    printf( "%-12s %8u power cuts %8u applied %8u rolled back, recovery %.2f%%, %u finished updates lost\n",
+            "power loss", done, applied, done - applied - failures, done ? 100.0 * ( done - failures ) / done : 100.0, lost );
+#ifdef ESP_FLASH_LOG_STRUCTURED
+    // the log also takes over the sorted store of older firmware
+    failures += esp_flash_bench_migrate_stress( cuts / 10 );
+#endif
+    return failures + lost;
+}
+
+/**
+ * Settings with every field at its default
+ */
+static void esp_flash_bench_settings_defaults( esp_flash_bench_settings_type* settings )
+{
+    memset( settings, 0x00, sizeof( esp_flash_bench_settings_type ) );
+    settings->interval = esp_flash_bench_default_interval;
+    settings->mode = esp_flash_bench_default_mode;
+    strcpy( settings->name, esp_flash_bench_default_name );
+}
+
+/**
+ * Load the schema, returns 1 when the defaults used and the loaded settings are the expected ones
+ */
+static uint8_t esp_flash_bench_schema_matches( uint8_t defaults, esp_flash_bench_settings_type* expected )
+{
+    esp_flash_bench_settings_type settings;
+    memset( &settings, 0xA5, sizeof( settings ) );
+    if( esp_flash_schema_load( esp_flash_bench_schema, ESP_FLASH_BENCH_SCHEMA_COUNT, ( uint8_t* ) &settings ) != defaults )
+        return 0x00;
+    return memcmp( &settings, expected, sizeof( settings ) ) == 0;
+}
+
+/**
+ * Load settings through a schema, with the parameters missing, stored, too long for their field, inside an open
+ * transaction and with the sector too full to take the defaults. Returns the number of loads which didn't give the expected settings.
+ */
+static uint32_t esp_flash_bench_schema_run( void )
+{
+    esp_flash_bench_settings_type expected;
+    uint8_t data[ 0x100 ], id, size, name[ 30 ];
+    uint32_t errors = 0;
+
+    // nothing stored, every field takes its default and the ones which aren't empty are saved
+    for( id = 0; id < ESP_FLASH_BENCH_SCHEMA_COUNT ; id ++ )
+        esp_flash_remove_parameter( ESP_FLASH_BENCH_SCHEMA_ID + id );
+    esp_flash_bench_settings_defaults( &expected );
+    if( ! esp_flash_bench_schema_matches( ESP_FLASH_BENCH_SCHEMA_COUNT, &expected ) )
+        errors ++;
+    if( esp_flash_read_parameter( ESP_FLASH_BENCH_SCHEMA_ID + 2, data ) != sizeof( esp_flash_bench_default_name ) - 1 )
+        errors ++;
+    // stored values win, a name which doesn't fit its field is replaced by the default and the empty label stays
+    // a default
+    expected.interval = 1000;
+    strcpy( expected.label, "lab" );
+    memset( name, 'n', sizeof( name ) );
+    esp_flash_save_parameter( ESP_FLASH_BENCH_SCHEMA_ID, ( uint8_t* ) &( expected.interval ), sizeof( uint32_t ) );
+    esp_flash_save_parameter( ESP_FLASH_BENCH_SCHEMA_ID + 2, name, sizeof( name ) );
+    esp_flash_save_parameter( ESP_FLASH_BENCH_SCHEMA_ID + 3, ( uint8_t* ) expected.label, 3 );
+    if( ! esp_flash_bench_schema_matches( 1, &expected ) )
+        errors ++;
+    // the defaults are stored now and survive a reboot
+    esp_flash_setup();
+    if( ! esp_flash_bench_schema_matches( 0, &expected ) )
+        errors ++;
+    // a load or a mode change inside an open transaction doesn't write it half built
+    esp_flash_transaction_begin();
+    esp_flash_save_parameter( ESP_FLASH_BENCH_SCHEMA_ID, ( uint8_t* ) &esp_flash_bench_default_interval, sizeof( uint32_t ) );
+    esp_flash_enable_instant_update();
+    if( ! esp_flash_bench_schema_matches( 0, &expected ) )
+        errors ++;
+    esp_flash_transaction_abort();
+    if( ! esp_flash_bench_schema_matches( 0, &expected ) )
+        errors ++;
+    // fill the sector until not even the smallest value fits, the defaults are then only loaded in RAM
+    for( id = 0; id < ESP_FLASH_BENCH_SCHEMA_COUNT ; id ++ )
+        esp_flash_remove_parameter( ESP_FLASH_BENCH_SCHEMA_ID + id );
+    memset( data, 0x5A, sizeof( data ) );
+    for( id = ESP_FLASH_BENCH_FILLER_ID, size = 0xFF; id != 0x00 && size > 0 ; ){
+        esp_flash_save_parameter( id, data, size );
+        if( esp_flash_read_parameter( id, data ) == size ) id ++;
+        else size >>= 1;
+    }
+    esp_flash_bench_settings_defaults( &expected );
+    if( ! esp_flash_bench_schema_matches( ESP_FLASH_BENCH_SCHEMA_COUNT, &expected ) )
+        errors ++;
+    // the values around it are untouched
+    for( id = 1; id <= ESP_FLASH_BENCH_IDS ; id ++ ){
+        if( ! esp_flash_bench_matches( id, &esp_flash_bench_model[ id ] ) )
+            errors ++;
+    }
+    for( id = ESP_FLASH_BENCH_FILLER_ID; id != 0x00 ; id ++ )
+        esp_flash_remove_parameter( id );
+    for( id = 0; id < ESP_FLASH_BENCH_SCHEMA_COUNT ; id ++ )
+        esp_flash_remove_parameter( ESP_FLASH_BENCH_SCHEMA_ID + id );
+    printf( "%-12s %8u errors\n", "schema", errors );
+    return errors;
+}
+
+/**
+ * Random blob content
+ */
+static void esp_flash_bench_blob_value( esp_flash_bench_blob_type* blob )
+{
+    uint32_t i;
+    blob->length = esp_flash_sim_random() % ( ESP_FLASH_BENCH_BLOB_MAX + 1 );
+    for( i = 0; i < blob->length ; i ++ )
+        blob->data[ i ] = ( uint8_t ) esp_flash_sim_random();
+    blob->stored = 0x01;
+}
+
+/**
+ * Stream a blob into flash in pieces of random size, returns 0 if it wasn't sealed
+ */
+static uint8_t esp_flash_bench_blob_write( uint16_t id, esp_flash_bench_blob_type* blob )
+{
+    esp_flash_blob_writer_type writer;
+    uint32_t offset, step;
+
+    if( ! esp_flash_blob_write_begin( &writer, id, blob->length ) )
+        return 0x00;
+    for( offset = 0; offset < blob->length ; offset += step ){
+        step = 1 + esp_flash_sim_random() % ESP_FLASH_BENCH_BLOB_STEP;
+        if( step > blob->length - offset ) step = blob->length - offset;
+        if( ! esp_flash_blob_write( &writer, blob->data + offset, ( uint16_t ) step ) )
+            return 0x00;
+    }
+    return esp_flash_blob_write_end( &writer );
+}
+
+/**
+ * Compare a blob in flash with the expected content, read in pieces of random size. Returns 1 when they match.
+ */
+static uint8_t esp_flash_bench_blob_matches( uint16_t id, esp_flash_bench_blob_type* blob )
+{
+    esp_flash_blob_reader_type reader;
+    uint8_t data[ ESP_FLASH_BENCH_BLOB_STEP ];
+    uint32_t offset;
+    uint16_t step;
+
+    if( ! esp_flash_blob_open( &reader, id ) )
+        return ! blob->stored;
+    if( ! blob->stored || reader.length != blob->length || ! esp_flash_blob_verify( &reader ) )
+        return 0x00;
+    for( offset = 0; offset < blob->length ; offset += step ){
+        step = esp_flash_blob_read( &reader, data, 1 + esp_flash_sim_random() % ESP_FLASH_BENCH_BLOB_STEP );
+        if( step == 0 || memcmp( data, blob->data + offset, step ) != 0 )
+            return 0x00;
+    }
+    return 0x01;
+}
+
+/**
+ * Boot, the blob cursor and sequence are found again by the next scan
+ */
+static void esp_flash_bench_blob_boot( void )
+{
+    uint16_t id;
+    esp_flash_blob_sequence = 0;
+    esp_flash_blob_cursor = 0;
+    for( id = 1; id <= ESP_FLASH_BENCH_BLOB_IDS ; id ++ ){
+        if( ! esp_flash_bench_blob_matches( id, &esp_flash_bench_blobs[ id ] ) )
+            esp_flash_bench_blobs[ id ].stored = 0x00;
+    }
+}
+
+/**
+ * Write, remove and read back blobs, returns the number of operations which failed or read the wrong content
+ */
+static uint32_t esp_flash_bench_blob_run( uint32_t operations )
+{
+    esp_flash_sim_stats_type* stats = esp_flash_sim_get_stats();
+    esp_flash_bench_blob_type* blob;
+    uint32_t i, writes = 0, reads = 0, removes = 0, refused = 0, errors = 0, wear = 0, covered = 0;
+    uint64_t written = 0, read = 0;
+    uint16_t id, sector;
+
+    esp_flash_sim_reset_stats();
+    for( i = 0; i < operations ; i ++ ){
+        id = 1 + esp_flash_sim_random() % ESP_FLASH_BENCH_BLOB_IDS;
+        blob = &esp_flash_bench_blobs[ id ];
+        if( esp_flash_sim_random() % 100 < esp_flash_bench_read_ratio ){
+            if( ! esp_flash_bench_blob_matches( id, blob ) )
+                errors ++;
+            read += blob->stored ? blob->length : 0;
+            reads ++;
+        } else if( esp_flash_sim_random() % 10 == 0 ){
+            esp_flash_blob_remove( id );
+            blob->stored = 0x00;
+            removes ++;
+        } else {
+            esp_flash_bench_blob_value( &esp_flash_bench_blobs[ 0 ] );
+            if( esp_flash_bench_blob_write( id, &esp_flash_bench_blobs[ 0 ] ) ){
+                memcpy( blob, &esp_flash_bench_blobs[ 0 ], sizeof( esp_flash_bench_blob_type ) );
+                written += blob->length;
+                writes ++;
+            } else {
+                // no free run of sectors for it, the old copy stays
+                refused ++;
+            }
+        }
+    }
+    // the blobs survive a reboot
+    for( id = 1; id <= ESP_FLASH_BENCH_BLOB_IDS ; id ++ ){
+        if( ! esp_flash_bench_blob_matches( id, &esp_flash_bench_blobs[ id ] ) )
+            errors ++;
+    }
+    for( sector = 0; sector < ESP_FLASH_BLOB_SECTORS ; sector ++ ){
+        i = esp_flash_sim_sector_erases( ESP_FLASH_BLOB_START_ADDRESS / ESP_FLASH_SIM_SECTOR_SIZE + sector );
+        if( i > wear )
+            wear = i;
+        if( i > 0 )
+            covered ++;
+    }
+    printf( "%-12s %8u ops %8u writes %8u removes %8u reads %8u refused\n", "blob", operations, writes, removes, reads, refused );
+    printf( "             %10.3f erases/write %8.3f bytes written/byte %8.3f SPI bytes read/byte\n",
+            writes ? ( double ) stats->erases / writes : 0.0, written ? ( double ) stats->write_bytes / written : 0.0,
+            read ? ( double ) stats->read_bytes / read : 0.0 );
+    printf( "             %10u erases on the busiest sector %8u of %u sectors used\n", wear, covered, ESP_FLASH_BLOB_SECTORS );
+    printf( "             %10llu rejected calls %8llu set bits %8u errors\n",
+            ( unsigned long long ) stats->rejected, ( unsigned long long ) stats->set_bits, errors );
+    return errors;
+}
+
+/**
+ * Cut the power while blobs are written or removed, returns the number of boots which read a blob that was
+ * neither its old nor its new content, or lost one which finished
+ */
+static uint32_t esp_flash_bench_blob_stress( uint32_t cuts )
+{
+    static esp_flash_bench_blob_type before;
+    uint32_t done = 0, attempts = 0, failures = 0, applied = 0, lost = 0, refused = 0, budget, cut;
+    uint16_t id, other;
+    uint8_t old_state, new_state;
+
+    while( done < cuts && attempts < cuts * 100 ){
+        attempts ++;
+        id = 1 + esp_flash_sim_random() % ESP_FLASH_BENCH_BLOB_IDS;
+        memcpy( &before, &esp_flash_bench_blobs[ id ], sizeof( before ) );
+        if( esp_flash_sim_random() % 10 == 0 ){
+            esp_flash_bench_blobs[ id ].stored = 0x00;
+            budget = 2 * sizeof( uint32_t );
+        } else {
+            esp_flash_bench_blob_value( &esp_flash_bench_blobs[ id ] );
+            // the erases, the data and the header up to the magic
+            budget = esp_flash_blob_sectors( esp_flash_bench_blobs[ id ].length ) * ESP_FLASH_BLOB_SECTOR_SIZE +
+                     ( ( esp_flash_bench_blobs[ id ].length + 0x03 ) & ( ~0x03 ) ) + 5 * sizeof( uint32_t );
+        }
+        // a third of the changes run to the end, a third are cut around the seal and the retire of the old copy
+        cut = esp_flash_sim_random() % 3;
+        if( cut == 1 )
+            esp_flash_sim_cut_random( budget );
+        else if( cut == 2 )
+            esp_flash_sim_cut_after( budget - ( budget > 32 ? 32 : budget ) + esp_flash_sim_random() % 48 );
+        if( ! esp_flash_bench_blobs[ id ].stored )
+            esp_flash_blob_remove( id );
+        else if( ! esp_flash_bench_blob_write( id, &esp_flash_bench_blobs[ id ] ) && esp_flash_sim_powered() ){
+            // no free run of sectors for it, the old copy stays
+            memcpy( &esp_flash_bench_blobs[ id ], &before, sizeof( before ) );
+            esp_flash_sim_power_on();
+            refused ++;
+            continue;
+        }
+        if( esp_flash_sim_powered() ){
+            esp_flash_sim_power_on();
+            // a finished change survives a reboot
+            esp_flash_bench_blob_boot();
+            for( other = 1; other <= ESP_FLASH_BENCH_BLOB_IDS ; other ++ ){
+                if( ! esp_flash_bench_blob_matches( other, &esp_flash_bench_blobs[ other ] ) )
+                    lost ++;
+            }
+            continue;
+        }
+        done ++;
+        esp_flash_sim_power_on();
+        esp_flash_blob_sequence = 0;
+        esp_flash_blob_cursor = 0;
+        // the blob reads back whole, old or new, and the others are untouched
+        old_state = esp_flash_bench_blob_matches( id, &before );
+        new_state = esp_flash_bench_blob_matches( id, &esp_flash_bench_blobs[ id ] );
+        for( other = 1; other <= ESP_FLASH_BENCH_BLOB_IDS ; other ++ ){
+            if( other != id && ! esp_flash_bench_blob_matches( other, &esp_flash_bench_blobs[ other ] ) )
+                old_state = new_state = 0x00;
+        }
+        if( new_state )
+            applied ++;
+        if( ! old_state && ! new_state ){
+            failures ++;
+            esp_flash_bench_blob_boot();
+        } else if( ! new_state ){
+            memcpy( &esp_flash_bench_blobs[ id ], &before, sizeof( before ) );
+        }
+    }
+    printf( "%-12s %8u power cuts %8u applied %8u rolled back, recovery %.2f%%, %u finished changes lost, %u refused\n",
+            "blob loss", done, applied, done - applied - failures, done ? 100.0 * ( done - failures ) / done : 100.0, lost, refused );
+    return failures + lost;
+}
+
+/**
+ * Command line
+ */
+static void esp_flash_bench_usage( const char* name )
+{
+    printf( "usage: %s [-f flash file] [-n operations] [-c power cuts] [-w read percent] [-s seed] [-k] [-r]\n"
+            "  -k  keep the flash file contents\n"
+            "  -r  sleep for the flash latencies\n", name );
+}
+
+int main( int argc, char** argv )
+{
+    esp_flash_sim_latency_type latency = { ESP_FLASH_SIM_READ_BYTE_NS, ESP_FLASH_SIM_WRITE_PAGE_US, ESP_FLASH_SIM_ERASE_SECTOR_US, 0x00 };
+    const char* path = "esp_flash_sim.bin";
+    uint32_t operations = 20000, cuts = 2000, seed = 1;
+    uint32_t errors = 0;
+    uint8_t keep = 0x00;
+    int option;
+
+    while( ( option = getopt( argc, argv, "f:n:c:w:s:krh" ) ) != -1 ){
+        switch( option ){
+            case 'f': path = optarg; break;
+            case 'n': operations = strtoul( optarg, NULL, 0 ); break;
+            case 'c': cuts = strtoul( optarg, NULL, 0 ); break;
+            case 'w': esp_flash_bench_read_ratio = strtoul( optarg, NULL, 0 ); break;
+            case 's': seed = strtoul( optarg, NULL, 0 ); break;
+            case 'k': keep = 0x01; break;
+            case 'r': latency.realtime = 0x01; break;
+            default: esp_flash_bench_usage( argv[ 0 ] ); return 2;
+        }
+    }
+    if( ! esp_flash_sim_open( path, ESP_FLASH_SIM_DEFAULT_SIZE ) ){
+        fprintf( stderr, "can't map %s\n", path );
+        return 1;
+    }
+    if( ! keep )
+        esp_flash_sim_erase_all();
+    esp_flash_sim_seed( seed );
+    esp_flash_sim_set_latency( &latency );
+#ifdef ESP_FLASH_LOG_STRUCTURED
+    printf( "log layout, %u ring sectors\n", ESP_FLASH_RING_SECTORS );
+#else
+    printf( "sorted layout, %u ring sectors\n", ESP_FLASH_RING_SECTORS );
+#endif
+    esp_flash_bench_boot();
+    errors += esp_flash_bench_run( ESP_FLASH_BENCH_INSTANT, operations );
+    errors += esp_flash_bench_run( ESP_FLASH_BENCH_QUEUED, operations );
+    errors += esp_flash_bench_run( ESP_FLASH_BENCH_BATCHED, operations );
+    errors += esp_flash_bench_run( ESP_FLASH_BENCH_TRANSACTION, operations );
+    if( cuts > 0 )
+        errors += esp_flash_bench_stress( cuts );
+    errors += esp_flash_bench_schema_run();
+    // blobs are written whole sectors at a time, a tenth of the operations
+    esp_flash_bench_blob_boot();
+    errors += esp_flash_bench_blob_run( operations / 10 );
+    if( cuts > 0 )
+        errors += esp_flash_bench_blob_stress( cuts / 2 );
+    esp_flash_sim_close();
+    return errors ? 1 : 0;
+}
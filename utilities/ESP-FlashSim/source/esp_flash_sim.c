@@ -0,0 +1,302 @@
+/**
+ * \brief		SPI flash simulator for host builds
+ * \file		esp_flash_sim.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "esp_flash_sim.h"
+#include "esp_host_sdk.h"
+
+/**
+ * Mapped flash and its per sector counters
+ */
+static uint8_t* esp_flash_sim_data = NULL;
+static uint32_t esp_flash_sim_data_size = 0;
+static int esp_flash_sim_file = -1;
+static uint32_t* esp_flash_sim_erase_count = NULL;
+static uint32_t* esp_flash_sim_write_count = NULL;
+
+static esp_flash_sim_latency_type esp_flash_sim_latency = {
+    ESP_FLASH_SIM_READ_BYTE_NS, ESP_FLASH_SIM_WRITE_PAGE_US, ESP_FLASH_SIM_ERASE_SECTOR_US, 0x00
+};
+static esp_flash_sim_stats_type esp_flash_sim_stats;
+
+/**
+ * Bytes left until the power is cut, negative when no cut is set
+ */
+static int64_t esp_flash_sim_budget = -1;
+static uint8_t esp_flash_sim_power = 0x01;
+static uint32_t esp_flash_sim_state = 0x2545F491;
+
+
+/**
+ * Map the flash file, created or grown to size with erased bytes. A NULL path maps anonymous memory.
+ */
+uint8_t esp_flash_sim_open( const char* path, uint32_t size )
+{
+    struct stat info;
+    uint32_t used = 0;
+    int flags = MAP_SHARED;
+
+    esp_flash_sim_close();
+    if( size == 0 || ( size % ESP_FLASH_SIM_SECTOR_SIZE ) != 0 )
+        return 0x00;
+    if( path != NULL ){
+        esp_flash_sim_file = open( path, O_RDWR | O_CREAT, 0644 );
+        if( esp_flash_sim_file < 0 )
+            return 0x00;
+        if( fstat( esp_flash_sim_file, &info ) != 0 || ( info.st_size < size && ftruncate( esp_flash_sim_file, size ) != 0 ) ){
+            esp_flash_sim_close();
+            return 0x00;
+        }
+        used = ( info.st_size < size ) ? ( uint32_t ) info.st_size : size;
+    } else {
+        flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    }
+    esp_flash_sim_data = ( uint8_t* ) mmap( NULL, size, PROT_READ | PROT_WRITE, flags, esp_flash_sim_file, 0 );
+    if( esp_flash_sim_data == MAP_FAILED ){
+        esp_flash_sim_data = NULL;
+        esp_flash_sim_close();
+        return 0x00;
+    }
+    esp_flash_sim_data_size = size;
+    // new flash reads erased
+    memset( esp_flash_sim_data + used, 0xFF, size - used );
+    esp_flash_sim_erase_count = ( uint32_t* ) calloc( size / ESP_FLASH_SIM_SECTOR_SIZE, sizeof( uint32_t ) );
+    esp_flash_sim_write_count = ( uint32_t* ) calloc( size / ESP_FLASH_SIM_SECTOR_SIZE, sizeof( uint32_t ) );
+    if( esp_flash_sim_erase_count == NULL || esp_flash_sim_write_count == NULL ){
+        esp_flash_sim_close();
+        return 0x00;
+    }
+    esp_flash_sim_power_on();
+    esp_flash_sim_reset_stats();
+    return 0x01;
+}
+
+/**
+ * Unmap the flash, the file keeps its contents
+ */
+void esp_flash_sim_close( void )
+{
+    if( esp_flash_sim_data != NULL ){
+        msync( esp_flash_sim_data, esp_flash_sim_data_size, MS_SYNC );
+        munmap( esp_flash_sim_data, esp_flash_sim_data_size );
+    }
+    if( esp_flash_sim_file >= 0 )
+        close( esp_flash_sim_file );
+    free( esp_flash_sim_erase_count );
+    free( esp_flash_sim_write_count );
+    esp_flash_sim_data = NULL;
+    esp_flash_sim_data_size = 0;
+    esp_flash_sim_file = -1;
+    esp_flash_sim_erase_count = NULL;
+    esp_flash_sim_write_count = NULL;
+}
+
+/**
+ * Erase the whole chip, not counted
+ */
+void esp_flash_sim_erase_all( void )
+{
+    if( esp_flash_sim_data != NULL )
+        memset( esp_flash_sim_data, 0xFF, esp_flash_sim_data_size );
+}
+
+/**
+ * Mapped flash contents
+ */
+uint8_t* esp_flash_sim_memory( void )
+{
+    return esp_flash_sim_data;
+}
+
+uint32_t esp_flash_sim_size( void )
+{
+    return esp_flash_sim_data_size;
+}
+
+/**
+ * Random numbers for the power cuts and the workloads, xorshift so a seed replays the same run
+ */
+void esp_flash_sim_seed( uint32_t seed )
+{
+    esp_flash_sim_state = ( seed != 0 ) ? seed : 0x2545F491;
+}
+
+uint32_t esp_flash_sim_random( void )
+{
+    esp_flash_sim_state ^= esp_flash_sim_state << 13;
+    esp_flash_sim_state ^= esp_flash_sim_state >> 17;
+    esp_flash_sim_state ^= esp_flash_sim_state << 5;
+    return esp_flash_sim_state;
+}
+
+void esp_flash_sim_set_latency( const esp_flash_sim_latency_type* latency )
+{
+    esp_flash_sim_latency = *latency;
+}
+
+/**
+ * Cut the power once the given number of bytes were written, an erase counts as a whole sector. -1 disables it.
+ */
+void esp_flash_sim_cut_after( int64_t bytes )
+{
+    esp_flash_sim_budget = bytes;
+}
+
+/**
+ * Cut the power at a random byte of the next bytes written
+ */
+void esp_flash_sim_cut_random( uint32_t bytes )
+{
+    esp_flash_sim_budget = ( bytes > 0 ) ? esp_flash_sim_random() % bytes : 0;
+}
+
+uint8_t esp_flash_sim_powered( void )
+{
+    return esp_flash_sim_power;
+}
+
+/**
+ * Power on again, with no cut set
+ */
+void esp_flash_sim_power_on( void )
+{
+    esp_flash_sim_power = 0x01;
+    esp_flash_sim_budget = -1;
+}
+
+esp_flash_sim_stats_type* esp_flash_sim_get_stats( void )
+{
+    return &esp_flash_sim_stats;
+}
+
+void esp_flash_sim_reset_stats( void )
+{
+    memset( &esp_flash_sim_stats, 0x00, sizeof( esp_flash_sim_stats ) );
+    if( esp_flash_sim_erase_count != NULL ){
+        memset( esp_flash_sim_erase_count, 0x00, esp_flash_sim_data_size / ESP_FLASH_SIM_SECTOR_SIZE * sizeof( uint32_t ) );
+        memset( esp_flash_sim_write_count, 0x00, esp_flash_sim_data_size / ESP_FLASH_SIM_SECTOR_SIZE * sizeof( uint32_t ) );
+    }
+}
+
+uint32_t esp_flash_sim_sector_erases( uint16_t sector )
+{
+    if( ( uint32_t ) sector * ESP_FLASH_SIM_SECTOR_SIZE >= esp_flash_sim_data_size )
+        return 0;
+    return esp_flash_sim_erase_count[ sector ];
+}
+
+uint32_t esp_flash_sim_sector_writes( uint16_t sector )
+{
+    if( ( uint32_t ) sector * ESP_FLASH_SIM_SECTOR_SIZE >= esp_flash_sim_data_size )
+        return 0;
+    return esp_flash_sim_write_count[ sector ];
+}
+
+/**
+ * Account the time an operation keeps the flash busy
+ */
+static void esp_flash_sim_busy( uint64_t nanoseconds )
+{
+    struct timespec delay;
+    esp_flash_sim_stats.busy_us += nanoseconds / 1000;
+    esp_host_advance_time( ( uint32_t ) ( nanoseconds / 1000 ) );
+    if( esp_flash_sim_latency.realtime && nanoseconds > 0 ){
+        delay.tv_sec = nanoseconds / 1000000000ULL;
+        delay.tv_nsec = nanoseconds % 1000000000ULL;
+        nanosleep( &delay, NULL );
+    }
+}
+
+/**
+ * Check an access like the SDK does, 4 byte aligned and inside the chip
+ */
+static uint8_t esp_flash_sim_check( uint32_t address, const void* buffer, uint32_t size )
+{
+    if( esp_flash_sim_data == NULL || ( address & 0x03 ) || ( size & 0x03 ) || ( ( uintptr_t ) buffer & 0x03 ) ||
+        address > esp_flash_sim_data_size || size > esp_flash_sim_data_size - address ){
+        esp_flash_sim_stats.rejected ++;
+        return 0x00;
+    }
+    return 0x01;
+}
+
+SpiFlashOpResult spi_flash_read( uint32 source, uint32* destination, uint32 size )
+{
+    if( ! esp_flash_sim_check( source, destination, size ) )
+        return SPI_FLASH_RESULT_ERR;
+    memcpy( destination, esp_flash_sim_data + source, size );
+    esp_flash_sim_stats.reads ++;
+    esp_flash_sim_stats.read_bytes += size;
+    esp_flash_sim_busy( ( uint64_t ) size * esp_flash_sim_latency.read_byte_ns );
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_write( uint32 destination, uint32* source, uint32 size )
+{
+    uint8_t* data = ( uint8_t* ) source;
+    uint32_t i, pages;
+
+    if( ! esp_flash_sim_check( destination, source, size ) )
+        return SPI_FLASH_RESULT_ERR;
+    // the chip is off, nothing happens
+    if( ! esp_flash_sim_power )
+        return SPI_FLASH_RESULT_OK;
+    esp_flash_sim_stats.writes ++;
+    esp_flash_sim_write_count[ destination / ESP_FLASH_SIM_SECTOR_SIZE ] ++;
+    for( i = 0; i < size ; i ++ ){
+        if( ( data[ i ] & ~esp_flash_sim_data[ destination + i ] ) != 0 )
+            esp_flash_sim_stats.set_bits ++;
+        if( esp_flash_sim_budget == 0 ){
+            // torn byte, part of the bits got programmed
+            esp_flash_sim_data[ destination + i ] &= data[ i ] | ( uint8_t ) esp_flash_sim_random();
+            esp_flash_sim_power = 0x00;
+            esp_flash_sim_stats.power_cuts ++;
+            break;
+        }
+        if( esp_flash_sim_budget > 0 )
+            esp_flash_sim_budget --;
+        // NOR programming only clears bits
+        esp_flash_sim_data[ destination + i ] &= data[ i ];
+    }
+    esp_flash_sim_stats.write_bytes += i;
+    pages = ( i > 0 ) ? ( ( destination + i - 1 ) / ESP_FLASH_SIM_PAGE_SIZE ) - ( destination / ESP_FLASH_SIM_PAGE_SIZE ) + 1 : 0;
+    esp_flash_sim_busy( ( uint64_t ) pages * esp_flash_sim_latency.write_page_us * 1000 );
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_erase_sector( uint16 sector )
+{
+    uint32_t address = ( uint32_t ) sector * ESP_FLASH_SIM_SECTOR_SIZE;
+
+    if( ! esp_flash_sim_check( address, NULL, ESP_FLASH_SIM_SECTOR_SIZE ) )
+        return SPI_FLASH_RESULT_ERR;
+    if( ! esp_flash_sim_power )
+        return SPI_FLASH_RESULT_OK;
+    if( esp_flash_sim_budget >= 0 && esp_flash_sim_budget < ESP_FLASH_SIM_SECTOR_SIZE ){
+        // interrupted erase, only the start of the sector got erased
+        memset( esp_flash_sim_data + address, 0xFF, ( size_t ) esp_flash_sim_budget );
+        esp_flash_sim_budget = 0;
+        esp_flash_sim_power = 0x00;
+        esp_flash_sim_stats.power_cuts ++;
+        return SPI_FLASH_RESULT_OK;
+    }
+    if( esp_flash_sim_budget > 0 )
+        esp_flash_sim_budget -= ESP_FLASH_SIM_SECTOR_SIZE;
+    memset( esp_flash_sim_data + address, 0xFF, ESP_FLASH_SIM_SECTOR_SIZE );
+    esp_flash_sim_stats.erases ++;
+    esp_flash_sim_erase_count[ sector ] ++;
+    esp_flash_sim_busy( ( uint64_t ) esp_flash_sim_latency.erase_sector_us * 1000 );
+    return SPI_FLASH_RESULT_OK;
+}
@@ -0,0 +1,86 @@
+/**
+ * \brief		SPI flash simulator for host builds
+ * \file		esp_flash_sim.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Implements spi_flash_read, spi_flash_write and spi_flash_erase_sector over a file mapped into memory, so the
+ * flash libraries of the firmware run unchanged on Linux. Writes behave like NOR flash, they can only clear bits
+ * and setting one back needs a sector erase. Erases and writes are counted per sector and every operation adds
+ * its latency to the simulated flash time.
+ *
+ * Power can be cut after a number of bytes, or at a random byte of the next operations. The byte being written
+ * when it happens keeps a random part of its cleared bits, an erase stops part way through the sector, and every
+ * later operation is dropped until esp_flash_sim_power_on.
+ */
+#ifndef __ESP_FLASH_SIM_H__
+#define __ESP_FLASH_SIM_H__
+
+#include "c_types.h"
+#include "spi_flash.h"
+
+#define ESP_FLASH_SIM_SECTOR_SIZE 0x1000
+#define ESP_FLASH_SIM_PAGE_SIZE 0x100
+#define ESP_FLASH_SIM_DEFAULT_SIZE 0x00400000
+
+/**
+ * The flash libraries read the mapped flash from the simulator memory, like from the cache window on the chip
+ */
+#define ESP_FLASH_MMAP_BASE ( ( uintptr_t ) esp_flash_sim_memory() )
+
+/**
+ * Default latencies, typical for a 4 MB SPI NOR flash on the ESP8266
+ */
+#define ESP_FLASH_SIM_READ_BYTE_NS 50
+#define ESP_FLASH_SIM_WRITE_PAGE_US 700
+#define ESP_FLASH_SIM_ERASE_SECTOR_US 45000
+
+/**
+ * Operation latencies, realtime also sleeps for them
+ */
+typedef struct esp_flash_sim_latency {
+    uint32_t read_byte_ns;
+    uint32_t write_page_us;
+    uint32_t erase_sector_us;
+    uint8_t realtime;
+} esp_flash_sim_latency_type;
+
+/**
+ * Counters since the last reset, rejected counts unaligned or out of range calls and set_bits the writes which
+ * tried to set a cleared bit
+ */
+typedef struct esp_flash_sim_stats {
+    uint64_t reads;
+    uint64_t read_bytes;
+    uint64_t writes;
+    uint64_t write_bytes;
+    uint64_t erases;
+    uint64_t rejected;
+    uint64_t set_bits;
+    uint64_t power_cuts;
+    uint64_t busy_us;
+} esp_flash_sim_stats_type;
+
+uint8_t esp_flash_sim_open( const char* path, uint32_t size );
+void esp_flash_sim_close( void );
+void esp_flash_sim_erase_all( void );
+uint8_t* esp_flash_sim_memory( void );
+uint32_t esp_flash_sim_size( void );
+
+void esp_flash_sim_seed( uint32_t seed );
+uint32_t esp_flash_sim_random( void );
+void esp_flash_sim_set_latency( const esp_flash_sim_latency_type* latency );
+
+void esp_flash_sim_cut_after( int64_t bytes );
+void esp_flash_sim_cut_random( uint32_t bytes );
+uint8_t esp_flash_sim_powered( void );
+void esp_flash_sim_power_on( void );
+
+esp_flash_sim_stats_type* esp_flash_sim_get_stats( void );
+void esp_flash_sim_reset_stats( void );
+uint32_t esp_flash_sim_sector_erases( uint16_t sector );
+uint32_t esp_flash_sim_sector_writes( uint16_t sector );
+
+#endif
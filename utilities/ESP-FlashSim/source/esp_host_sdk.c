@@ -0,0 +1,178 @@
+/**
+ * \brief		SDK services for host builds
+ * \file		esp_host_sdk.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ */
+#include <stdlib.h>
+
+#include "esp_host_sdk.h"
+#include "user_interface.h"
+#include "upgrade.h"
+
+/**
+ * Simulated clock in microseconds and the armed timers
+ */
+static uint64_t esp_host_time = 0;
+static os_timer_t* esp_host_timers = NULL;
+static uint32_t esp_host_cache_flush_count = 0;
+
+/**
+ * Running image and the upgrade flag, which only survives a restart through system_upgrade_reboot
+ */
+static uint8_t esp_host_userbin = UPGRADE_FW_BIN1;
+static uint8_t esp_host_upgrade_flag = UPGRADE_FLAG_IDLE;
+
+
+/**
+ * Unlink an armed timer
+ */
+static void esp_host_timer_unlink( os_timer_t* timer )
+{
+    os_timer_t** link = &esp_host_timers;
+    while( *link != NULL ){
+        if( *link == timer ){
+            *link = timer->timer_next;
+            break;
+        }
+        link = &( ( *link )->timer_next );
+    }
+    timer->timer_next = NULL;
+    timer->timer_armed = 0x00;
+}
+
+void os_timer_setfn( os_timer_t* timer, os_timer_func_t* function, void* arg )
+{
+    timer->timer_func = function;
+    timer->timer_arg = arg;
+}
+
+void os_timer_arm( os_timer_t* timer, uint32_t milliseconds, bool repeat )
+{
+    // arming again restarts the timer
+    if( timer->timer_armed )
+        esp_host_timer_unlink( timer );
+    timer->timer_expire = ( uint32_t ) ( esp_host_time / 1000 ) + milliseconds;
+    timer->timer_period = repeat ? milliseconds : 0;
+    timer->timer_armed = 0x01;
+    timer->timer_next = esp_host_timers;
+    esp_host_timers = timer;
+}
+
+void os_timer_disarm( os_timer_t* timer )
+{
+    if( timer->timer_armed )
+        esp_host_timer_unlink( timer );
+}
+
+uint32 system_get_time( void )
+{
+    return ( uint32 ) esp_host_time;
+}
+
+void system_restart( void )
+{
+    exit( 0 );
+}
+
+void esp_host_advance_time( uint32_t microseconds )
+{
+    esp_host_time += microseconds;
+}
+
+/**
+ * Move the clock forward and run the timers which expired, returns how many ran
+ */
+uint8_t esp_host_run_timers( uint32_t milliseconds )
+{
+    os_timer_t* timer;
+    uint32_t now;
+    uint8_t count = 0;
+
+    esp_host_time += ( uint64_t ) milliseconds * 1000;
+    now = ( uint32_t ) ( esp_host_time / 1000 );
+    do {
+        // a callback may arm or disarm timers, look for the next one from the start
+        for( timer = esp_host_timers; timer != NULL && ( int32_t ) ( now - timer->timer_expire ) < 0 ; timer = timer->timer_next );
+        if( timer != NULL ){
+            esp_host_timer_unlink( timer );
+            if( timer->timer_period > 0 )
+                os_timer_arm( timer, timer->timer_period, true );
+            timer->timer_func( timer->timer_arg );
+            count ++;
+        }
+    } while( timer != NULL && count < 0xFF );
+    return count;
+}
+
+/**
+ * Number of armed timers
+ */
+uint8_t esp_host_pending_timers( void )
+{
+    os_timer_t* timer;
+    uint8_t count = 0;
+    for( timer = esp_host_timers; timer != NULL ; timer = timer->timer_next )
+        count ++;
+    return count;
+}
+
+/**
+ * The simulator memory is always current, only count how often the cache would be dropped
+ */
+void Cache_Read_Disable_2( void )
+{
+}
+
+void Cache_Read_Enable_2( void )
+{
+    esp_host_cache_flush_count ++;
+}
+
+uint32_t esp_host_cache_flushes( void )
+{
+    return esp_host_cache_flush_count;
+}
+
+uint8 system_upgrade_userbin_check( void )
+{
+    return esp_host_userbin;
+}
+
+void system_upgrade_flag_set( uint8 flag )
+{
+    esp_host_upgrade_flag = flag;
+}
+
+uint8 system_upgrade_flag_check( void )
+{
+    return esp_host_upgrade_flag;
+}
+
+/**
+ * The boot loader starts the other image when the upgrade finished
+ */
+void system_upgrade_reboot( void )
+{
+    if( esp_host_upgrade_flag == UPGRADE_FLAG_FINISH )
+        esp_host_userbin = ( esp_host_userbin == UPGRADE_FW_BIN1 ) ? UPGRADE_FW_BIN2 : UPGRADE_FW_BIN1;
+    esp_host_upgrade_flag = UPGRADE_FLAG_IDLE;
+}
+
+/**
+ * The power went off, RAM state is lost and the same image boots again
+ */
+void esp_host_power_loss( void )
+{
+    esp_host_upgrade_flag = UPGRADE_FLAG_IDLE;
+}
+
+/**
+ * Image the device runs, UPGRADE_FW_BIN1 or UPGRADE_FW_BIN2
+ */
+uint8_t esp_host_running_userbin( void )
+{
+    return esp_host_userbin;
+}
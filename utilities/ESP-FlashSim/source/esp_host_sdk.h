@@ -0,0 +1,29 @@
+/**
+ * \brief		SDK services for host builds
+ * \file		esp_host_sdk.h
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Software timers, the system clock, the cache control and the firmware upgrade flag of the SDK stand-ins. Time is simulated, it only
+ * moves forward when the host program runs the timers or the flash simulator spends time on an operation, so runs
+ * can be replayed.
+ */
+#ifndef __ESP_HOST_SDK_H__
+#define __ESP_HOST_SDK_H__
+
+#include "c_types.h"
+#include "osapi.h"
+
+void esp_host_advance_time( uint32_t microseconds );
+uint8_t esp_host_run_timers( uint32_t milliseconds );
+uint8_t esp_host_pending_timers( void );
+uint32_t esp_host_cache_flushes( void );
+void esp_host_power_loss( void );
+uint8_t esp_host_running_userbin( void );
+
+void Cache_Read_Disable_2( void );
+void Cache_Read_Enable_2( void );
+
+#endif
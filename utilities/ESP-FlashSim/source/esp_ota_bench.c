@@ -0,0 +1,270 @@
+/**
+ * \brief		Firmware update benchmark and power loss stress test
+ * \file		esp_ota_bench.c
+ * \author		Cristian Dobre
+ * \version 	1.0.0
+ * \date 		October 2026
+ * \copyright 	Revised BSD License.
+ *
+ * Runs esp_ota_update.c on the flash simulator. Each upload goes through the HTTP request parser and is fed in TCP
+ * segments arriving at the link rate, raw or as a multipart/form-data body, with the timers run after each segment
+ * like the SDK does once the receive callback returns. The benchmark reports the update throughput in flash time
+ * and how often the writer had to wait for an erase.
+ *
+ * The stress test cuts the power at a random byte of an upload, then checks the running image was never touched,
+ * that no image was marked for boot unless it landed whole, and that the next upload of the same image verifies.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "esp_flash_sim.h"
+#include "esp_host_sdk.h"
+#include "esp_ota_update.h"
+#include "esp_crc32.h"
+#include "upgrade.h"
+
+/**
+ * TCP payload of one segment and the multipart boundary of the uploads
+ */
+#define ESP_OTA_BENCH_SEGMENT_SIZE 1460
+#define ESP_OTA_BENCH_BOUNDARY "esp-ota-bench"
+
+/**
+ * Link rate in kbit/s, a multipart body every other upload when set
+ */
+static uint32_t esp_ota_bench_link_rate = 1600;
+static uint8_t esp_ota_bench_multipart = 0x00;
+
+/**
+ * Images, the one running and the one being uploaded
+ */
+static uint8_t* esp_ota_bench_running;
+static uint8_t* esp_ota_bench_image;
+static esp_ota_update_type esp_ota_bench_update;
+
+
+/**
+ * Random image, starting with the image header magic
+ */
+static void esp_ota_bench_fill( uint8_t* image, uint32_t size )
+{
+    uint32_t i;
+    for( i = 0; i < size ; i ++ )
+        image[ i ] = ( uint8_t ) esp_flash_sim_random();
+    image[ 0 ] = 0xE9;
+}
+
+/**
+ * Returns 1 when the partition holds the image
+ */
+static uint8_t esp_ota_bench_matches( uint32_t address, uint8_t* image, uint32_t size )
+{
+    return memcmp( esp_flash_sim_memory() + address, image, size ) == 0;
+}
+
+/**
+ * Feed one segment of the body, then let the timers run like after the receive callback
+ */
+static uint8_t esp_ota_bench_segment( uint8_t* data, uint32_t length, uint64_t* arrival )
+{
+    uint32_t now = system_get_time();
+    uint8_t result;
+    // the segment arrives at the link rate, unless the flash kept the CPU busy past it
+    *arrival += ( uint64_t ) length * 8 * 1000 / esp_ota_bench_link_rate;
+    if( ( int32_t ) ( ( uint32_t ) *arrival - now ) > 0 )
+        esp_host_advance_time( ( uint32_t ) *arrival - now );
+    result = esp_ota_http_receive( &esp_ota_bench_update, data, length );
+    esp_host_run_timers( 0 );
+    return result;
+}
+
+/**
+ * Feed data split into TCP segments, returns 0 once the update failed or the power went off
+ */
+static uint8_t esp_ota_bench_feed( uint8_t* data, uint32_t length, uint64_t* arrival )
+{
+    uint32_t size;
+    while( length > 0 ){
+        size = ( length > ESP_OTA_BENCH_SEGMENT_SIZE ) ? ESP_OTA_BENCH_SEGMENT_SIZE : length;
+        if( ! esp_ota_bench_segment( data, size, arrival ) || ! esp_flash_sim_powered() )
+            return 0x00;
+        data += size;
+        length -= size;
+    }
+    return 0x01;
+}
+
+/**
+ * Upload an image through the HTTP request path, returns 1 if it verified and was marked for boot
+ */
+static uint8_t esp_ota_bench_upload( uint8_t* image, uint32_t size, uint8_t multipart )
+{
+    char head[ 256 ], part[ 160 ], tail[ 32 ];
+    http_request_object_type request;
+    uint64_t arrival = system_get_time();
+    uint32_t part_length = 0, tail_length = 0;
+    uint8_t result;
+
+    if( multipart ){
+        part_length = sprintf( part, "--" ESP_OTA_BENCH_BOUNDARY "\r\nContent-Disposition: form-data; name=\"image\"; filename=\"user.bin\"\r\n"
+                               "Content-Type: application/octet-stream\r\n\r\n" );
+        tail_length = sprintf( tail, "\r\n--" ESP_OTA_BENCH_BOUNDARY "--\r\n" );
+        sprintf( head, "POST " ESP_OTA_HTTP_PATH "?crc=%08x HTTP/1.1\r\nHost: esp\r\n"
+                 "Content-Type: multipart/form-data; boundary=" ESP_OTA_BENCH_BOUNDARY "\r\nContent-Length: %u\r\n\r\n",
+                 esp_crc32_update( ESP_CRC32_INITIAL, image, size ), part_length + size + tail_length );
+    } else {
+        sprintf( head, "POST " ESP_OTA_HTTP_PATH "?crc=%08x HTTP/1.1\r\nHost: esp\r\n"
+                 "Content-Type: application/octet-stream\r\nContent-Length: %u\r\n\r\n",
+                 esp_crc32_update( ESP_CRC32_INITIAL, image, size ), size );
+    }
+    http_request_initialize( &request );
+    http_request_parse( &request, ( uint8_t* ) head );
+    result = esp_ota_http_begin( &esp_ota_bench_update, &request );
+    http_request_deinitialize( &request );
+    if( ! result || ! esp_flash_sim_powered() )
+        return 0x00;
+    if( ! esp_ota_bench_feed( ( uint8_t* ) part, part_length, &arrival ) ||
+        ! esp_ota_bench_feed( image, size, &arrival ) ||
+        ! esp_ota_bench_feed( ( uint8_t* ) tail, tail_length, &arrival ) )
+        return 0x00;
+    return esp_ota_http_end( &esp_ota_bench_update ) && esp_flash_sim_powered();
+}
+
+/**
+ * Upload the image a number of times, returns the number of uploads which didn't verify
+ */
+static uint32_t esp_ota_bench_run( uint32_t size, uint32_t uploads )
+{
+    esp_flash_sim_stats_type* stats = esp_flash_sim_get_stats();
+    uint32_t i, errors = 0, stalls = 0, stall_time = 0, start;
+    uint8_t multipart;
+    double seconds;
+
+    esp_flash_sim_reset_stats();
+    start = system_get_time();
+    for( i = 0; i < uploads ; i ++ ){
+        multipart = esp_ota_bench_multipart && ( i % 2 );
+        esp_ota_bench_fill( esp_ota_bench_image, size );
+        if( ! esp_ota_bench_upload( esp_ota_bench_image, size, multipart ) ||
+            ! esp_ota_bench_matches( esp_ota_bench_update.partition_address, esp_ota_bench_image, size ) )
+            errors ++;
+        stalls += esp_ota_bench_update.stall_count;
+        stall_time += esp_ota_bench_update.stall_time;
+        // the device keeps running the same image
+        system_upgrade_flag_set( UPGRADE_FLAG_IDLE );
+    }
+    seconds = ( system_get_time() - start ) / 1e6;
+    printf( "%-12s %8u uploads of %u bytes, link %u kbit/s\n", "update", uploads, size, esp_ota_bench_link_rate );
+    printf( "             %10.1f KB/s flash time %8.1f KB/s link\n",
+            seconds > 0 ? uploads * ( double ) size / 1024 / seconds : 0.0, esp_ota_bench_link_rate / 8.0 * 1000 / 1024 );
+    printf( "             %10.1f erase stalls/upload %8.1f ms stalled/upload %8.1f erases/upload\n",
+            ( double ) stalls / uploads, stall_time / 1000.0 / uploads, ( double ) stats->erases / uploads );
+    printf( "             %10.1f bytes written/byte %8llu rejected calls %8u errors\n",
+            ( double ) stats->write_bytes / ( ( uint64_t ) size * uploads ), ( unsigned long long ) stats->rejected, errors );
+    return errors;
+}
+
+/**
+ * Cut the power during uploads, returns the number of boots which found the running image damaged, an image
+ * marked for boot which didn't land whole, or which couldn't take the same upload again
+ */
+static uint32_t esp_ota_bench_stress( uint32_t size, uint32_t cuts )
+{
+    uint32_t done = 0, attempts = 0, failures = 0, length;
+    uint32_t running = ( esp_ota_inactive_partition() == ESP_OTA_USER1_ADDRESS ) ? ESP_OTA_USER2_ADDRESS : ESP_OTA_USER1_ADDRESS;
+    uint8_t result;
+
+    while( done < cuts && attempts < cuts * 10 ){
+        attempts ++;
+        length = 4 + esp_flash_sim_random() % size;
+        esp_ota_bench_fill( esp_ota_bench_image, length );
+        // the cut lands anywhere in the erases and writes of the upload
+        esp_flash_sim_cut_random( length + ( length / ESP_OTA_SECTOR_SIZE + 2 ) * ESP_OTA_SECTOR_SIZE );
+        result = esp_ota_bench_upload( esp_ota_bench_image, length, esp_ota_bench_multipart && ( attempts % 2 ) );
+        if( result && ! esp_ota_bench_matches( esp_ota_bench_update.partition_address, esp_ota_bench_image, length ) )
+            failures ++;
+        if( esp_flash_sim_powered() ){
+            esp_flash_sim_power_on();
+            system_upgrade_flag_set( UPGRADE_FLAG_IDLE );
+            continue;
+        }
+        done ++;
+        esp_flash_sim_power_on();
+        esp_host_power_loss();
+        // the boot loader still starts the old image, and it is whole
+        if( system_upgrade_flag_check() == UPGRADE_FLAG_FINISH ||
+            ! esp_ota_bench_matches( running, esp_ota_bench_running, ESP_OTA_PARTITION_SIZE ) ){
+            failures ++;
+            continue;
+        }
+        // the torn image doesn't get in the way of the next upload
+        if( ! esp_ota_bench_upload( esp_ota_bench_image, length, 0x00 ) ||
+            ! esp_ota_bench_matches( esp_ota_bench_update.partition_address, esp_ota_bench_image, length ) )
+            failures ++;
+        system_upgrade_flag_set( UPGRADE_FLAG_IDLE );
+    }
+    printf( "%-12s %8u power cuts %8u failures, recovery %.2f%%\n",
+            "power loss", done, failures, done ? 100.0 * ( done - failures ) / done : 100.0 );
+    return failures;
+}
+
+/**
+ * Command line
+ */
+static void esp_ota_bench_usage( const char* name )
+{
+    printf( "usage: %s [-f flash file] [-i image bytes] [-n uploads] [-c power cuts] [-l link kbit/s] [-s seed] [-m] [-r]\n"
+            "  -m  send every other upload as multipart/form-data\n"
+            "  -r  sleep for the flash latencies\n", name );
+}
+
+int main( int argc, char** argv )
+{
+    esp_flash_sim_latency_type latency = { ESP_FLASH_SIM_READ_BYTE_NS, ESP_FLASH_SIM_WRITE_PAGE_US, ESP_FLASH_SIM_ERASE_SECTOR_US, 0x00 };
+    const char* path = "esp_flash_sim.bin";
+    uint32_t size = 256 * 1024, uploads = 4, cuts = 200, seed = 1;
+    uint32_t errors = 0, running;
+    int option;
+
+    while( ( option = getopt( argc, argv, "f:i:n:c:l:s:mrh" ) ) != -1 ){
+        switch( option ){
+            case 'f': path = optarg; break;
+            case 'i': size = strtoul( optarg, NULL, 0 ); break;
+            case 'n': uploads = strtoul( optarg, NULL, 0 ); break;
+            case 'c': cuts = strtoul( optarg, NULL, 0 ); break;
+            case 'l': esp_ota_bench_link_rate = strtoul( optarg, NULL, 0 ); break;
+            case 's': seed = strtoul( optarg, NULL, 0 ); break;
+            case 'm': esp_ota_bench_multipart = 0x01; break;
+            case 'r': latency.realtime = 0x01; break;
+            default: esp_ota_bench_usage( argv[ 0 ] ); return 2;
+        }
+    }
+    if( size < 4 || size > ESP_OTA_PARTITION_SIZE || esp_ota_bench_link_rate == 0 ){
+        esp_ota_bench_usage( argv[ 0 ] );
+        return 2;
+    }
+    if( ! esp_flash_sim_open( path, ESP_FLASH_SIM_DEFAULT_SIZE ) ){
+        fprintf( stderr, "can't map %s\n", path );
+        return 1;
+    }
+    esp_ota_bench_running = ( uint8_t* ) malloc( ESP_OTA_PARTITION_SIZE );
+    esp_ota_bench_image = ( uint8_t* ) malloc( size );
+    esp_flash_sim_seed( seed );
+    esp_flash_sim_set_latency( &latency );
+    // the running image fills its partition
+    esp_flash_sim_erase_all();
+    running = ( esp_ota_inactive_partition() == ESP_OTA_USER1_ADDRESS ) ? ESP_OTA_USER2_ADDRESS : ESP_OTA_USER1_ADDRESS;
+    esp_ota_bench_fill( esp_ota_bench_running, ESP_OTA_PARTITION_SIZE );
+    memcpy( esp_flash_sim_memory() + running, esp_ota_bench_running, ESP_OTA_PARTITION_SIZE );
+    esp_ota_register_route();
+
+    if( uploads > 0 )
+        errors += esp_ota_bench_run( size, uploads );
+    if( cuts > 0 )
+        errors += esp_ota_bench_stress( size, cuts );
+    free( esp_ota_bench_image );
+    free( esp_ota_bench_running );
+    esp_flash_sim_close();
+    return errors ? 1 : 0;
+}